@@ -0,0 +1,72 @@
+/*
+ * Measures the throughput of FlameStore's erasure code kernels and
+ * the time needed to rebuild a model from its fragments when some
+ * of them are lost (the computation part of a degraded read).
+ *
+ * Build and run with run-ec-benchmark.sh.
+ */
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include "server/erasure_code.hpp"
+
+using namespace flamestore;
+using clock_type = std::chrono::steady_clock;
+
+static double seconds_since(clock_type::time_point t) {
+    return std::chrono::duration<double>(clock_type::now() - t).count();
+}
+
+static void run(unsigned k, unsigned m, std::size_t model_size, unsigned repetitions) {
+    ErasureCode ec(k, m);
+    std::size_t len = ec.fragment_size(model_size);
+    std::vector<uint8_t> buffer((k+m)*len, 0);
+    std::mt19937 rng(42);
+    for(std::size_t i = 0; i < model_size; i++) buffer[i] = rng() & 0xff;
+    std::vector<uint8_t> original(buffer.begin(), buffer.begin() + k*len);
+    std::vector<uint8_t*> fragments(k+m);
+    for(unsigned i = 0; i < k+m; i++) fragments[i] = buffer.data() + i*len;
+
+    auto t = clock_type::now();
+    for(unsigned r = 0; r < repetitions; r++)
+        ec.encode(fragments.data(), fragments.data() + k, len);
+    double encode_time = seconds_since(t) / repetitions;
+
+    // lose the first m data fragments (worst case for a degraded read)
+    std::vector<bool> available(k+m, true);
+    for(unsigned i = 0; i < m && i < k; i++) available[i] = false;
+    double decode_time = 0.0;
+    for(unsigned r = 0; r < repetitions; r++) {
+        for(unsigned i = 0; i < m && i < k; i++) std::memset(fragments[i], 0, len);
+        t = clock_type::now();
+        ec.decode(fragments.data(), available, len);
+        decode_time += seconds_since(t);
+    }
+    decode_time /= repetitions;
+    bool ok = std::memcmp(original.data(), buffer.data(), model_size) == 0;
+
+    std::cout << std::setw(4) << k << std::setw(4) << m
+              << std::setw(12) << model_size / (1024*1024)
+              << std::fixed << std::setprecision(2)
+              << std::setw(16) << model_size / encode_time / 1e9
+              << std::setw(16) << model_size / decode_time / 1e9
+              << std::setw(16) << decode_time * 1e3
+              << std::setw(8) << (ok ? "ok" : "FAILED") << std::endl;
+}
+
+int main(int argc, char** argv) {
+    unsigned repetitions = argc > 1 ? std::stoul(argv[1]) : 5;
+    std::cout << "Kernel: " << ErasureCode::kernel_name() << std::endl;
+    std::cout << std::setw(4) << "k" << std::setw(4) << "m"
+              << std::setw(12) << "size (MB)"
+              << std::setw(16) << "encode (GB/s)"
+              << std::setw(16) << "decode (GB/s)"
+              << std::setw(16) << "rebuild (ms)"
+              << std::setw(8) << "check" << std::endl;
+    for(auto km : { std::make_pair(4u, 2u), std::make_pair(8u, 2u), std::make_pair(8u, 4u), std::make_pair(10u, 4u) })
+        for(std::size_t size : { 1UL << 20, 64UL << 20, 256UL << 20 })
+            run(km.first, km.second, size, repetitions);
+    return 0;
+}
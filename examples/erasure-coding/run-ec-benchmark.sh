@@ -0,0 +1,6 @@
+#!/bin/bash
+HERE=$(dirname $(readlink -f $0))
+SRC=$HERE/../../flamestore/src
+g++ -O2 -std=c++14 -I$SRC -o $HERE/ec-benchmark \
+    $HERE/ec-benchmark.cpp $SRC/server/erasure_code.cpp || exit 1
+$HERE/ec-benchmark "$@"
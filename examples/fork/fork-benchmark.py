@@ -0,0 +1,76 @@
+import os
+os.environ['TF_CPP_MIN_LOG_LEVEL'] = '3'
+import sys
+import time
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                             '..', 'benchmark'))
+from tensorflow.keras import backend as K
+from flamestore.client import Client
+import benchmark
+import spdlog
+
+
+logger = spdlog.ConsoleLogger("Benchmark")
+logger.set_pattern("[%Y-%m-%d %H:%M:%S.%F] [%n] [%^%l%$] %v")
+
+
+def create_and_store_model(client, model_name, num_layers, layer_size):
+    logger.info('=> Creating model {} with {} layers of {} neurons'.format(
+        model_name, num_layers, layer_size))
+    model = benchmark.create_model(num_layers, layer_size)
+    benchmark.build_model(model)
+    client.register_model(model_name, model, include_optimizer=True)
+    client.save_weights(model_name, model, include_optimizer=True)
+    return model
+
+
+def load_children(client, model, children):
+    """Loads the weights of every child, which waits for the
+    background copies of the backend to complete."""
+    for name in children:
+        client.load_weights(name, model, include_optimizer=True)
+
+
+def fork_one_by_one(client, model, source, prefix, n):
+    children = [prefix + str(i) for i in range(n)]
+    t1 = time.time()
+    for name in children:
+        client.duplicate_model(source, name)
+    t2 = time.time()
+    load_children(client, model, children)
+    t3 = time.time()
+    return t2 - t1, t3 - t1
+
+
+def fork_many(client, model, source, prefix, n):
+    children = [prefix + str(i) for i in range(n)]
+    t1 = time.time()
+    client.duplicate_many(source, children)
+    t2 = time.time()
+    load_children(client, model, children)
+    t3 = time.time()
+    return t2 - t1, t3 - t1
+
+
+if __name__ == '__main__':
+    if(len(sys.argv) < 5):
+        logger.info("Usage: python fork-benchmark.py <workspace> "
+                    "<num_layers> <layer_size> <N> [<N> ...]")
+        sys.exit(-1)
+    workspace = sys.argv[1]
+    num_layers = int(sys.argv[2])
+    layer_size = int(sys.argv[3])
+    fanouts = [int(n) for n in sys.argv[4:]]
+    client = Client(workspace=workspace)
+    model = create_and_store_model(client, 'source', num_layers, layer_size)
+    print('N\tmethod\tfork (s)\tfork+load (s)')
+    for n in fanouts:
+        fork, total = fork_one_by_one(
+            client, model, 'source', 'single_{}_'.format(n), n)
+        print('{}\tduplicate_model\t{:.6f}\t{:.6f}'.format(n, fork, total))
+        fork, total = fork_many(
+            client, model, 'source', 'many_{}_'.format(n), n)
+        print('{}\tduplicate_many\t{:.6f}\t{:.6f}'.format(n, fork, total))
+        sys.stdout.flush()
+    del model
+    K.clear_session()
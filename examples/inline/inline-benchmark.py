@@ -0,0 +1,64 @@
+import os
+os.environ['TF_CPP_MIN_LOG_LEVEL'] = '3'
+import sys
+import time
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                             '..', 'benchmark'))
+from tensorflow.keras import backend as K
+from flamestore.client import Client
+import benchmark
+import spdlog
+
+
+logger = spdlog.ConsoleLogger("Benchmark")
+logger.set_pattern("[%Y-%m-%d %H:%M:%S.%F] [%n] [%^%l%$] %v")
+
+
+def model_size(model):
+    """Size of the data FlameStore transfers for this model."""
+    weights = model.weights + model.optimizer.weights
+    return sum(w.dtype.size * max(1, int(K.count_params(w)))
+               for w in weights)
+
+
+def time_transfers(client, model_name, model, threshold, repeat):
+    """Saves and loads the weights of a model repeat times with the
+    given inline threshold, returns the average times."""
+    client._set_inline_threshold(threshold)
+    t1 = time.time()
+    for i in range(repeat):
+        client.save_weights(model_name, model, include_optimizer=True)
+    t2 = time.time()
+    for i in range(repeat):
+        client.load_weights(model_name, model, include_optimizer=True)
+    t3 = time.time()
+    return (t2 - t1) / repeat, (t3 - t2) / repeat
+
+
+if __name__ == '__main__':
+    if(len(sys.argv) < 5):
+        logger.info("Usage: python inline-benchmark.py <workspace> "
+                    "<num_layers> <repeat> <layer_size> [<layer_size> ...]")
+        sys.exit(-1)
+    workspace = sys.argv[1]
+    num_layers = int(sys.argv[2])
+    repeat = int(sys.argv[3])
+    layer_sizes = [int(n) for n in sys.argv[4:]]
+    client = Client(workspace=workspace)
+    print('layer size\tmodel size (B)\tpath\tsave (s)\tload (s)')
+    for layer_size in layer_sizes:
+        model_name = 'model_{}'.format(layer_size)
+        logger.info('=> Creating model {} with {} layers of {} neurons'.format(
+            model_name, num_layers, layer_size))
+        model = benchmark.create_model(num_layers, layer_size)
+        benchmark.build_model(model)
+        client.register_model(model_name, model, include_optimizer=True)
+        size = model_size(model)
+        for path, threshold in [('rdma', 0), ('inline', size)]:
+            save, load = time_transfers(
+                client, model_name, model, threshold, repeat)
+            print('{}\t{}\t{}\t{:.6f}\t{:.6f}'.format(
+                layer_size, size, path, save, load))
+            sys.stdout.flush()
+        del model
+        K.clear_session()
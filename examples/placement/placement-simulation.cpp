@@ -0,0 +1,99 @@
+/*
+ * Simulates the placement of models onto storage targets using
+ * each of FlameStore's placement policies, and reports how evenly
+ * space and bandwidth end up being used.
+ *
+ * Build and run with run-placement-simulation.sh.
+ */
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include "server/placement.hpp"
+
+using namespace flamestore;
+
+struct sim_config {
+    std::size_t num_servers   = 16;
+    std::size_t num_models    = 10000;
+    std::size_t batch_size    = 64;      // models registered per time step
+    double      drain_per_step = 64e6;   // bytes a target writes per time step
+    double      mean_log_size = std::log(8e6);
+    double      sigma_log_size = 1.5;
+};
+
+static void simulate(const std::string& policy_name, const sim_config& cfg) {
+    std::mt19937 rng(1234);
+    auto policy = AbstractPlacementPolicy::create(policy_name);
+    std::vector<placement_target> targets(cfg.num_servers);
+    for(std::size_t i = 0; i < targets.size(); i++) {
+        targets[i].m_key = "ofi+tcp://10.0.0." + std::to_string(i) + ":1234/0";
+        targets[i].m_server = i;
+        // heterogeneous devices: half the targets are twice as large
+        targets[i].m_capacity = (i % 2 ? 64UL : 32UL) << 30;
+    }
+    std::lognormal_distribution<double> size_dist(cfg.mean_log_size, cfg.sigma_log_size);
+    std::size_t failed = 0;
+    double inflight_imbalance = 0.0;
+    std::size_t num_steps = 0;
+    for(std::size_t m = 0; m < cfg.num_models; m++) {
+        std::size_t size = (std::size_t)size_dist(rng);
+        auto selected = policy->select(targets, "model-" + std::to_string(m), size);
+        if(selected.empty()) {
+            failed += 1;
+        } else {
+            targets[selected[0]].m_allocated += size;
+            targets[selected[0]].m_inflight  += size;
+        }
+        if((m+1) % cfg.batch_size == 0) {
+            std::size_t max_inflight = 0, sum_inflight = 0;
+            for(auto& t : targets) {
+                max_inflight = std::max(max_inflight, t.m_inflight);
+                sum_inflight += t.m_inflight;
+            }
+            if(sum_inflight) {
+                inflight_imbalance += (double)max_inflight * targets.size() / sum_inflight;
+                num_steps += 1;
+            }
+            for(auto& t : targets)
+                t.m_inflight -= std::min<std::size_t>(t.m_inflight, cfg.drain_per_step);
+        }
+    }
+    double mean = 0.0, max = 0.0, var = 0.0;
+    for(auto& t : targets) {
+        double fill = (double)t.m_allocated / t.m_capacity;
+        mean += fill;
+        max = std::max(max, fill);
+    }
+    mean /= targets.size();
+    for(auto& t : targets) {
+        double fill = (double)t.m_allocated / t.m_capacity;
+        var += (fill - mean)*(fill - mean);
+    }
+    double stddev = std::sqrt(var / targets.size());
+    std::cout << std::left << std::setw(20) << policy_name << std::right << std::fixed
+              << std::setprecision(3)
+              << std::setw(12) << mean
+              << std::setw(12) << max
+              << std::setw(12) << stddev
+              << std::setw(16) << (num_steps ? inflight_imbalance / num_steps : 0.0)
+              << std::setw(10) << failed << std::endl;
+}
+
+int main(int argc, char** argv) {
+    sim_config cfg;
+    if(argc > 1) cfg.num_servers = std::stoul(argv[1]);
+    if(argc > 2) cfg.num_models  = std::stoul(argv[2]);
+    std::cout << "Placing " << cfg.num_models << " models on "
+              << cfg.num_servers << " targets" << std::endl;
+    std::cout << std::left << std::setw(20) << "policy" << std::right
+              << std::setw(12) << "mean fill"
+              << std::setw(12) << "max fill"
+              << std::setw(12) << "stddev"
+              << std::setw(16) << "hot/avg load"
+              << std::setw(10) << "failed" << std::endl;
+    for(auto& name : { "random", "least-loaded", "capacity-weighted", "consistent-hashing" })
+        simulate(name, cfg);
+    return 0;
+}
@@ -0,0 +1,6 @@
+#!/bin/bash
+HERE=$(dirname $(readlink -f $0))
+SRC=$HERE/../../flamestore/src
+g++ -O2 -std=c++14 -I$SRC -o $HERE/placement-simulation \
+    $HERE/placement-simulation.cpp $SRC/server/placement.cpp || exit 1
+$HERE/placement-simulation "$@"
@@ -40,3 +40,14 @@ class Admin(_flamestore_admin.Admin):
     def __del__(self):
         self._cleanup_hg_resources()
         del self._engine
+
+    def get_stats(self):
+        """Returns the counters published by the backend
+        (e.g. read cache hits and misses) as a dictionary."""
+        return super().get_stats()
+
+    def get_scheduler_stats(self):
+        """Returns the counters of the master's scheduler (admitted,
+        queued and delayed requests, queuing delays and bytes per class
+        of request, bytes in flight) as a dictionary."""
+        return super().get_scheduler_stats()
@@ -16,23 +16,31 @@ logger.set_pattern("[%Y-%m-%d %H:%M:%S.%F] [%n] [%^%l%$] %v")
 class Client(_flamestore_client.Client):
     """Client class allowing access to FlameStore providers."""
 
-    def __init__(self, engine=None, workspace='.'):
+    def __init__(self, engine=None, workspace='.', inline_threshold=None,
+                 priority=None):
         """Constructor.
 
         Args:
             engine (pymargo.core.Engine): Py-Margo engine.
             workspace (str): path to a workspace.
+            inline_threshold (int): size (in bytes) up to which model data
+                is sent in the RPCs instead of through RDMA (0 disables
+                it). Defaults to the workspace's "inline_threshold" if any,
+                otherwise to 64 KB.
+            priority (int): priority of the client's requests in the
+                master's scheduler (e.g. higher for inference or restart
+                clients than for training clients). Defaults to 1.
         """
         path = os.path.abspath(workspace)
         if(not os.path.isdir(path+'/.flamestore')):
             logger.critical('Directory is not a FlameStore workspace')
             raise RuntimeError('Directory is not a FlameStore workspace')
         connectionfile = path + '/.flamestore/master'
+        with open(path+'/.flamestore/config.json') as f:
+            config = json.loads(f.read())
         if(engine is None):
             import pymargo
             import pymargo.core
-            with open(path+'/.flamestore/config.json') as f:
-                config = json.loads(f.read())
             protocol = config['protocol']
             self._engine = pymargo.core.Engine(
                 protocol,
@@ -41,6 +49,12 @@ class Client(_flamestore_client.Client):
         else:
             self._engine = engine
         super().__init__(self._engine._mid, connectionfile)
+        if(inline_threshold is None):
+            inline_threshold = config.get('inline_threshold')
+        if(inline_threshold is not None):
+            self._set_inline_threshold(int(inline_threshold))
+        if(priority is not None):
+            self.set_priority(priority)
         logger.debug('Creating a Client for workspace '+path)
 
     def __del__(self):
@@ -50,7 +64,9 @@ class Client(_flamestore_client.Client):
     def register_model(self,
                        model_name,
                        model,
-                       include_optimizer=True):
+                       include_optimizer=True,
+                       save_weights=False,
+                       tags=None):
         """
         Registers a model in a provider.
 
@@ -59,34 +75,37 @@ class Client(_flamestore_client.Client):
             model_name (string): model name.
             model (keras Model): model.
             include_optimizer (bool): whether to register the optimizer.
+            save_weights (bool): whether to also save the model's weights.
+                The registration and the weights are then sent in a
+                single request.
+            tags (dict): user tags (str to str) that list_models can
+                filter on.
         """
-        model_config = {'model': model.to_json()}
+        model_config = {'model': json.loads(model.to_json())}
         if(include_optimizer):
-            model_config['optimizer'] = json.dumps({
+            model_config['optimizer'] = {
                 'name': type(model.optimizer).__name__,
-                'config': model.optimizer.get_config()})
+                'config': model.optimizer.get_config()}
         else:
             model_config['optimizer'] = None
-        model_size = 0
-        for l in model.layers:
-            for w in l.weights:
-                s = w.dtype.size * reduce(lambda x, y: x * y, w.shape)
-                model_size += s
-        if(include_optimizer):
-            model._make_train_function()
-            for w in model.optimizer.weights:
-                if(len(w.shape) == 0):
-                    model_size += w.dtype.size
-                else:
-                    s = w.dtype.size * reduce(lambda x, y: x * y, w.shape)
-                    model_size += s
+        model_size = self.__model_size(model, include_optimizer)
         if(include_optimizer):
             model_signature = util._compute_signature(model, model.optimizer)
         else:
             model_signature = util._compute_signature(model)
         model.__flamestore_model_signature = model_signature
+        model_config = util._pack_config(model_config)
+        if(save_weights):
+            logger.debug('Deferring register_model to save_weights')
+            self._defer_register_model(model_name,
+                                       model_config,
+                                       model_size,
+                                       model_signature)
+            self.save_weights(model_name, model, include_optimizer)
+            if(tags):
+                self.set_model_tags(model_name, tags)
+            return
         logger.debug('Issuing register_model RPC')
-        model_config = json.dumps(model_config)
         status, message = self._register_model(model_name,
                                                model_config,
                                                model_size,
@@ -94,8 +113,11 @@ class Client(_flamestore_client.Client):
         if(status != 0):
             logger.error(message)
             raise RuntimeError(message)
+        if(tags):
+            self.set_model_tags(model_name, tags)
 
-    def reload_model(self, model_name, include_optimizer=True):
+    def reload_model(self, model_name, include_optimizer=True,
+                     prefetch_weights=False):
         """Loads a model given its name from FlameStore. This method
         will only reload the model's architecture, not the model's data.
         The load_weights method in TMCI should be used to load the model's
@@ -104,20 +126,26 @@ class Client(_flamestore_client.Client):
         Args:
             model_name (string): name of the model.
             include_optimizer (bool): whether to also reload the optimizer.
+            prefetch_weights (bool): whether to fetch the model's weights
+                in the same request, so that the next load_weights call
+                for this model does not have to contact FlameStore.
         Returns:
             a keras Model instance.
         """
-        logger.debug('Issuing _reload_model RPC')
-        status, message = self._reload_model(model_name)
+        if(prefetch_weights):
+            logger.debug('Issuing _reload_model_data RPC')
+            status, message = self._reload_model_data(model_name)
+        else:
+            logger.debug('Issuing _reload_model RPC')
+            status, message = self._reload_model(model_name)
         if(status != 0):
+            message = message.decode()
             logger.error(message)
             raise RuntimeError(message)
-        config = json.loads(message)
-        model_config = config['model']
+        model_config, optimizer_config = util._unpack_config(message)
         logger.debug('Rebuilding model')
         model = model_from_json(model_config)
         if(include_optimizer):
-            optimizer_config = json.loads(config['optimizer'])
             if(optimizer_config is None):
                 raise RuntimeError(
                     'Requested model wasn\'t stored with its optimizer')
@@ -128,6 +156,89 @@ class Client(_flamestore_client.Client):
             model.optimizer = cls(**optimizer_config)
         return model
 
+    def stat_model(self, model_name):
+        """Returns the size of the data, the signature and the version
+        (number of writes) of a model, without transferring its
+        configuration.
+
+        Args:
+            model_name (string): name of the model.
+        Returns:
+            a dict with 'size', 'signature', 'version' and 'config_size'.
+        """
+        status, message, size, signature, version, config_size = \
+            self._stat_model(model_name)
+        if(status != 0):
+            logger.error(message)
+            raise RuntimeError(message)
+        return {'size': size,
+                'signature': signature,
+                'version': version,
+                'config_size': config_size}
+
+    def set_priority(self, priority):
+        """Sets the priority of the client in the master's scheduler,
+        which multiplies the weight of its requests when the master
+        limits the model data in flight.
+
+        Args:
+            priority (int): priority (at least 1).
+        """
+        status, message = self._set_priority(max(int(priority), 1))
+        if(status != 0):
+            logger.error(message)
+            raise RuntimeError(message)
+
+    def set_model_tags(self, model_name, tags):
+        """Sets the user tags of a model, replacing its previous tags.
+
+        Args:
+            model_name (string): name of the model.
+            tags (dict): tags (str to str).
+        """
+        status, message = self._set_model_tags(
+            model_name,
+            {str(k): str(v) for k, v in tags.items()})
+        if(status != 0):
+            logger.error(message)
+            raise RuntimeError(message)
+
+    def list_models(self, prefix='', start='', end='', signature=None,
+                    min_size=0, max_size=0, tags=None, page_size=1000):
+        """Lists the models stored in FlameStore, in name order.
+        The models are fetched by pages of at most page_size models,
+        as the generator is consumed.
+
+        Args:
+            prefix (str): only list names starting with the prefix.
+            start (str): only list names >= start.
+            end (str): only list names < end (empty for no bound).
+            signature (str): only list models with this signature.
+            min_size (int): only list models with at least this size.
+            max_size (int): only list models with at most this size
+                (0 for no bound).
+            tags (dict): only list models with all these tags.
+            page_size (int): maximum number of models per request.
+        Yields:
+            a dict with 'name', 'signature', 'size' and 'tags'.
+        """
+        tags = {str(k): str(v) for k, v in (tags or {}).items()}
+        after = ''
+        while(True):
+            status, message, models, after = self._list_models(
+                prefix, start, end, after, signature or '',
+                min_size, max_size, tags, page_size)
+            if(status != 0):
+                logger.error(message)
+                raise RuntimeError(message)
+            for name, sig, size, model_tags in models:
+                yield {'name': name,
+                       'signature': sig,
+                       'size': size,
+                       'tags': model_tags}
+            if(not after):
+                break
+
     def duplicate_model(self, source_model_name, dest_model_name):
         """This function requests the FlameStore backend to
         duplicate a model (both architecture and data).
@@ -144,6 +255,77 @@ class Client(_flamestore_client.Client):
             logger.error(message)
             raise RuntimeError(message)
 
+    def duplicate_many(self, source_model_name, dest_model_names):
+        """This function requests the FlameStore backend to
+        duplicate a model into several new models in a single
+        request (e.g. to fork the best model of a population).
+        The source model is read only once. The new model names
+        must not be already in use.
+
+        Args:
+            source_model_name (str): name of the model to duplicate
+            dest_model_names (list of str): names of the new models
+        """
+        result = self._duplicate_many(
+            source_model_name,
+            list(dest_model_names))
+        errors = [name + ': ' + message
+                  for name, (status, message) in zip(dest_model_names, result)
+                  if status != 0]
+        if(len(errors) != 0):
+            message = 'Could not duplicate ' + source_model_name \
+                + ' into ' + ', '.join(errors)
+            logger.error(message)
+            raise RuntimeError(message)
+
+    def flush(self):
+        """This function waits until all the model data written so far
+        has been persisted by the FlameStore backend. It should be called
+        at the end of a job when the backend acknowledges writes before
+        persisting them (e.g. the mochi backend with a burst buffer).
+        """
+        status, message = self._flush()
+        if(status != 0):
+            logger.error(message)
+            raise RuntimeError(message)
+
+    @staticmethod
+    def __model_size(model, include_optimizer):
+        """Computes the size of the data of a model, as transferred by
+        save_weights and load_weights.
+
+        Args:
+            model (keras.Model): model.
+            include_optimizer (bool): whether to include the model's optimizer.
+        """
+        model_size = 0
+        for l in model.layers:
+            for w in l.weights:
+                s = w.dtype.size * reduce(lambda x, y: x * y, w.shape)
+                model_size += s
+        if(include_optimizer):
+            model._make_train_function()
+            for w in model.optimizer.weights:
+                if(len(w.shape) == 0):
+                    model_size += w.dtype.size
+                else:
+                    s = w.dtype.size * reduce(lambda x, y: x * y, w.shape)
+                    model_size += s
+        return model_size
+
+    @staticmethod
+    def __check_batch(action, names, result):
+        """Raises an exception listing the models of a batch
+        for which an error was returned.
+        """
+        errors = [name + ': ' + message
+                  for name, (status, message) in zip(names, result)
+                  if status != 0]
+        if(len(errors) != 0):
+            message = 'Could not ' + action + ' ' + ', '.join(errors)
+            logger.error(message)
+            raise RuntimeError(message)
+
     def __transfer_weights(self, model_name, model,
                            include_optimizer, transfer):
         """Helper function that can save and load weights (the save and load
@@ -192,3 +374,49 @@ class Client(_flamestore_client.Client):
         model._make_train_function()
         self.__transfer_weights(model_name, model, include_optimizer,
                                 tmci.checkpoint.load_weights)
+
+    def save_weights_many(self, models, include_optimizer=True, atomic=False):
+        """Saves the weights of several models (e.g. the members of an
+        ensemble, or the generator and discriminator of a GAN) in a
+        single request. The models must have been registered.
+
+        Args:
+            models (dict): keras models to save, by model name.
+            include_optimizer (bool): whether to include the optimizers.
+            atomic (bool): if True, either all the models are saved
+                or none of them is.
+        """
+        names = list(models.keys())
+        self._begin_batch()
+        try:
+            for name in names:
+                self.save_weights(name, models[name], include_optimizer)
+        except BaseException:
+            self._abort_batch()
+            raise
+        result = self._end_batch(atomic)
+        self.__check_batch('save', names, result)
+
+    def load_weights_many(self, models, include_optimizer=True):
+        """Loads the weights of several models in a single request.
+        The models must have been registered and built.
+
+        Args:
+            models (dict): keras models to load, by model name.
+            include_optimizer (bool): whether to include the optimizers.
+        """
+        names = list(models.keys())
+        signatures = []
+        sizes = []
+        for name in names:
+            model = models[name]
+            if(include_optimizer):
+                signatures.append(
+                    util._compute_signature(model, model.optimizer))
+            else:
+                signatures.append(util._compute_signature(model))
+            sizes.append(self.__model_size(model, include_optimizer))
+        result = self._prefetch_models_data(names, signatures, sizes)
+        self.__check_batch('load', names, result)
+        for name in names:
+            self.load_weights(name, models[name], include_optimizer)
@@ -1,11 +1,15 @@
 #include "admin/admin.hpp"
 #include <fstream>
+#include <thallium/serialization/stl/map.hpp>
+#include <thallium/serialization/stl/string.hpp>
 
 namespace flamestore {
 
 Admin::Admin(pymargo_instance_id mid, const std::string& connectionfile)
     : m_engine(std::make_shared<tl::engine>(CAPSULE2MID(mid)))
     , m_rpc_shutdown(m_engine->define("flamestore_shutdown"))
+    , m_rpc_backend_stats(m_engine->define("flamestore_backend_stats"))
+    , m_rpc_scheduler_stats(m_engine->define("flamestore_scheduler_stats"))
 {
     std::ifstream ifs(connectionfile);
     if(!ifs.good())
@@ -23,4 +27,18 @@ Admin::return_status Admin::shutdown()
     return status.move_to_pair();
 }
 
+std::map<std::string, uint64_t> Admin::get_stats()
+{
+    std::map<std::string, uint64_t> stats = m_rpc_backend_stats
+        .on(m_master_provider)();
+    return stats;
+}
+
+std::map<std::string, uint64_t> Admin::get_scheduler_stats()
+{
+    std::map<std::string, uint64_t> stats = m_rpc_scheduler_stats
+        .on(m_master_provider)();
+    return stats;
+}
+
 }
@@ -20,6 +20,8 @@ class Admin {
     std::shared_ptr<tl::engine> m_engine;
     std::string                 m_admin_addr;
     tl::remote_procedure        m_rpc_shutdown;
+    tl::remote_procedure        m_rpc_backend_stats;
+    tl::remote_procedure        m_rpc_scheduler_stats;
     tl::provider_handle         m_master_provider;
 
     public:
@@ -42,6 +44,18 @@ class Admin {
      */
     return_status shutdown();
 
+    /**
+     * @brief Returns the counters published by the backend
+     * (e.g. read cache hits and misses).
+     */
+    std::map<std::string, uint64_t> get_stats();
+
+    /**
+     * @brief Returns the counters of the master's scheduler
+     * (per-class queue lengths and delays, bytes in flight).
+     */
+    std::map<std::string, uint64_t> get_scheduler_stats();
+
 };
 
 }
@@ -1,4 +1,5 @@
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 #include "admin.hpp"
 
 namespace py11 = pybind11;
@@ -9,6 +10,10 @@ PYBIND11_MODULE(_flamestore_admin, m) {
         .def(py11::init<pymargo_instance_id, const std::string&>())
         .def("shutdown", &flamestore::Admin::shutdown,
                 "Shuts down the FlameStore service.")
+        .def("get_stats", &flamestore::Admin::get_stats,
+                "Returns the counters published by the backend.")
+        .def("get_scheduler_stats", &flamestore::Admin::get_scheduler_stats,
+                "Returns the counters of the master's scheduler.")
         .def("_cleanup_hg_resources", &flamestore::Admin::cleanup_hg_resources,
                 "Cleanup internal HG resources")
         ;
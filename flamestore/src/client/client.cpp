@@ -1,5 +1,10 @@
 #include "client/client.hpp"
+#include <algorithm>
 #include <fstream>
+#include <thallium/serialization/stl/vector.hpp>
+#include <thallium/serialization/stl/pair.hpp>
+#include "common/reload_result.hpp"
+#include "common/content_key.hpp"
 
 namespace flamestore {
 
@@ -8,10 +13,24 @@ Client::Client(pymargo_instance_id mid, const std::string& connectionfile)
     , m_client_addr(m_engine->self())
     , m_rpc_shutdown(m_engine->define("flamestore_shutdown"))
     , m_rpc_register_model(m_engine->define("flamestore_register_model"))
-    , m_rpc_reload_model(m_engine->define("flamestore_reload_model"))
+    , m_rpc_register_bulk(m_engine->define("flamestore_register_model_bulk"))
+    , m_rpc_register_by_key(m_engine->define("flamestore_register_model_by_key"))
+    , m_rpc_stat_model(m_engine->define("flamestore_stat_model"))
+    , m_rpc_fetch_config(m_engine->define("flamestore_fetch_model_config"))
+    , m_rpc_register_and_write(m_engine->define("flamestore_register_and_write_model"))
+    , m_rpc_reload_data(m_engine->define("flamestore_reload_model_data"))
     , m_rpc_write_model(m_engine->define("flamestore_write_model_data"))
     , m_rpc_read_model(m_engine->define("flamestore_read_model_data"))
+    , m_rpc_write_inline(m_engine->define("flamestore_write_model_inline"))
+    , m_rpc_read_inline(m_engine->define("flamestore_read_model_inline"))
+    , m_rpc_write_batch(m_engine->define("flamestore_write_model_batch"))
+    , m_rpc_read_batch(m_engine->define("flamestore_read_model_batch"))
     , m_rpc_dup_model(m_engine->define("flamestore_dup_model"))
+    , m_rpc_dup_many(m_engine->define("flamestore_dup_many"))
+    , m_rpc_list_models(m_engine->define("flamestore_list_models"))
+    , m_rpc_set_tags(m_engine->define("flamestore_set_model_tags"))
+    , m_rpc_set_priority(m_engine->define("flamestore_set_client_priority"))
+    , m_rpc_flush(m_engine->define("flamestore_flush"))
 {
     std::ifstream ifs(connectionfile);
     if(!ifs.good())
@@ -35,6 +54,42 @@ Client::return_status Client::register_model(
         std::size_t model_data_size,
         const std::string& model_signature)
 {
+    // models of a sweep share their config, which the master keeps once:
+    // if it may already have it (we sent or received it before, or it is
+    // large enough for a failed attempt to be cheap) only its key is sent
+    auto config_key = content_key(model_config);
+    if(m_known_configs.count(config_key) || model_config.size() > m_inline_threshold) {
+        Status status = m_rpc_register_by_key
+            .on(m_master_provider)(
+                m_client_addr,
+                model_name,
+                config_key,
+                model_data_size,
+                model_signature);
+        if(status.m_code != FLAMESTORE_ENOCONFIG)
+            return status.move_to_pair();
+        m_known_configs.erase(config_key);
+    }
+    auto registered = [this, &config_key](Status status) {
+        if(status.m_code == FLAMESTORE_OK)
+            m_known_configs.insert(config_key);
+        return status.move_to_pair();
+    };
+    if(model_config.size() > m_inline_threshold) {
+        // large configs are pulled by the master
+        std::vector<std::pair<void*, size_t>> mem(1,
+                {const_cast<char*>(model_config.data()), model_config.size()});
+        auto bulk = engine().expose(mem, tl::bulk_mode::read_only);
+        Status status = m_rpc_register_bulk
+            .on(m_master_provider)(
+                m_client_addr,
+                model_name,
+                model_config.size(),
+                bulk,
+                model_data_size,
+                model_signature);
+        return registered(std::move(status));
+    }
     Status status = m_rpc_register_model
         .on(m_master_provider)(
             m_client_addr,
@@ -42,17 +97,122 @@ Client::return_status Client::register_model(
             model_config,
             model_data_size,
             model_signature);
-    return status.move_to_pair();
+    return registered(std::move(status));
+}
+
+void Client::defer_register_model(
+        const std::string& model_name,
+        const std::string& model_config,
+        std::size_t model_data_size,
+        const std::string& model_signature)
+{
+    m_pending[model_name] = PendingRegistration{
+        model_config, model_data_size, model_signature };
 }
 
 Client::return_status Client::reload_model(
         const std::string& model_name)
 {
-    Status status = m_rpc_reload_model
+    // small configs come back inline, large ones are pushed into
+    // m_config_cache, which is grown and the call retried if too small
+    for(int attempt = 0; attempt < 2; attempt++) {
+        model_info info = m_rpc_fetch_config
+            .on(m_master_provider)(
+                m_client_addr,
+                model_name,
+                m_config_cache.m_bulk,
+                m_config_cache.m_buffer.size(),
+                m_inline_threshold);
+        if(info.m_status.m_code != FLAMESTORE_OK)
+            return info.m_status.move_to_pair();
+        if(info.m_config_transfer != model_info::NONE || info.m_config_size == 0) {
+            if(info.m_config_transfer == model_info::BULK)
+                info.m_config.assign(m_config_cache.m_buffer.data(), info.m_config_size);
+            // models forked from a reloaded one can then be registered by key
+            m_known_configs.insert(content_key(info.m_config));
+            return std::make_pair(FLAMESTORE_OK, std::move(info.m_config));
+        }
+        m_config_cache.m_buffer.resize(info.m_config_size);
+        std::vector<std::pair<void*, size_t>> mem(1,
+                {m_config_cache.m_buffer.data(), m_config_cache.m_buffer.size()});
+        m_config_cache.m_bulk = engine().expose(mem, tl::bulk_mode::write_only);
+    }
+    return Status(FLAMESTORE_EOTHER, "Could not fetch model config").move_to_pair();
+}
+
+model_info Client::stat_model(
+        const std::string& model_name)
+{
+    model_info info = m_rpc_stat_model
         .on(m_master_provider)(
             m_client_addr,
             model_name);
-    return status.move_to_pair();
+    return info;
+}
+
+Client::return_status Client::reload_model_data(
+        const std::string& model_name)
+{
+    // the data and the config come back inline if small enough, otherwise
+    // they are pushed into the model's cached buffer and m_config_cache,
+    // which are allocated (or grown) and the call retried if too small,
+    // as in reload_model
+    reload_result result;
+    for(int attempt = 0; attempt < 2; attempt++) {
+        tl::bulk bulk;
+        std::size_t capacity = 0;
+        auto cached_buffer = m_cache.find(model_name);
+        if(cached_buffer != m_cache.end() && !cached_buffer->second.m_bulk.is_null()) {
+            bulk     = cached_buffer->second.m_bulk;
+            capacity = cached_buffer->second.m_buffer.size();
+        }
+        result = m_rpc_reload_data
+            .on(m_master_provider)(
+                m_client_addr,
+                model_name,
+                bulk,
+                capacity,
+                m_config_cache.m_bulk,
+                m_config_cache.m_buffer.size(),
+                m_inline_threshold);
+        if(result.m_status.m_code != FLAMESTORE_OK)
+            break;
+        bool missing_data   = result.m_transfer == reload_result::NONE
+                           && result.m_size > m_inline_threshold;
+        bool missing_config = result.m_config_transfer == reload_result::NONE
+                           && result.m_config_size != 0;
+        if(!missing_data && !missing_config)
+            break;
+        if(missing_data) {
+            auto& buffer = m_cache[model_name];
+            buffer.m_buffer.resize(result.m_size);
+            std::vector<std::pair<void*, size_t>> mem(1,
+                    {buffer.m_buffer.data(), buffer.m_buffer.size()});
+            buffer.m_bulk = engine().expose(mem, tl::bulk_mode::read_write);
+        }
+        if(missing_config) {
+            m_config_cache.m_buffer.resize(result.m_config_size);
+            std::vector<std::pair<void*, size_t>> mem(1,
+                    {m_config_cache.m_buffer.data(), m_config_cache.m_buffer.size()});
+            m_config_cache.m_bulk = engine().expose(mem, tl::bulk_mode::write_only);
+        }
+    }
+    m_prefetched.erase(model_name);
+    if(result.m_status.m_code != FLAMESTORE_OK)
+        return result.m_status.move_to_pair();
+    if(result.m_config_transfer == reload_result::NONE && result.m_config_size != 0)
+        return Status(FLAMESTORE_EOTHER, "Could not fetch model config").move_to_pair();
+    if(result.m_transfer != reload_result::NONE) {
+        auto& prefetched = m_prefetched[model_name];
+        prefetched.m_signature = std::move(result.m_signature);
+        prefetched.m_size      = result.m_size;
+        prefetched.m_in_cache  = result.m_transfer == reload_result::BULK;
+        prefetched.m_data      = std::move(result.m_data);
+    }
+    if(result.m_config_transfer == reload_result::BULK)
+        result.m_config.assign(m_config_cache.m_buffer.data(), result.m_config_size);
+    m_known_configs.insert(content_key(result.m_config));
+    return std::make_pair(FLAMESTORE_OK, std::move(result.m_config));
 }
 
 Client::return_status Client::write_model_data(
@@ -61,6 +221,80 @@ Client::return_status Client::write_model_data(
         std::vector<std::pair<void*,size_t>>& memory,
         const std::size_t& size)
 {
+    m_prefetched.erase(model_name);
+    // a deferred registration is sent along with the data,
+    // unless the data does not match it
+    bool fused = false;
+    PendingRegistration registration;
+    auto pending = m_pending.find(model_name);
+    if(pending != m_pending.end()) {
+        registration = std::move(pending->second);
+        m_pending.erase(pending);
+        if(!m_batching && registration.m_signature == signature && registration.m_size == size
+        && registration.m_config.size() <= m_inline_threshold) {
+            fused = true;
+        } else {
+            auto status = register_model(model_name, registration.m_config,
+                                         registration.m_size, registration.m_signature);
+            if(status.first != FLAMESTORE_OK)
+                return status;
+        }
+    }
+
+    // like register_model, a successful registration tells us that the
+    // master has the config, so that the next models sharing it can be
+    // registered by key
+    auto registered_and_written = [this, &registration](Status status) {
+        if(status.m_code == FLAMESTORE_OK || status.m_code == FLAMESTORE_ESUPERSEDED)
+            m_known_configs.insert(content_key(registration.m_config));
+        return _written(std::move(status));
+    };
+
+    if(m_batching) {
+        batch_entry entry;
+        entry.m_name      = model_name;
+        entry.m_signature = signature;
+        entry.m_offset    = m_batch_buffer.size();
+        entry.m_size      = size;
+        m_batch_buffer.resize(entry.m_offset + size);
+        size_t offset = entry.m_offset;
+        for(auto& p : memory) {
+            std::memcpy(m_batch_buffer.data()+offset, p.first, p.second);
+            offset += p.second;
+        }
+        m_batch_entries.push_back(std::move(entry));
+        return Status::OK().copy_to_pair();
+    }
+
+    if(size <= m_inline_threshold) {
+        // small models: the data travels with the RPC, no bulk handle
+        std::vector<char> data(size);
+        size_t offset = 0;
+        for(auto& p : memory) {
+            std::memcpy(data.data()+offset, p.first, p.second);
+            offset += p.second;
+        }
+        if(fused) {
+            Status status = m_rpc_register_and_write
+                .on(m_master_provider)(
+                    m_client_addr,
+                    model_name,
+                    registration.m_config,
+                    registration.m_size,
+                    registration.m_signature,
+                    tl::bulk(),
+                    data);
+            return registered_and_written(std::move(status));
+        }
+        Status status = m_rpc_write_inline
+            .on(m_master_provider)(
+                m_client_addr,
+                model_name,
+                signature,
+                data);
+        return _written(std::move(status));
+    }
+
     auto& cached_buffer = m_cache[model_name];
     if(cached_buffer.m_bulk.is_null()
     || cached_buffer.m_buffer.size() != size) {
@@ -77,6 +311,19 @@ Client::return_status Client::write_model_data(
         offset += p.second;
     }
 
+    if(fused) {
+        Status status = m_rpc_register_and_write
+            .on(m_master_provider)(
+                m_client_addr,
+                model_name,
+                registration.m_config,
+                registration.m_size,
+                registration.m_signature,
+                cached_buffer.m_bulk,
+                std::vector<char>());
+        return registered_and_written(std::move(status));
+    }
+
     Status status = m_rpc_write_model
         .on(m_master_provider)(
             m_client_addr,
@@ -85,7 +332,7 @@ Client::return_status Client::write_model_data(
             cached_buffer.m_bulk,
             size);
 
-    return status.move_to_pair();
+    return _written(std::move(status));
 }
 
 Client::return_status Client::read_model_data(
@@ -94,6 +341,41 @@ Client::return_status Client::read_model_data(
         std::vector<std::pair<void*,size_t>>& memory,
         const std::size_t& size)
 {
+    // data fetched by reload_model_data
+    auto prefetched = m_prefetched.find(model_name);
+    if(prefetched != m_prefetched.end()) {
+        auto entry = std::move(prefetched->second);
+        m_prefetched.erase(prefetched);
+        if(entry.m_signature == signature && entry.m_size == size) {
+            const char* data = entry.m_in_cache
+                ? m_cache[model_name].m_buffer.data()
+                : entry.m_data.data();
+            size_t offset = 0;
+            for(auto& p : memory) {
+                std::memcpy(p.first, data+offset, p.second);
+                offset += p.second;
+            }
+            return Status::OK().copy_to_pair();
+        }
+    }
+
+    if(size <= m_inline_threshold) {
+        std::pair<Status, std::vector<char>> result = m_rpc_read_inline
+            .on(m_master_provider)(
+                m_client_addr,
+                model_name,
+                signature,
+                size);
+        auto& data = result.second;
+        size_t offset = 0;
+        for(auto& p : memory) {
+            if(offset >= data.size()) break;
+            std::memcpy(p.first, data.data()+offset, std::min(p.second, data.size()-offset));
+            offset += p.second;
+        }
+        return result.first.move_to_pair();
+    }
+
     auto& cached_buffer = m_cache[model_name];
     if(cached_buffer.m_bulk.is_null()
     || cached_buffer.m_buffer.size() != size) {
@@ -121,6 +403,86 @@ Client::return_status Client::read_model_data(
     return status.move_to_pair();
 }
 
+void Client::begin_batch()
+{
+    m_batching = true;
+    m_batch_entries.clear();
+    m_batch_buffer.clear();
+}
+
+void Client::abort_batch()
+{
+    m_batching = false;
+    m_batch_entries.clear();
+    m_batch_buffer.clear();
+}
+
+std::vector<Client::return_status> Client::end_batch(bool atomic)
+{
+    m_batching = false;
+    std::vector<return_status> result;
+    if(m_batch_entries.empty())
+        return result;
+    tl::bulk bulk;
+    if(!m_batch_buffer.empty()) {
+        std::vector<std::pair<void*, size_t>> mem(1, {m_batch_buffer.data(), m_batch_buffer.size()});
+        bulk = engine().expose(mem, tl::bulk_mode::read_only);
+    }
+    std::vector<Status> statuses = m_rpc_write_batch
+        .on(m_master_provider)(
+            m_client_addr,
+            m_batch_entries,
+            bulk,
+            atomic);
+    m_batch_entries.clear();
+    m_batch_buffer.clear();
+    result.reserve(statuses.size());
+    for(auto& s : statuses)
+        result.push_back(_written(std::move(s)));
+    return result;
+}
+
+std::vector<Client::return_status> Client::prefetch_models_data(
+        const std::vector<std::string>& model_names,
+        const std::vector<std::string>& signatures,
+        const std::vector<std::size_t>& sizes)
+{
+    std::vector<batch_entry> entries(model_names.size());
+    std::size_t total = 0;
+    for(std::size_t i = 0; i < entries.size(); i++) {
+        entries[i].m_name      = model_names[i];
+        entries[i].m_signature = signatures[i];
+        entries[i].m_offset    = total;
+        entries[i].m_size      = sizes[i];
+        total += sizes[i];
+    }
+    std::vector<char> buffer(total);
+    tl::bulk bulk;
+    if(total != 0) {
+        std::vector<std::pair<void*, size_t>> mem(1, {buffer.data(), buffer.size()});
+        bulk = engine().expose(mem, tl::bulk_mode::write_only);
+    }
+    std::vector<Status> statuses = m_rpc_read_batch
+        .on(m_master_provider)(
+            m_client_addr,
+            entries,
+            bulk);
+    std::vector<return_status> result;
+    result.reserve(statuses.size());
+    for(std::size_t i = 0; i < statuses.size() && i < entries.size(); i++) {
+        if(statuses[i].m_code == FLAMESTORE_OK) {
+            auto& prefetched = m_prefetched[entries[i].m_name];
+            prefetched.m_signature = entries[i].m_signature;
+            prefetched.m_size      = entries[i].m_size;
+            prefetched.m_in_cache  = false;
+            prefetched.m_data.assign(buffer.begin() + entries[i].m_offset,
+                                     buffer.begin() + entries[i].m_offset + entries[i].m_size);
+        }
+        result.push_back(statuses[i].move_to_pair());
+    }
+    return result;
+}
+
 Client::return_status Client::duplicate_model(
         const std::string& model_name,
         const std::string& new_model_name)
@@ -132,4 +494,54 @@ Client::return_status Client::duplicate_model(
     return status.move_to_pair();
 }
 
+std::vector<Client::return_status> Client::duplicate_many(
+        const std::string& model_name,
+        const std::vector<std::string>& new_model_names)
+{
+    std::vector<Status> statuses = m_rpc_dup_many
+        .on(m_master_provider)(
+            model_name,
+            new_model_names);
+    std::vector<return_status> result;
+    result.reserve(statuses.size());
+    for(auto& status : statuses)
+        result.push_back(status.move_to_pair());
+    return result;
+}
+
+list_page Client::list_models(
+        const list_query& query)
+{
+    list_page page = m_rpc_list_models
+        .on(m_master_provider)(query);
+    return page;
+}
+
+Client::return_status Client::set_model_tags(
+        const std::string& model_name,
+        const std::map<std::string, std::string>& tags)
+{
+    Status status = m_rpc_set_tags
+        .on(m_master_provider)(
+            model_name,
+            tags);
+    return status.move_to_pair();
+}
+
+Client::return_status Client::set_priority(uint32_t priority)
+{
+    Status status = m_rpc_set_priority
+        .on(m_master_provider)(
+            m_client_addr,
+            priority);
+    return status.move_to_pair();
+}
+
+Client::return_status Client::flush()
+{
+    Status status = m_rpc_flush
+        .on(m_master_provider)();
+    return status.move_to_pair();
+}
+
 }
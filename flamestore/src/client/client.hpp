@@ -4,9 +4,13 @@
 #include <iostream>
 #include <mutex>
 #include <map>
+#include <unordered_set>
 #include <thallium.hpp>
 #include "common/common.hpp"
 #include "common/status.hpp"
+#include "common/batch_entry.hpp"
+#include "common/model_info.hpp"
+#include "common/model_listing.hpp"
 
 namespace py11 = pybind11;
 namespace tl = thallium;
@@ -22,21 +26,72 @@ class Client {
         tl::bulk          m_bulk;
     };
 
+    struct PendingRegistration {
+        std::string       m_config;
+        std::size_t       m_size;
+        std::string       m_signature;
+    };
+
+    struct PrefetchedData {
+        std::string       m_signature;
+        std::size_t       m_size;
+        bool              m_in_cache; // data is in m_cache rather than m_data
+        std::vector<char> m_data;
+    };
+
     std::shared_ptr<tl::engine> m_engine;
     std::string                 m_client_addr;
     tl::remote_procedure        m_rpc_shutdown;
     tl::remote_procedure        m_rpc_register_model;
-    tl::remote_procedure        m_rpc_reload_model;
+    tl::remote_procedure        m_rpc_register_bulk;
+    tl::remote_procedure        m_rpc_register_by_key;
+    tl::remote_procedure        m_rpc_stat_model;
+    tl::remote_procedure        m_rpc_fetch_config;
+    tl::remote_procedure        m_rpc_register_and_write;
+    tl::remote_procedure        m_rpc_reload_data;
     tl::remote_procedure        m_rpc_write_model;
     tl::remote_procedure        m_rpc_read_model;
+    tl::remote_procedure        m_rpc_write_inline;
+    tl::remote_procedure        m_rpc_read_inline;
+    tl::remote_procedure        m_rpc_write_batch;
+    tl::remote_procedure        m_rpc_read_batch;
     tl::remote_procedure        m_rpc_dup_model;
+    tl::remote_procedure        m_rpc_dup_many;
+    tl::remote_procedure        m_rpc_list_models;
+    tl::remote_procedure        m_rpc_set_tags;
+    tl::remote_procedure        m_rpc_set_priority;
+    tl::remote_procedure        m_rpc_flush;
     tl::provider_handle         m_master_provider;
     std::unordered_map<std::string, CachedBulk> m_cache;
+    CachedBulk                  m_config_cache; // receives configs too large to be sent inline
+    std::unordered_set<std::string> m_known_configs; // content_keys of configs the master has
+    std::unordered_map<std::string, PendingRegistration> m_pending; // sent with the first write
+    std::unordered_map<std::string, PrefetchedData>      m_prefetched; // consumed by the next read
+    bool                        m_batching = false; // writes are buffered until end_batch
+    std::vector<batch_entry>    m_batch_entries;
+    std::vector<char>           m_batch_buffer;
+    std::size_t                 m_inline_threshold = 64*1024; // models up to this size skip RDMA
 
     public:
 
     using return_status = std::pair<int32_t, std::string>;
 
+    private:
+
+    /**
+     * @brief Converts the status of a write (plain, inline, fused with
+     * the registration or in a batch). A write superseded by a newer
+     * write of the same model, which succeeded, succeeded as far as the
+     * caller is concerned.
+     */
+    static return_status _written(Status status) {
+        if(status.m_code == FLAMESTORE_ESUPERSEDED)
+            status = Status::OK("Superseded by a newer write");
+        return status.move_to_pair();
+    }
+
+    public:
+
     Client(pymargo_instance_id mid, const std::string& configfile);
 
     tl::engine& engine() {
@@ -81,12 +136,39 @@ class Client {
             std::size_t model_data_size,
             const std::string& model_signature);
 
+    /**
+     * @brief This function is exposed to Python. The registration
+     * is sent along with the data by the next write_model_data call
+     * for this model, in a single RPC.
+     */
+    void defer_register_model(
+            const std::string& model_name,
+            const std::string& model_config,
+            std::size_t model_data_size,
+            const std::string& model_signature);
+
     /**
      * @brief This function is exposed to Python.
      */
     return_status reload_model(
             const std::string& model_name);
 
+    /**
+     * @brief This function is exposed to Python. Returns the size,
+     * signature and version of a model, without its configuration.
+     */
+    model_info stat_model(
+            const std::string& model_name);
+
+    /**
+     * @brief This function is exposed to Python. Same as reload_model,
+     * but also fetches the model's data, sent inline or pushed into a
+     * buffer cached for this model (allocated when needed). The data is
+     * kept until the next read_model_data call for this model.
+     */
+    return_status reload_model_data(
+            const std::string& model_name);
+
     /**
      * @brief This function is exposed to Python.
      */
@@ -94,6 +176,86 @@ class Client {
             const std::string& model_name,
             const std::string& new_model_name);
 
+    /**
+     * @brief This function is exposed to Python.
+     */
+    std::vector<return_status> duplicate_many(
+            const std::string& model_name,
+            const std::vector<std::string>& new_model_names);
+
+    /**
+     * @brief This function is exposed to Python. Returns one page of
+     * the models matching the query; the next page is obtained by
+     * setting query.m_after to the returned page's m_next.
+     */
+    list_page list_models(
+            const list_query& query);
+
+    /**
+     * @brief This function is exposed to Python.
+     */
+    return_status set_model_tags(
+            const std::string& model_name,
+            const std::map<std::string, std::string>& tags);
+
+    /**
+     * @brief This function is exposed to Python. Sets the priority
+     * of this client in the master's scheduler.
+     */
+    return_status set_priority(uint32_t priority);
+
+    /**
+     * @brief This function is exposed to Python.
+     */
+    return_status flush();
+
+    /**
+     * @brief This function is exposed to Python. The write_model_data
+     * calls that follow only buffer the data, which is sent for all
+     * the models in a single RPC by end_batch.
+     */
+    void begin_batch();
+
+    /**
+     * @brief This function is exposed to Python. Sends the data buffered
+     * since begin_batch and returns a status per model, in the order of
+     * the writes. If atomic is true, either all the models are
+     * committed or none is.
+     */
+    std::vector<return_status> end_batch(bool atomic);
+
+    /**
+     * @brief This function is exposed to Python. Discards
+     * the data buffered since begin_batch.
+     */
+    void abort_batch();
+
+    /**
+     * @brief This function is exposed to Python. Fetches the data of
+     * several models in a single RPC; it is kept until the next
+     * read_model_data call for each model.
+     */
+    std::vector<return_status> prefetch_models_data(
+            const std::vector<std::string>& model_names,
+            const std::vector<std::string>& signatures,
+            const std::vector<std::size_t>& sizes);
+
+    /**
+     * @brief This function is exposed to Python. Models of at most
+     * this size (in bytes) have their data sent in the RPCs instead
+     * of being exposed for RDMA. 0 disables the inline path.
+     */
+    void set_inline_threshold(std::size_t threshold) {
+        m_inline_threshold = threshold;
+    }
+
+    /**
+     * @brief This function is exposed to Python.
+     */
+    std::size_t get_inline_threshold() const {
+        return m_inline_threshold;
+    }
+
     /**
      * This function is used by TMCI.
      */
@@ -1,4 +1,5 @@
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 #include "client.hpp"
 
 namespace py11 = pybind11;
@@ -14,10 +15,75 @@ PYBIND11_MODULE(_flamestore_client, m) {
                 "Shuts down the FlameStore service.")
         .def("_register_model", &flamestore::Client::register_model,
                 "Registers a model.")
-        .def("_reload_model", &flamestore::Client::reload_model,
-                "Reloads a model.")
+        .def("_reload_model",
+                [](flamestore::Client& client, const std::string& model_name) {
+                    auto r = client.reload_model(model_name);
+                    return py11::make_tuple(r.first, py11::bytes(r.second));
+                },
+                "Reloads a model (the config is returned as bytes).")
+        .def("_stat_model",
+                [](flamestore::Client& client, const std::string& model_name) {
+                    auto info = client.stat_model(model_name);
+                    return py11::make_tuple(info.m_status.m_code, info.m_status.m_message,
+                            info.m_size, info.m_signature, info.m_version, info.m_config_size);
+                },
+                "Gets the size, signature and version of a model.")
+        .def("_defer_register_model", &flamestore::Client::defer_register_model,
+                "Registers a model along with the next write of its data.")
+        .def("_reload_model_data",
+                [](flamestore::Client& client, const std::string& model_name) {
+                    auto r = client.reload_model_data(model_name);
+                    return py11::make_tuple(r.first, py11::bytes(r.second));
+                },
+                "Reloads a model and prefetches its data.")
         .def("_duplicate_model", &flamestore::Client::duplicate_model,
                 "Duplicates a model.")
+        .def("_duplicate_many", &flamestore::Client::duplicate_many,
+                "Duplicates a model into several new models.")
+        .def("_list_models",
+                [](flamestore::Client& client,
+                   const std::string& prefix, const std::string& start,
+                   const std::string& end, const std::string& after,
+                   const std::string& signature,
+                   std::size_t min_size, std::size_t max_size,
+                   const std::map<std::string, std::string>& tags,
+                   uint32_t page_size) {
+                    flamestore::list_query query;
+                    query.m_prefix    = prefix;
+                    query.m_start     = start;
+                    query.m_end       = end;
+                    query.m_after     = after;
+                    query.m_signature = signature;
+                    query.m_min_size  = min_size;
+                    query.m_max_size  = max_size;
+                    query.m_tags      = tags;
+                    query.m_page_size = page_size;
+                    auto page = client.list_models(query);
+                    py11::list models;
+                    for(const auto& m : page.m_models)
+                        models.append(py11::make_tuple(m.m_name, m.m_signature, m.m_size, m.m_tags));
+                    return py11::make_tuple(page.m_status.m_code, page.m_status.m_message,
+                            models, page.m_next);
+                },
+                "Lists a page of the models matching a query.")
+        .def("_set_model_tags", &flamestore::Client::set_model_tags,
+                "Sets the tags of a model.")
+        .def("_set_priority", &flamestore::Client::set_priority,
+                "Sets the priority of the client in the master's scheduler.")
+        .def("_flush", &flamestore::Client::flush,
+                "Waits for all the written data to be persisted.")
+        .def("_begin_batch", &flamestore::Client::begin_batch,
+                "Starts buffering model writes.")
+        .def("_end_batch", &flamestore::Client::end_batch,
+                "Sends the buffered model writes in a single request.")
+        .def("_abort_batch", &flamestore::Client::abort_batch,
+                "Discards the buffered model writes.")
+        .def("_prefetch_models_data", &flamestore::Client::prefetch_models_data,
+                "Fetches the data of several models in a single request.")
+        .def("_set_inline_threshold", &flamestore::Client::set_inline_threshold,
+                "Sets the size up to which model data is sent inline.")
+        .def("_get_inline_threshold", &flamestore::Client::get_inline_threshold,
+                "Gets the size up to which model data is sent inline.")
         .def("_cleanup_hg_resources", &flamestore::Client::cleanup_hg_resources,
                 "Cleanup internal HG resources")
         ;
@@ -0,0 +1,44 @@
+#ifndef __FLAMESTORE_BATCH_ENTRY_H
+#define __FLAMESTORE_BATCH_ENTRY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thallium/serialization/stl/string.hpp>
+
+namespace flamestore {
+
+/**
+ * @brief Model of a batched write or read (flamestore_write_model_batch,
+ * flamestore_read_model_batch). The data of all the models of a batch
+ * is in a single bulk handle, each model at its own offset.
+ */
+struct batch_entry {
+
+    std::string m_name;
+    std::string m_signature;
+    std::size_t m_offset = 0; // offset of the model's data in the bulk handle
+    std::size_t m_size   = 0; // size of the model's data
+
+    template<typename A>
+    void serialize(A& ar) {
+        ar & m_name;
+        ar & m_signature;
+        ar & m_offset;
+        ar & m_size;
+    }
+};
+
+/**
+ * @brief Total size of the models of a batch.
+ */
+inline std::size_t batch_bytes(const std::vector<batch_entry>& entries) {
+    std::size_t bytes = 0;
+    for(const auto& e : entries)
+        bytes += e.m_size;
+    return bytes;
+}
+
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef __FLAMESTORE_CONTENT_KEY_H
+#define __FLAMESTORE_CONTENT_KEY_H
+
+#include <cstdint>
+#include <string>
+#include "common/sha256.hpp"
+
+namespace flamestore {
+
+/**
+ * @brief Computes the key identifying a blob (e.g. a model configuration)
+ * by its content: the SHA-256 digest of the blob followed by its size,
+ * both in hexadecimal. A server may substitute the blob it stores under
+ * a key for the one a client meant, so the key must be collision
+ * resistant, and clients and servers must compute the same key.
+ */
+inline std::string content_key(const std::string& data) {
+    static const char digits[] = "0123456789abcdef";
+    std::string key = sha256_hex(data);
+    key.push_back('-');
+    uint64_t size = data.size();
+    std::string size_str;
+    do {
+        size_str.insert(size_str.begin(), digits[size & 0x0f]);
+        size >>= 4;
+    } while(size != 0);
+    return key + size_str;
+}
+
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef __FLAMESTORE_MODEL_INFO_H
+#define __FLAMESTORE_MODEL_INFO_H
+
+#include <cstdint>
+#include <string>
+#include <thallium/serialization/stl/string.hpp>
+#include "common/status.hpp"
+
+namespace flamestore {
+
+/**
+ * @brief Response of the flamestore_stat_model and
+ * flamestore_fetch_model_config RPCs. The configuration is opaque to
+ * the server (the Python client stores it compressed).
+ */
+struct model_info {
+
+    enum transfer_t : uint8_t {
+        NONE   = 0, // the config was not sent (stat, or no large enough buffer)
+        INLINE = 1, // the config is in m_config
+        BULK   = 2  // the config was pushed into the client's bulk handle
+    };
+
+    Status      m_status;
+    std::string m_signature;
+    std::size_t m_size = 0;        // size of the model data
+    uint64_t    m_version = 0;     // number of writes acknowledged so far
+    std::size_t m_config_size = 0;
+    uint8_t     m_config_transfer = NONE;
+    std::string m_config;
+
+    template<typename A>
+    void serialize(A& ar) {
+        ar & m_status;
+        ar & m_signature;
+        ar & m_size;
+        ar & m_version;
+        ar & m_config_size;
+        ar & m_config_transfer;
+        ar & m_config;
+    }
+};
+
+}
+
+#endif
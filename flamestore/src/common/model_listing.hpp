@@ -0,0 +1,119 @@
+#ifndef __FLAMESTORE_MODEL_LISTING_H
+#define __FLAMESTORE_MODEL_LISTING_H
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <thallium/serialization/stl/map.hpp>
+#include <thallium/serialization/stl/string.hpp>
+#include <thallium/serialization/stl/vector.hpp>
+#include "common/status.hpp"
+
+namespace flamestore {
+
+/**
+ * @brief Query of the flamestore_list_models RPC. Models are listed in
+ * name order; each call returns a page of at most m_page_size models
+ * along with a continuation token to pass as m_after for the next page.
+ */
+struct list_query {
+
+    std::string m_prefix;        // only names starting with the prefix
+    std::string m_start;         // only names >= m_start
+    std::string m_end;           // only names < m_end (empty for no bound)
+    std::string m_after;         // continuation token (only names > m_after)
+    std::string m_signature;     // only models with this signature (empty for any)
+    std::size_t m_min_size = 0;  // only models with at least this size
+    std::size_t m_max_size = 0;  // only models with at most this size (0 for no bound)
+    std::map<std::string, std::string> m_tags; // only models with all these tags
+    uint32_t    m_page_size = 1000;
+
+    template<typename A>
+    void serialize(A& ar) {
+        ar & m_prefix;
+        ar & m_start;
+        ar & m_end;
+        ar & m_after;
+        ar & m_signature;
+        ar & m_min_size;
+        ar & m_max_size;
+        ar & m_tags;
+        ar & m_page_size;
+    }
+
+    /**
+     * @brief Smallest name that may be part of the result.
+     */
+    std::string first_name() const {
+        std::string first = std::max(m_prefix, m_start);
+        if(!m_after.empty() && m_after >= first)
+            first = m_after + '\0'; // smallest name after m_after
+        return first;
+    }
+
+    /**
+     * @brief Whether a name (visited in order from first_name)
+     * is past the range of the query.
+     */
+    bool past_end(const std::string& name) const {
+        if(!m_end.empty() && name >= m_end) return true;
+        return name.compare(0, m_prefix.size(), m_prefix) != 0;
+    }
+
+    /**
+     * @brief Whether a model in the range matches the filters.
+     */
+    bool matches(const std::string& signature, std::size_t size,
+                 const std::map<std::string, std::string>& tags) const {
+        if(!m_signature.empty() && signature != m_signature) return false;
+        if(size < m_min_size) return false;
+        if(m_max_size != 0 && size > m_max_size) return false;
+        for(const auto& t : m_tags) {
+            auto it = tags.find(t.first);
+            if(it == tags.end() || it->second != t.second) return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Model returned by flamestore_list_models.
+ */
+struct model_summary {
+
+    std::string m_name;
+    std::string m_signature;
+    std::size_t m_size = 0;
+    std::map<std::string, std::string> m_tags;
+
+    template<typename A>
+    void serialize(A& ar) {
+        ar & m_name;
+        ar & m_signature;
+        ar & m_size;
+        ar & m_tags;
+    }
+};
+
+/**
+ * @brief Response of flamestore_list_models.
+ */
+struct list_page {
+
+    Status                     m_status;
+    std::vector<model_summary> m_models;
+    std::string                m_next; // continuation token, empty if this is the last page
+
+    template<typename A>
+    void serialize(A& ar) {
+        ar & m_status;
+        ar & m_models;
+        ar & m_next;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef __FLAMESTORE_RELOAD_RESULT_H
+#define __FLAMESTORE_RELOAD_RESULT_H
+
+#include <cstdint>
+#include <vector>
+#include <thallium/serialization/stl/string.hpp>
+#include <thallium/serialization/stl/vector.hpp>
+#include "common/status.hpp"
+
+namespace flamestore {
+
+/**
+ * @brief Response of the flamestore_reload_model_data RPC, which
+ * returns the configuration of a model along with its data. The
+ * configuration is sent like in model_info (m_config_transfer uses
+ * the same values as m_transfer).
+ */
+struct reload_result {
+
+    enum transfer_t : uint8_t {
+        NONE   = 0, // the data was not sent (e.g. no large enough buffer)
+        INLINE = 1, // the data is in m_data
+        BULK   = 2  // the data was pushed into the client's bulk handle
+    };
+
+    Status            m_status;
+    std::string       m_signature;
+    std::size_t       m_size = 0;    // size of the model data
+    uint8_t           m_transfer = NONE;
+    std::vector<char> m_data;
+    std::size_t       m_config_size = 0;
+    uint8_t           m_config_transfer = NONE;
+    std::string       m_config;
+
+    template<typename A>
+    void serialize(A& ar) {
+        ar & m_status;
+        ar & m_signature;
+        ar & m_size;
+        ar & m_transfer;
+        ar & m_data;
+        ar & m_config_size;
+        ar & m_config_transfer;
+        ar & m_config;
+    }
+};
+
+}
+
+#endif
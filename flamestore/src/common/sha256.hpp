@@ -0,0 +1,125 @@
+#ifndef __FLAMESTORE_SHA256_H
+#define __FLAMESTORE_SHA256_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace flamestore {
+
+/**
+ * @brief Incremental SHA-256 (FIPS 180-4), used to identify blobs by
+ * their content. Header-only so that clients and servers compute the
+ * same digests without an additional dependency.
+ */
+class Sha256 {
+
+    public:
+
+        Sha256() = default;
+
+        /**
+         * @brief Adds size bytes to the message.
+         */
+        void update(const void* data, std::size_t size) {
+            auto bytes = static_cast<const uint8_t*>(data);
+            m_length += size;
+            if(m_buffered != 0) {
+                auto n = std::min<std::size_t>(size, 64 - m_buffered);
+                std::memcpy(m_buffer + m_buffered, bytes, n);
+                m_buffered += n;
+                bytes += n;
+                size  -= n;
+                if(m_buffered < 64) return;
+                _compress(m_buffer);
+                m_buffered = 0;
+            }
+            for(; size >= 64; bytes += 64, size -= 64)
+                _compress(bytes);
+            std::memcpy(m_buffer, bytes, size);
+            m_buffered = size;
+        }
+
+        /**
+         * @brief Pads the message and returns its digest in lowercase
+         * hexadecimal. The object must not be updated afterwards.
+         */
+        std::string hex_digest() {
+            static const char digits[] = "0123456789abcdef";
+            uint64_t bits = m_length * 8;
+            uint8_t padding[72] = { 0x80 };
+            std::size_t padding_size = (m_buffered < 56 ? 56 : 120) - m_buffered;
+            for(int i = 0; i < 8; i++)
+                padding[padding_size + i] = (uint8_t)(bits >> (56 - 8*i));
+            update(padding, padding_size + 8);
+            std::string result;
+            result.reserve(64);
+            for(auto h : m_state)
+                for(int shift = 28; shift >= 0; shift -= 4)
+                    result.push_back(digits[(h >> shift) & 0x0f]);
+            return result;
+        }
+
+    private:
+
+        uint32_t    m_state[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        uint8_t     m_buffer[64];
+        std::size_t m_buffered = 0;
+        uint64_t    m_length = 0;
+
+        static uint32_t _rotr(uint32_t x, int n) {
+            return (x >> n) | (x << (32 - n));
+        }
+
+        void _compress(const uint8_t* block) {
+            static const uint32_t k[64] = {
+                0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+            };
+            uint32_t w[64];
+            for(int i = 0; i < 16; i++)
+                w[i] = (uint32_t)block[4*i] << 24 | (uint32_t)block[4*i+1] << 16
+                     | (uint32_t)block[4*i+2] << 8 | (uint32_t)block[4*i+3];
+            for(int i = 16; i < 64; i++) {
+                uint32_t s0 = _rotr(w[i-15], 7) ^ _rotr(w[i-15], 18) ^ (w[i-15] >> 3);
+                uint32_t s1 = _rotr(w[i-2], 17) ^ _rotr(w[i-2], 19) ^ (w[i-2] >> 10);
+                w[i] = w[i-16] + s0 + w[i-7] + s1;
+            }
+            uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+            uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+            for(int i = 0; i < 64; i++) {
+                uint32_t t1 = h + (_rotr(e, 6) ^ _rotr(e, 11) ^ _rotr(e, 25))
+                            + ((e & f) ^ (~e & g)) + k[i] + w[i];
+                uint32_t t2 = (_rotr(a, 2) ^ _rotr(a, 13) ^ _rotr(a, 22))
+                            + ((a & b) ^ (a & c) ^ (b & c));
+                h = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t2;
+            }
+            m_state[0] += a; m_state[1] += b; m_state[2] += c; m_state[3] += d;
+            m_state[4] += e; m_state[5] += f; m_state[6] += g; m_state[7] += h;
+        }
+};
+
+/**
+ * @brief SHA-256 digest of a string, in lowercase hexadecimal.
+ */
+inline std::string sha256_hex(const std::string& data) {
+    Sha256 sha;
+    sha.update(data.data(), data.size());
+    return sha.hex_digest();
+}
+
+}
+
+#endif
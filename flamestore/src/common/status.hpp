@@ -50,7 +50,13 @@ enum StatusCode {
     FLAMESTORE_EIO        = 5,
     FLAMESTORE_EBACKEND   = 6,
     FLAMESTORE_EBAKE      = 7,
-    FLAMESTORE_EOTHER
+    FLAMESTORE_EOTHER     = 8,
+    // codes added later are appended, so that existing ones keep their value
+    FLAMESTORE_ENOSPACE   = 9,
+    FLAMESTORE_ENOCONFIG  = 10,
+    FLAMESTORE_ESUPERSEDED = 11, // a newer write of the model succeeded
+    FLAMESTORE_EINVAL     = 12,  // invalid argument (e.g. wrong model size)
+    FLAMESTORE_ECOPY      = 13   // the model is a duplicate whose copy failed
 };
 
 }
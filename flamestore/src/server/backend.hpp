@@ -1,13 +1,29 @@
 #ifndef __FLAMESTORE_BACKEND
 #define __FLAMESTORE_BACKEND
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <unordered_map>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <utility>
+#include <thallium/serialization/stl/map.hpp>
+#include <thallium/serialization/stl/pair.hpp>
+#include <thallium/serialization/stl/string.hpp>
+#include <thallium/serialization/stl/vector.hpp>
 #include <spdlog/spdlog.h>
 #include <thallium.hpp>
 #include "common/status.hpp"
+#include "common/reload_result.hpp"
+#include "common/batch_entry.hpp"
+#include "common/model_info.hpp"
+#include "common/model_listing.hpp"
 #include "server/server_context.hpp"
+#include "server/scheduler.hpp"
+#include "server/storage_stats.hpp"
 
 namespace flamestore {
 
@@ -36,6 +52,117 @@ class AbstractServerBackend {
 
         AbstractServerBackend() = default;
 
+        /**
+         * @brief Admits a checkpoint with the scheduler of the server
+         * (right away if there is none, see ServerContext::m_scheduler).
+         * Writes call this once they know they may proceed (see
+         * pending_writes), just before moving data, so that superseded
+         * or parked writes never wait for admission.
+         */
+        static Scheduler::ticket _admit_checkpoint(Scheduler* scheduler,
+                const tl::request& req, std::size_t bytes) {
+            if(!scheduler) return Scheduler::ticket();
+            return scheduler->admit(Scheduler::CHECKPOINT, Scheduler::client_of(req), bytes);
+        }
+
+        /**
+         * @brief Same as above for a write holding the lock of its model.
+         * The lock is released while the request is queued, so that the
+         * requests admitted before it can still lock the model to complete.
+         *
+         * @param waited Set to true if the lock was released, in which
+         * case the caller must check the state of the model again.
+         */
+        static Scheduler::ticket _admit_checkpoint(Scheduler* scheduler,
+                const tl::request& req, std::size_t bytes,
+                std::unique_lock<tl::mutex>& lock, bool& waited) {
+            Scheduler::ticket ticket;
+            waited = false;
+            if(!scheduler)
+                return ticket;
+            auto client = Scheduler::client_of(req);
+            if(scheduler->try_admit(Scheduler::CHECKPOINT, client, bytes, ticket))
+                return ticket;
+            waited = true;
+            lock.unlock();
+            ticket = scheduler->admit(Scheduler::CHECKPOINT, client, bytes);
+            lock.lock();
+            return ticket;
+        }
+
+        /**
+         * @brief Sets the configuration fields of a model_info (for
+         * get_model_info) or of a reload_result: sends the configuration
+         * inline or pushes it into the client's bulk handle, depending on
+         * its size.
+         */
+        template<typename Info>
+        static void _attach_config(Info& info,
+                const std::string& config,
+                tl::engine& engine,
+                const tl::request& req,
+                const tl::bulk& remote_bulk,
+                std::size_t capacity,
+                std::size_t max_inline) {
+            info.m_config_size = config.size();
+            if(config.size() <= max_inline && max_inline != 0) {
+                info.m_config = config;
+                info.m_config_transfer = Info::INLINE;
+            } else if(!remote_bulk.is_null() && config.size() <= capacity && !config.empty()) {
+                std::vector<std::pair<void*, std::size_t>> segment(1,
+                        {const_cast<char*>(config.data()), config.size()});
+                auto local_bulk = engine.expose(segment, tl::bulk_mode::read_only);
+                local_bulk >> remote_bulk.on(req.get_endpoint()).select(0, config.size());
+                info.m_config_transfer = Info::BULK;
+            }
+        }
+
+        /**
+         * @brief Lists a page of the models of an ordered map of
+         * flamestore_model (indexed by name). The map is only locked
+         * while collecting the names of the page; the filters are then
+         * applied under each model's own lock. A page may therefore hold
+         * fewer than m_page_size models even if it is not the last one.
+         *
+         * @param models Map of models
+         * @param models_lock Lock protecting the map
+         * @param query Query
+         * @param size_of Function returning the size of a model (called
+         * with the model locked)
+         */
+        template<typename Map, typename SizeOf>
+        static list_page _list_page(const Map& models,
+                tl::rwlock& models_lock,
+                const list_query& query,
+                SizeOf&& size_of) {
+            list_page page;
+            std::size_t page_size = std::max<std::size_t>(query.m_page_size, 1);
+            std::vector<typename Map::mapped_type::pointer> candidates;
+            candidates.reserve(std::min<std::size_t>(page_size, 1024));
+            models_lock.rdlock();
+            auto it = models.lower_bound(query.first_name());
+            for(; it != models.end() && candidates.size() < page_size; ++it) {
+                if(query.past_end(it->first)) break;
+                candidates.push_back(it->second.get());
+            }
+            if(it != models.end() && !query.past_end(it->first))
+                page.m_next = std::prev(it)->first;
+            models_lock.unlock();
+            for(auto model : candidates) {
+                std::lock_guard<tl::mutex> guard(model->m_mutex);
+                std::size_t size = size_of(*model);
+                if(!query.matches(model->m_model_signature, size, model->m_tags))
+                    continue;
+                model_summary summary;
+                summary.m_name      = model->m_name;
+                summary.m_signature = model->m_model_signature;
+                summary.m_size      = size;
+                summary.m_tags      = model->m_tags;
+                page.m_models.push_back(std::move(summary));
+            }
+            return page;
+        }
+
     public:
 
 
@@ -74,6 +201,22 @@ class AbstractServerBackend {
                 const std::string& client_addr,
                 const std::string& model_name) = 0;
 
+        /**
+         * @brief Responds with the model_info of a model (size, signature,
+         * version and configuration size). The configuration itself is
+         * sent inline if it is at most max_inline bytes, pushed into the
+         * remote bulk handle if it fits in its capacity, and not sent
+         * otherwise (a stat is a call with a null bulk handle and
+         * max_inline set to 0).
+         */
+        virtual void get_model_info(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const tl::bulk& remote_bulk,
+                const std::size_t& capacity,
+                const std::size_t& max_inline) = 0;
+
         virtual void write_model(
                 const tl::request& req,
                 const std::string& client_addr,
@@ -82,6 +225,40 @@ class AbstractServerBackend {
                 const tl::bulk& remote_bulk,
                 const std::size_t& size) = 0;
 
+        /**
+         * @brief Registers a model and writes its first version in a
+         * single request, responding with a single Status. The data is
+         * either in the data argument (small models) or pulled from the
+         * remote bulk handle (if data is empty). The write is admitted as
+         * a checkpoint of model_size bytes, as write_model would be.
+         */
+        virtual void register_and_write_model(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const std::string& model_config,
+                std::size_t& model_size,
+                const std::string& model_signature,
+                const tl::bulk& remote_bulk,
+                const std::vector<char>& data) = 0;
+
+        /**
+         * @brief Returns the configuration of a model along with its
+         * data, as a reload_result. The data is sent inline if it is at
+         * most max_inline bytes, pushed into the remote bulk handle if it
+         * fits in its capacity, and not sent otherwise. The configuration
+         * is sent the same way, using config_bulk (see _attach_config).
+         */
+        virtual void reload_model_data(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const tl::bulk& remote_bulk,
+                const std::size_t& capacity,
+                const tl::bulk& config_bulk,
+                const std::size_t& config_capacity,
+                const std::size_t& max_inline) = 0;
+
         virtual void read_model(
                 const tl::request& req,
                 const std::string& client_addr,
@@ -90,17 +267,186 @@ class AbstractServerBackend {
                 const tl::bulk& remote_bulk,
                 const std::size_t& size) = 0;
 
+        /**
+         * @brief Same as write_model for small models, whose data
+         * is sent in the RPC arguments instead of through RDMA.
+         *
+         * @param req Thallium request
+         * @param client_addr Address of the client
+         * @param model_name Name of the model
+         * @param model_signature Signature of the model
+         * @param data Model data
+         */
+        virtual void write_model_inline(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const std::string& model_signature,
+                const std::vector<char>& data) = 0;
+
+        /**
+         * @brief Same as read_model for small models, whose data is sent
+         * back in the RPC response, along with the Status, as a
+         * std::pair<Status, std::vector<char>> (the data is empty in
+         * case of error).
+         *
+         * @param req Thallium request
+         * @param client_addr Address of the client
+         * @param model_name Name of the model
+         * @param model_signature Signature of the model
+         * @param size Size of the model data, in bytes
+         */
+        virtual void read_model_inline(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const std::string& model_signature,
+                const std::size_t& size) = 0;
+
+        /**
+         * @brief Writes the data of several models, all exposed by the
+         * client in a single bulk handle, responding with a
+         * std::vector<Status> (one per entry).
+         *
+         * @param req Thallium request
+         * @param client_addr Address of the client
+         * @param entries Models to write
+         * @param remote_bulk Bulk handle pointing to the models' memory
+         * @param atomic If true, no model is committed unless all can be
+         */
+        virtual void write_model_batch(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::vector<batch_entry>& entries,
+                const tl::bulk& remote_bulk,
+                bool atomic) = 0;
+
+        /**
+         * @brief Reads the data of several models into a single bulk
+         * handle, responding with a std::vector<Status>.
+         *
+         * @param req Thallium request
+         * @param client_addr Address of the client
+         * @param entries Models to read
+         * @param remote_bulk Bulk handle pointing to the models' memory
+         */
+        virtual void read_model_batch(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::vector<batch_entry>& entries,
+                const tl::bulk& remote_bulk) = 0;
+
+        /**
+         * @brief Responds with a list_page of the models matching
+         * the query, in name order.
+         *
+         * @param req Thallium request
+         * @param query Query
+         */
+        virtual void list_models(
+                const tl::request& req,
+                const list_query& query) = 0;
+
+        /**
+         * @brief Sets the user tags of a model (replacing its previous
+         * tags). Tags can be used to filter list_models queries.
+         *
+         * @param req Thallium request
+         * @param model_name Name of the model
+         * @param tags Tags
+         */
+        virtual void set_model_tags(
+                const tl::request& req,
+                const std::string& model_name,
+                const std::map<std::string, std::string>& tags) = 0;
+
         virtual void duplicate_model(
                 const tl::request& req,
                 const std::string& model_name,
                 const std::string& new_model_name) = 0;
 
+        /**
+         * @brief Duplicates a model into several new models (e.g. to fork
+         * the best model of a population). Responds with one Status per
+         * new model, in the order of the provided names.
+         *
+         * @param req Thallium request
+         * @param model_name Name of the model to duplicate
+         * @param new_model_names Names of the new models
+         */
+        virtual void duplicate_many(
+                const tl::request& req,
+                const std::string& model_name,
+                const std::vector<std::string>& new_model_names) = 0;
+
+        /**
+         * @brief Barrier for the end of a job: responds once all the
+         * writes acknowledged so far have reached persistent storage.
+         * Backends that acknowledge writes before persisting them must
+         * report the failures that happened in the background.
+         *
+         * @param req Thallium request
+         */
+        virtual void flush(
+                const tl::request& req) {
+            req.respond(Status::OK());
+        }
+
+        /**
+         * @brief Called when a storage server wants to leave gracefully.
+         * Backends that place data on storage servers should move it
+         * elsewhere before responding.
+         *
+         * @param req Thallium request
+         * @param worker_addr Address of the storage server
+         */
+        virtual void drain_worker(
+                const tl::request& req,
+                const std::string& worker_addr) {
+            req.respond(Status::OK());
+        }
+
+        /**
+         * @brief Responds with a map of counters describing the
+         * activity of the backend (e.g. cache hit rates).
+         *
+         * @param req Thallium request
+         */
+        virtual void get_stats(
+                const tl::request& req) {
+            req.respond(std::map<std::string, uint64_t>());
+        }
+
+        /**
+         * @brief Called with the load report periodically pushed by each
+         * storage server. Backends that place data on storage servers
+         * can use it to avoid overloaded or full targets.
+         *
+         * @param report Report of the storage server
+         */
+        virtual void on_storage_report(
+                const storage_report& report) {}
+
         virtual void on_shutdown() {}
 
         virtual void on_worker_joined(
                 uint64_t member_id,
                 hg_addr_t addr) {}
 
+        /**
+         * @brief Called with storage servers that joined the group at
+         * about the same time (e.g. when a job starts). Backends that
+         * contact new storage servers should override it to do so in
+         * parallel. The addresses are only valid during the call.
+         *
+         * @param workers Member ids and addresses of the storage servers
+         */
+        virtual void on_workers_joined(
+                const std::vector<std::pair<uint64_t, hg_addr_t>>& workers) {
+            for(const auto& w : workers)
+                on_worker_joined(w.first, w.second);
+        }
+
         virtual void on_worker_left(
                 uint64_t member_id) {}
 
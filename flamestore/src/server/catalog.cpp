@@ -0,0 +1,224 @@
+#include "server/catalog.hpp"
+#include <ctime>
+#include <vector>
+
+namespace flamestore {
+
+static const char* s_db_name = "flamestore-catalog";
+
+Catalog::Catalog(tl::engine& engine, spdlog::logger* logger,
+        const std::string& path, const std::string& type,
+        unsigned flush_interval_ms)
+: m_engine(engine)
+, m_logger(logger)
+, m_flush_interval_ms(flush_interval_ms) {
+    sdskv_db_type_t db_type;
+    if(type == "leveldb")         db_type = KVDB_LEVELDB;
+    else if(type == "berkeleydb") db_type = KVDB_BERKELEYDB;
+    else if(type == "map")        db_type = KVDB_MAP;
+    else {
+        m_logger->critical("Unknown catalog database type \"{}\"", type);
+        throw std::runtime_error("Unknown catalog database type "+type);
+    }
+    int ret = sdskv_provider_register(m_engine.get_margo_instance(),
+            s_provider_id, SDSKV_ABT_POOL_DEFAULT, &m_provider);
+    if(ret != SDSKV_SUCCESS) {
+        m_logger->critical("Could not register SDSKV provider (sdskv_provider_register returned {})", ret);
+        throw std::runtime_error("Could not register SDSKV provider");
+    }
+    sdskv_config_t config = SDSKV_CONFIG_DEFAULT;
+    config.db_name = s_db_name;
+    config.db_path = path.c_str();
+    config.db_type = db_type;
+    ret = sdskv_provider_attach_database(m_provider, &config, &m_db_id);
+    if(ret != SDSKV_SUCCESS) {
+        m_logger->critical("Could not attach catalog database in {} (sdskv_provider_attach_database returned {})",
+                path, ret);
+        throw std::runtime_error("Could not attach catalog database");
+    }
+    ret = sdskv_client_init(m_engine.get_margo_instance(), &m_client);
+    if(ret != SDSKV_SUCCESS) {
+        m_logger->critical("Could not initialize SDSKV client (sdskv_client_init returned {})", ret);
+        throw std::runtime_error("Could not initialize SDSKV client");
+    }
+    tl::endpoint self = m_engine.self();
+    ret = sdskv_provider_handle_create(m_client, self.get_addr(), s_provider_id, &m_phandle);
+    if(ret != SDSKV_SUCCESS) {
+        sdskv_client_finalize(m_client);
+        m_logger->critical("Could not create SDSKV provider handle (sdskv_provider_handle_create returned {})", ret);
+        throw std::runtime_error("Could not create SDSKV provider handle");
+    }
+    m_logger->info("Catalog database attached in {} ({})", path, type);
+    m_flusher = m_engine.get_handler_pool().make_thread([this]() { _flush_loop(); });
+}
+
+Catalog::~Catalog() {
+    stop();
+    sdskv_provider_handle_release(m_phandle);
+    sdskv_client_finalize(m_client);
+}
+
+void Catalog::put(const std::string& key, std::string value) {
+    std::lock_guard<tl::mutex> guard(m_mutex);
+    m_pending[key] = std::move(value);
+}
+
+bool Catalog::flush() {
+    std::lock_guard<tl::mutex> flush_guard(m_flush_mutex);
+    std::map<std::string, std::string> batch;
+    {
+        std::lock_guard<tl::mutex> guard(m_mutex);
+        batch.swap(m_pending);
+    }
+    if(batch.empty()) return true;
+    std::vector<const void*> keys, values;
+    std::vector<hg_size_t>   ksizes, vsizes;
+    keys.reserve(batch.size());
+    values.reserve(batch.size());
+    ksizes.reserve(batch.size());
+    vsizes.reserve(batch.size());
+    for(const auto& p : batch) {
+        keys.push_back(p.first.data());
+        ksizes.push_back(p.first.size());
+        values.push_back(p.second.data());
+        vsizes.push_back(p.second.size());
+    }
+    int ret = sdskv_put_multi(m_phandle, m_db_id, batch.size(),
+            keys.data(), ksizes.data(), values.data(), vsizes.data());
+    if(ret != SDSKV_SUCCESS) {
+        m_logger->error("Could not write {} catalog entries (sdskv_put_multi returned {})", batch.size(), ret);
+        // put the entries back, unless they have been updated in the meantime
+        std::lock_guard<tl::mutex> guard(m_mutex);
+        for(auto& p : batch)
+            m_pending.emplace(p.first, std::move(p.second));
+        return false;
+    }
+    m_logger->debug("Wrote {} catalog entries", batch.size());
+    return true;
+}
+
+void Catalog::stop() {
+    {
+        std::unique_lock<tl::mutex> lock(m_mutex);
+        if(m_stopped) return;
+        m_stopped = true;
+        m_cv.notify_one();
+    }
+    m_flusher->join();
+    flush();
+}
+
+void Catalog::_flush_loop() {
+    std::unique_lock<tl::mutex> lock(m_mutex);
+    while(!m_stopped) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        uint64_t ns = (uint64_t)m_flush_interval_ms * 1000000;
+        deadline.tv_sec  += (deadline.tv_nsec + ns) / 1000000000;
+        deadline.tv_nsec  = (deadline.tv_nsec + ns) % 1000000000;
+        while(!m_stopped && m_cv.wait_until(lock, &deadline));
+        if(m_stopped || m_pending.empty()) continue;
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+std::size_t Catalog::load(const std::function<void(const std::string&, const std::string&)>& f) {
+    static constexpr std::size_t batch_size  = 128;
+    std::vector<std::vector<char>> key_buffers(batch_size, std::vector<char>(s_max_key_size));
+    std::vector<void*>       keys(batch_size);
+    std::vector<hg_size_t>   ksizes(batch_size);
+    std::string start_key;
+    std::size_t count = 0;
+    while(true) {
+        for(std::size_t i = 0; i < batch_size; i++) {
+            keys[i]   = key_buffers[i].data();
+            ksizes[i] = s_max_key_size;
+        }
+        hg_size_t num = batch_size;
+        int ret = sdskv_list_keys(m_phandle, m_db_id, start_key.data(), start_key.size(),
+                keys.data(), ksizes.data(), &num);
+        if(ret != SDSKV_SUCCESS) {
+            m_logger->error("Could not list catalog entries (sdskv_list_keys returned {})", ret);
+            throw std::runtime_error("Could not list catalog entries");
+        }
+        if(num == 0) break;
+        std::vector<hg_size_t> vsizes(num);
+        ret = sdskv_length_multi(m_phandle, m_db_id, num,
+                const_cast<const void* const*>(keys.data()), ksizes.data(), vsizes.data());
+        if(ret != SDSKV_SUCCESS) {
+            m_logger->error("Could not get sizes of catalog entries (sdskv_length_multi returned {})", ret);
+            throw std::runtime_error("Could not read catalog entries");
+        }
+        std::vector<std::string> values(num);
+        std::vector<void*> value_ptrs(num);
+        for(std::size_t i = 0; i < num; i++) {
+            values[i].resize(vsizes[i]);
+            value_ptrs[i] = &values[i][0];
+        }
+        ret = sdskv_get_multi(m_phandle, m_db_id, num,
+                const_cast<const void* const*>(keys.data()), ksizes.data(),
+                value_ptrs.data(), vsizes.data());
+        if(ret != SDSKV_SUCCESS) {
+            m_logger->error("Could not read catalog entries (sdskv_get_multi returned {})", ret);
+            throw std::runtime_error("Could not read catalog entries");
+        }
+        for(std::size_t i = 0; i < num; i++) {
+            values[i].resize(vsizes[i]);
+            f(std::string(key_buffers[i].data(), ksizes[i]), values[i]);
+        }
+        count += num;
+        start_key.assign(key_buffers[num-1].data(), ksizes[num-1]);
+        if(num < batch_size) break;
+    }
+    return count;
+}
+
+static const char s_base64_digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string Catalog::encode_bytes(const std::string& bytes) {
+    std::string result;
+    result.reserve(4*((bytes.size()+2)/3));
+    for(std::size_t i = 0; i < bytes.size(); i += 3) {
+        uint32_t n = (uint32_t)(unsigned char)bytes[i] << 16;
+        if(i+1 < bytes.size()) n |= (uint32_t)(unsigned char)bytes[i+1] << 8;
+        if(i+2 < bytes.size()) n |= (uint32_t)(unsigned char)bytes[i+2];
+        result += s_base64_digits[(n >> 18) & 63];
+        result += s_base64_digits[(n >> 12) & 63];
+        result += i+1 < bytes.size() ? s_base64_digits[(n >> 6) & 63] : '=';
+        result += i+2 < bytes.size() ? s_base64_digits[n & 63] : '=';
+    }
+    return result;
+}
+
+bool Catalog::decode_bytes(const std::string& str, std::string& bytes) {
+    auto value = [](char c) -> int {
+        if(c >= 'A' && c <= 'Z') return c - 'A';
+        if(c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if(c >= '0' && c <= '9') return c - '0' + 52;
+        if(c == '+') return 62;
+        if(c == '/') return 63;
+        return -1;
+    };
+    if(str.size() % 4 != 0) return false;
+    bytes.clear();
+    bytes.reserve(3*(str.size()/4));
+    for(std::size_t i = 0; i < str.size(); i += 4) {
+        uint32_t n = 0;
+        int padding = 0;
+        for(std::size_t j = 0; j < 4; j++) {
+            int v = 0;
+            if(str[i+j] == '=' && i+4 == str.size() && j >= 2) padding += 1;
+            else if(padding || (v = value(str[i+j])) < 0) return false;
+            n = (n << 6) | (uint32_t)v;
+        }
+        bytes += (char)((n >> 16) & 0xff);
+        if(padding < 2) bytes += (char)((n >> 8) & 0xff);
+        if(padding < 1) bytes += (char)(n & 0xff);
+    }
+    return true;
+}
+
+}
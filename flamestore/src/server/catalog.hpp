@@ -0,0 +1,162 @@
+#ifndef __FLAMESTORE_CATALOG_H
+#define __FLAMESTORE_CATALOG_H
+
+#include <string>
+#include <map>
+#include <functional>
+#include <type_traits>
+#include <spdlog/spdlog.h>
+#include <thallium.hpp>
+#include <sdskv-client.h>
+#include <sdskv-server.h>
+
+namespace flamestore {
+
+namespace tl = thallium;
+
+/**
+ * @brief Persistent catalog of the models managed by a backend, stored
+ * in an SDSKV database hosted by the master. Entries are opaque strings
+ * indexed by model name.
+ *
+ * Updates are buffered in memory (only the last value of each entry is
+ * kept) and written to the database in batches by a background ULT every
+ * flush interval, so recording a model never waits for the database.
+ * An update is therefore lost if the master crashes within a flush
+ * interval of it; callers that cannot afford it call flush themselves
+ * (see the catalog_sync option of the mochi backend).
+ *
+ * Keys (model names) are limited to s_max_key_size bytes.
+ */
+class Catalog {
+
+    public:
+
+        static constexpr std::size_t s_max_key_size = 4096;
+
+        /**
+         * @brief Constructor. Registers an SDSKV provider on the engine,
+         * attaches the database (creating it if needed) and starts the
+         * ULT flushing updates.
+         *
+         * @param engine Thallium engine.
+         * @param logger Logger.
+         * @param path Directory in which the database is stored.
+         * @param type Type of database ("leveldb", "berkeleydb", or "map").
+         * @param flush_interval_ms Interval between flushes, in milliseconds.
+         */
+        Catalog(tl::engine& engine, spdlog::logger* logger,
+                const std::string& path, const std::string& type,
+                unsigned flush_interval_ms);
+
+        Catalog(const Catalog&)            = delete;
+        Catalog(Catalog&&)                 = delete;
+        Catalog& operator=(const Catalog&) = delete;
+        Catalog& operator=(Catalog&&)      = delete;
+
+        ~Catalog();
+
+        /**
+         * @brief Records the new value of an entry. The value is written
+         * to the database by the next flush.
+         */
+        void put(const std::string& key, std::string value);
+
+        /**
+         * @brief Writes all the pending updates to the database.
+         *
+         * @return false if the updates could not be written (they are
+         * kept and retried by the next flush).
+         */
+        bool flush();
+
+        /**
+         * @brief Flushes the pending updates and stops the flushing ULT.
+         * Subsequent updates are only written by explicit calls to flush.
+         */
+        void stop();
+
+        /**
+         * @brief Calls f(key, value) on every entry of the database.
+         *
+         * @return the number of entries.
+         */
+        std::size_t load(const std::function<void(const std::string&, const std::string&)>& f);
+
+        /**
+         * @brief Hex-encodes the bytes of a trivially copyable object
+         * (e.g. a Bake region or target id).
+         */
+        template<typename T>
+        static std::string encode_raw(const T& obj) {
+            static_assert(std::is_trivially_copyable<T>::value, "Type is not trivially copyable");
+            static const char digits[] = "0123456789abcdef";
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&obj);
+            std::string result(2*sizeof(T), '0');
+            for(std::size_t i = 0; i < sizeof(T); i++) {
+                result[2*i]   = digits[bytes[i] >> 4];
+                result[2*i+1] = digits[bytes[i] & 0x0f];
+            }
+            return result;
+        }
+
+        /**
+         * @brief Decodes an object encoded with encode_raw.
+         *
+         * @return false if the string is not a valid encoding.
+         */
+        template<typename T>
+        static bool decode_raw(const std::string& str, T& obj) {
+            static_assert(std::is_trivially_copyable<T>::value, "Type is not trivially copyable");
+            if(str.size() != 2*sizeof(T)) return false;
+            auto value = [](char c) -> int {
+                if(c >= '0' && c <= '9') return c - '0';
+                if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+                return -1;
+            };
+            unsigned char* bytes = reinterpret_cast<unsigned char*>(&obj);
+            for(std::size_t i = 0; i < sizeof(T); i++) {
+                int hi = value(str[2*i]), lo = value(str[2*i+1]);
+                if(hi < 0 || lo < 0) return false;
+                bytes[i] = static_cast<unsigned char>((hi << 4) | lo);
+            }
+            return true;
+        }
+
+        /**
+         * @brief Base64-encodes arbitrary bytes (e.g. a compressed
+         * model configuration), which JSON strings cannot hold as is.
+         */
+        static std::string encode_bytes(const std::string& bytes);
+
+        /**
+         * @brief Decodes a string encoded with encode_bytes.
+         *
+         * @return false if the string is not a valid encoding.
+         */
+        static bool decode_bytes(const std::string& str, std::string& bytes);
+
+    private:
+
+        static constexpr uint16_t s_provider_id = 1;
+
+        tl::engine&                         m_engine;
+        spdlog::logger*                     m_logger;
+        sdskv_provider_t                    m_provider;
+        sdskv_client_t                      m_client;
+        sdskv_provider_handle_t             m_phandle;
+        sdskv_database_id_t                 m_db_id;
+        unsigned                            m_flush_interval_ms;
+        tl::mutex                           m_mutex;
+        tl::condition_variable              m_cv;
+        std::map<std::string, std::string>  m_pending;
+        bool                                m_stopped = false;
+        tl::mutex                           m_flush_mutex;
+        tl::managed<tl::thread>             m_flusher;
+
+        void _flush_loop();
+};
+
+}
+
+#endif
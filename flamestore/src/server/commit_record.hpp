@@ -0,0 +1,88 @@
+#ifndef __FLAMESTORE_COMMIT_RECORD_H
+#define __FLAMESTORE_COMMIT_RECORD_H
+
+#include <cstdint>
+#include <cstddef>
+
+namespace flamestore {
+
+/**
+ * @brief A commit_record is the small piece of metadata that persistent
+ * backends write (after the data has been persisted) to indicate which
+ * of a model's two shadow extents holds the last complete checkpoint.
+ *
+ * Two records are kept per model, one per shadow extent. The record for
+ * version v lives in slot v % 2 and describes the data in extent v % 2,
+ * so writing a new version never overwrites the record of the previous
+ * one. On restart, the valid record with the highest version wins; a
+ * record torn by a crash fails its checksum and is ignored.
+ */
+struct commit_record {
+
+    static constexpr uint64_t s_magic = 0x464c414d45434d54; // "FLAMECMT"
+
+    uint64_t m_magic    = s_magic;
+    uint64_t m_version  = 0;
+    uint64_t m_size     = 0;
+    uint32_t m_slot     = 0;
+    uint32_t m_checksum = 0;
+
+    commit_record() = default;
+
+    commit_record(uint64_t version, uint64_t size)
+    : m_version(version)
+    , m_size(size)
+    , m_slot(slot_of(version)) {
+        m_checksum = compute_checksum();
+    }
+
+    /**
+     * @brief Returns the shadow slot used by a given version.
+     */
+    static uint32_t slot_of(uint64_t version) {
+        return static_cast<uint32_t>(version % 2);
+    }
+
+    /**
+     * @brief Offset of the record for the given slot
+     * within the commit region.
+     */
+    static std::size_t offset_of(uint32_t slot) {
+        return slot*sizeof(commit_record);
+    }
+
+    /**
+     * @brief Size of the commit region holding both records.
+     */
+    static constexpr std::size_t region_size() {
+        return 2*sizeof(commit_record);
+    }
+
+    /**
+     * @brief Computes a CRC32 over all the fields preceding m_checksum.
+     */
+    uint32_t compute_checksum() const {
+        const unsigned char* data = reinterpret_cast<const unsigned char*>(this);
+        std::size_t size = offsetof(commit_record, m_checksum);
+        uint32_t crc = 0xFFFFFFFF;
+        for(std::size_t i = 0; i < size; i++) {
+            crc ^= data[i];
+            for(int k = 0; k < 8; k++)
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+        return ~crc;
+    }
+
+    /**
+     * @brief Checks that the record is neither torn nor uninitialized.
+     */
+    bool is_valid() const {
+        return m_magic == s_magic
+            && m_slot == slot_of(m_version)
+            && m_checksum == compute_checksum();
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef __FLAMESTORE_COPY_REQUEST_H
+#define __FLAMESTORE_COPY_REQUEST_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <bake-client.hpp>
+#include <thallium/serialization/stl/string.hpp>
+#include <thallium/serialization/stl/vector.hpp>
+
+namespace flamestore {
+
+/**
+ * @brief Destination of a copy_request.
+ */
+struct copy_destination {
+
+    std::string  m_addr;
+    uint16_t     m_provider_id = 0;
+    bake::target m_target;
+    bake::region m_region;
+    uint64_t     m_offset = 0;
+
+    template<typename A>
+    void serialize(A& ar) {
+        ar & m_addr;
+        ar & m_provider_id;
+        ar & m_target;
+        ar & m_region;
+        ar & m_offset;
+    }
+};
+
+/**
+ * @brief Chunk of a Bake region that the master asks the StorageServer
+ * holding it to copy into regions of other (possibly remote) Bake
+ * providers, with the flamestore_copy_chunk RPC. The StorageServer reads
+ * the chunk locally once, writes it at the offset of every destination
+ * in its region in parallel and persists it, so the data never goes
+ * through the master. The RPC responds with one status per destination
+ * (0 on success, a Bake error code otherwise).
+ */
+struct copy_request {
+
+    bake::target                  m_src_target;
+    bake::region                  m_src_region;
+    uint64_t                      m_offset = 0;
+    uint64_t                      m_size   = 0;
+    std::vector<copy_destination> m_destinations;
+
+    template<typename A>
+    void serialize(A& ar) {
+        ar & m_src_target;
+        ar & m_src_region;
+        ar & m_offset;
+        ar & m_size;
+        ar & m_destinations;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,235 @@
+#include "server/erasure_code.hpp"
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FLAMESTORE_EC_X86
+#endif
+
+namespace flamestore {
+
+namespace {
+
+/**
+ * @brief Log/exp tables for GF(2^8) with the polynomial x^8+x^4+x^3+x^2+1.
+ */
+struct gf_tables {
+
+    uint8_t m_exp[512];
+    uint8_t m_log[256];
+
+    gf_tables() {
+        unsigned x = 1;
+        for(unsigned i = 0; i < 255; i++) {
+            m_exp[i] = static_cast<uint8_t>(x);
+            m_log[x] = static_cast<uint8_t>(i);
+            x <<= 1;
+            if(x & 0x100) x ^= 0x11d;
+        }
+        for(unsigned i = 255; i < 512; i++)
+            m_exp[i] = m_exp[i - 255];
+        m_log[0] = 0;
+    }
+
+    uint8_t mul(uint8_t a, uint8_t b) const {
+        if(a == 0 || b == 0) return 0;
+        return m_exp[m_log[a] + m_log[b]];
+    }
+
+    uint8_t inv(uint8_t a) const {
+        return m_exp[255 - m_log[a]];
+    }
+};
+
+const gf_tables& gf() {
+    static gf_tables tables;
+    return tables;
+}
+
+/**
+ * @brief Builds the 16-entry tables of c*x for the low and high
+ * nibbles x, used by the vectorized kernels.
+ */
+void nibble_tables(uint8_t c, uint8_t lo[16], uint8_t hi[16]) {
+    for(unsigned x = 0; x < 16; x++) {
+        lo[x] = gf().mul(c, static_cast<uint8_t>(x));
+        hi[x] = gf().mul(c, static_cast<uint8_t>(x << 4));
+    }
+}
+
+void mul_add_scalar(uint8_t* dst, const uint8_t* src, uint8_t c, std::size_t len) {
+    uint8_t lo[16], hi[16];
+    nibble_tables(c, lo, hi);
+    for(std::size_t i = 0; i < len; i++)
+        dst[i] ^= lo[src[i] & 0x0f] ^ hi[src[i] >> 4];
+}
+
+#ifdef FLAMESTORE_EC_X86
+
+__attribute__((target("ssse3")))
+void mul_add_ssse3(uint8_t* dst, const uint8_t* src, uint8_t c, std::size_t len) {
+    uint8_t lo[16], hi[16];
+    nibble_tables(c, lo, hi);
+    const __m128i tlo  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo));
+    const __m128i thi  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    std::size_t i = 0;
+    for(; i + 16 <= len; i += 16) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i l = _mm_shuffle_epi8(tlo, _mm_and_si128(s, mask));
+        __m128i h = _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi64(s, 4), mask));
+        d = _mm_xor_si128(d, _mm_xor_si128(l, h));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), d);
+    }
+    for(; i < len; i++)
+        dst[i] ^= lo[src[i] & 0x0f] ^ hi[src[i] >> 4];
+}
+
+__attribute__((target("avx2")))
+void mul_add_avx2(uint8_t* dst, const uint8_t* src, uint8_t c, std::size_t len) {
+    uint8_t lo[16], hi[16];
+    nibble_tables(c, lo, hi);
+    const __m256i tlo  = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo)));
+    const __m256i thi  = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi)));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    std::size_t i = 0;
+    for(; i + 32 <= len; i += 32) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i l = _mm256_shuffle_epi8(tlo, _mm256_and_si256(s, mask));
+        __m256i h = _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask));
+        d = _mm256_xor_si256(d, _mm256_xor_si256(l, h));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), d);
+    }
+    for(; i < len; i++)
+        dst[i] ^= lo[src[i] & 0x0f] ^ hi[src[i] >> 4];
+}
+
+#endif
+
+using mul_add_fn = void (*)(uint8_t*, const uint8_t*, uint8_t, std::size_t);
+
+struct kernel {
+    mul_add_fn  m_fn;
+    const char* m_name;
+};
+
+const kernel& select_kernel() {
+    static kernel k = []() -> kernel {
+#ifdef FLAMESTORE_EC_X86
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))  return { mul_add_avx2, "avx2" };
+        if(__builtin_cpu_supports("ssse3")) return { mul_add_ssse3, "ssse3" };
+#endif
+        return { mul_add_scalar, "scalar" };
+    }();
+    return k;
+}
+
+}
+
+ErasureCode::ErasureCode(unsigned k, unsigned m)
+: m_k(k)
+, m_m(m)
+, m_parity_matrix(k*m) {
+    if(k == 0 || k + m > 256)
+        throw std::invalid_argument("Invalid erasure code parameters");
+    // Cauchy matrix a_ij = 1/(x_i + y_j) with x_i = k + i and y_j = j
+    for(unsigned i = 0; i < m; i++)
+        for(unsigned j = 0; j < k; j++)
+            m_parity_matrix[i*k + j] = gf().inv(static_cast<uint8_t>((k + i) ^ j));
+}
+
+std::size_t ErasureCode::fragment_size(std::size_t object_size) const {
+    std::size_t len = (object_size + m_k - 1) / m_k;
+    return (len + 63) & ~static_cast<std::size_t>(63);
+}
+
+void ErasureCode::mul_add_region(uint8_t* dst, const uint8_t* src, uint8_t c, std::size_t len) {
+    if(c == 0) return;
+    if(c == 1) {
+        for(std::size_t i = 0; i < len; i++) dst[i] ^= src[i];
+        return;
+    }
+    select_kernel().m_fn(dst, src, c, len);
+}
+
+const char* ErasureCode::kernel_name() {
+    return select_kernel().m_name;
+}
+
+// regions are processed in blocks small enough for all the
+// fragments' blocks to stay in cache across the k*m passes
+static constexpr std::size_t s_block_size = 16*1024;
+
+void ErasureCode::encode(const uint8_t* const* data, uint8_t* const* parity, std::size_t len) const {
+    for(std::size_t off = 0; off < len; off += s_block_size) {
+        std::size_t n = std::min(s_block_size, len - off);
+        for(unsigned i = 0; i < m_m; i++) {
+            std::memset(parity[i] + off, 0, n);
+            for(unsigned j = 0; j < m_k; j++)
+                mul_add_region(parity[i] + off, data[j] + off, m_parity_matrix[i*m_k + j], n);
+        }
+    }
+}
+
+bool ErasureCode::decode(uint8_t* const* fragments, const std::vector<bool>& available, std::size_t len) const {
+    std::vector<unsigned> missing;
+    for(unsigned j = 0; j < m_k; j++)
+        if(!available[j]) missing.push_back(j);
+    if(missing.empty()) return true;
+    // pick k available fragments, data fragments first
+    std::vector<unsigned> rows;
+    for(unsigned i = 0; i < m_k + m_m && rows.size() < m_k; i++)
+        if(available[i]) rows.push_back(i);
+    if(rows.size() < m_k) return false;
+    // build the k x k submatrix of the generator for these rows and invert it
+    std::vector<uint8_t> a(m_k*m_k, 0), inv(m_k*m_k, 0);
+    for(unsigned r = 0; r < m_k; r++) {
+        inv[r*m_k + r] = 1;
+        if(rows[r] < m_k)
+            a[r*m_k + rows[r]] = 1;
+        else
+            std::memcpy(&a[r*m_k], &m_parity_matrix[(rows[r] - m_k)*m_k], m_k);
+    }
+    for(unsigned col = 0; col < m_k; col++) {
+        unsigned pivot = col;
+        while(pivot < m_k && a[pivot*m_k + col] == 0) pivot++;
+        if(pivot == m_k) return false; // cannot happen with a Cauchy matrix
+        if(pivot != col) {
+            for(unsigned j = 0; j < m_k; j++) {
+                std::swap(a[pivot*m_k + j], a[col*m_k + j]);
+                std::swap(inv[pivot*m_k + j], inv[col*m_k + j]);
+            }
+        }
+        uint8_t f = gf().inv(a[col*m_k + col]);
+        for(unsigned j = 0; j < m_k; j++) {
+            a[col*m_k + j]   = gf().mul(a[col*m_k + j], f);
+            inv[col*m_k + j] = gf().mul(inv[col*m_k + j], f);
+        }
+        for(unsigned r = 0; r < m_k; r++) {
+            uint8_t g = a[r*m_k + col];
+            if(r == col || g == 0) continue;
+            for(unsigned j = 0; j < m_k; j++) {
+                a[r*m_k + j]   ^= gf().mul(g, a[col*m_k + j]);
+                inv[r*m_k + j] ^= gf().mul(g, inv[col*m_k + j]);
+            }
+        }
+    }
+    // data fragment j = sum over r of inv[j][r] * fragment[rows[r]]
+    for(std::size_t off = 0; off < len; off += s_block_size) {
+        std::size_t n = std::min(s_block_size, len - off);
+        for(auto j : missing) {
+            std::memset(fragments[j] + off, 0, n);
+            for(unsigned r = 0; r < m_k; r++)
+                mul_add_region(fragments[j] + off, fragments[rows[r]] + off, inv[j*m_k + r], n);
+        }
+    }
+    return true;
+}
+
+}
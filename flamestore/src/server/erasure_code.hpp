@@ -0,0 +1,87 @@
+#ifndef __FLAMESTORE_ERASURE_CODE_H
+#define __FLAMESTORE_ERASURE_CODE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace flamestore {
+
+/**
+ * @brief Systematic Reed-Solomon code over GF(2^8) with k data
+ * fragments and m parity fragments (k + m <= 256). The parity rows
+ * of the generator matrix form a Cauchy matrix, so any k of the
+ * k + m fragments are enough to rebuild the data.
+ *
+ * The region kernels use AVX2 or SSSE3 (split-nibble table lookups
+ * with pshufb) when the CPU supports them, selected at runtime,
+ * and fall back to a scalar implementation otherwise.
+ *
+ * This class does not depend on Argobots or Mercury and is safe
+ * to use concurrently from multiple threads.
+ */
+class ErasureCode {
+
+    public:
+
+        /**
+         * @brief Constructor.
+         *
+         * @param k Number of data fragments.
+         * @param m Number of parity fragments.
+         */
+        ErasureCode(unsigned k, unsigned m);
+
+        unsigned data_fragments() const { return m_k; }
+
+        unsigned parity_fragments() const { return m_m; }
+
+        /**
+         * @brief Size of each fragment for an object of a given size.
+         * Fragments are padded to a multiple of 64 bytes.
+         */
+        std::size_t fragment_size(std::size_t object_size) const;
+
+        /**
+         * @brief Computes the parity fragments.
+         *
+         * @param data k pointers to the data fragments.
+         * @param parity m pointers to the parity fragments.
+         * @param len Size of each fragment.
+         */
+        void encode(const uint8_t* const* data, uint8_t* const* parity, std::size_t len) const;
+
+        /**
+         * @brief Rebuilds the missing data fragments from any k available
+         * fragments. Missing parity fragments are not rebuilt.
+         *
+         * @param fragments k + m pointers to fragments (data first).
+         * @param available Which fragments hold valid content.
+         * @param len Size of each fragment.
+         *
+         * @return false if fewer than k fragments are available.
+         */
+        bool decode(uint8_t* const* fragments, const std::vector<bool>& available, std::size_t len) const;
+
+        /**
+         * @brief Computes dst ^= c * src over GF(2^8) on a region,
+         * using the fastest kernel supported by the CPU.
+         */
+        static void mul_add_region(uint8_t* dst, const uint8_t* src, uint8_t c, std::size_t len);
+
+        /**
+         * @brief Name of the region kernel used on this CPU
+         * ("avx2", "ssse3", or "scalar").
+         */
+        static const char* kernel_name();
+
+    private:
+
+        unsigned             m_k;
+        unsigned             m_m;
+        std::vector<uint8_t> m_parity_matrix; // m x k, row major
+};
+
+}
+
+#endif
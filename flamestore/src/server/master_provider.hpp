@@ -3,6 +3,7 @@
 
 #include <pybind11/pybind11.h>
 #include <thallium.hpp>
+#include <algorithm>
 #include <iostream>
 #include <mutex>
 #include <map>
@@ -13,6 +14,8 @@
 #include "common/status.hpp"
 #include "server/model.hpp"
 #include "server/backend.hpp"
+#include "server/string_pool.hpp"
+#include "server/scheduler.hpp"
 
 namespace flamestore {
 
@@ -29,9 +32,10 @@ class MasterProvider : public tl::provider<MasterProvider> {
     private:
 
     spdlog::logger* m_logger = nullptr;
+    StringPool      m_strings; // configs and signatures of the backend's models
+    Scheduler       m_scheduler; // admission control of the requests
     std::unique_ptr<AbstractServerBackend> m_backend;
 
-
     void on_shutdown(const tl::request& req)
     {
         m_logger->debug("Received a request to shut down");
@@ -61,6 +65,7 @@ class MasterProvider : public tl::provider<MasterProvider> {
     {
         m_logger->debug("Registering model {} from client {}", name, client_addr);
         if(m_backend) {
+            auto ticket = m_scheduler.admit(Scheduler::METADATA, Scheduler::client_of(req), 0);
             m_backend->register_model(req, client_addr, name, config, size, signature);
         } else {
             m_logger->error("No backend found!");
@@ -83,6 +88,7 @@ class MasterProvider : public tl::provider<MasterProvider> {
     {
         m_logger->debug("Reloading model {} to client {}", name, client_addr);
         if(m_backend) {
+            auto ticket = m_scheduler.admit(Scheduler::METADATA, Scheduler::client_of(req), 0);
             m_backend->reload_model(req, client_addr, name);
         } else {
             m_logger->error("No backend found!");
@@ -90,6 +96,216 @@ class MasterProvider : public tl::provider<MasterProvider> {
         }
     }
 
+    /**
+     * @brief RPC called when a client registers a model whose
+     * configuration is too large to be sent as an RPC argument.
+     *
+     * @param req Thallium request
+     * @param client_addr Address of the client
+     * @param name Model name
+     * @param config_size Size of the model configuration
+     * @param config_bulk Bulk handle pointing to the model configuration
+     * @param size Size of the model data
+     * @param signature Model signature for consistency checking
+     */
+    void on_register_model_bulk(
+            const tl::request& req,
+            const std::string& client_addr,
+            const std::string& name,
+            const std::size_t& config_size,
+            const tl::bulk& config_bulk,
+            std::size_t& size,
+            std::string& signature)
+    {
+        m_logger->debug("Registering model {} from client {} ({} bytes of config)",
+                name, client_addr, config_size);
+        if(!m_backend) {
+            m_logger->error("No backend found!");
+            req.respond(Status(FLAMESTORE_EBACKEND, "No FlameStore backend found"));
+            return;
+        }
+        std::string config(config_size, '\0');
+        try {
+            if(config_size != 0) {
+                std::vector<std::pair<void*, std::size_t>> segment(1, {&config[0], config_size});
+                auto local_bulk = get_engine().expose(segment, tl::bulk_mode::write_only);
+                local_bulk << config_bulk.on(req.get_endpoint()).select(0, config_size);
+            }
+        } catch(const tl::exception& ex) {
+            m_logger->error("Failed to pull config of model {}: {}", name, ex.what());
+            req.respond(Status(FLAMESTORE_EIO, "Failed to pull model config"));
+            return;
+        }
+        auto ticket = m_scheduler.admit(Scheduler::METADATA, Scheduler::client_of(req), 0);
+        m_backend->register_model(req, client_addr, name, config, size, signature);
+    }
+
+    /**
+     * @brief RPC called when a client registers a model whose
+     * configuration the server already knows (e.g. because another
+     * model of the same sweep was registered with it). The client sends
+     * the content_key of the configuration instead of the configuration,
+     * and falls back to a regular registration if the server responds
+     * FLAMESTORE_ENOCONFIG.
+     *
+     * @param req Thallium request
+     * @param client_addr Address of the client
+     * @param name Model name
+     * @param config_key content_key of the model configuration
+     * @param size Size of the model data
+     * @param signature Model signature for consistency checking
+     */
+    void on_register_model_by_key(
+            const tl::request& req,
+            const std::string& client_addr,
+            const std::string& name,
+            const std::string& config_key,
+            std::size_t& size,
+            std::string& signature)
+    {
+        m_logger->debug("Registering model {} from client {} (config {})",
+                name, client_addr, config_key);
+        if(!m_backend) {
+            m_logger->error("No backend found!");
+            req.respond(Status(FLAMESTORE_EBACKEND, "No FlameStore backend found"));
+            return;
+        }
+        // holding the handle keeps the config in the pool until the backend interns it
+        auto config = m_strings.find(config_key);
+        if(!config) {
+            req.respond(Status(FLAMESTORE_ENOCONFIG, "Unknown model config"));
+            return;
+        }
+        auto ticket = m_scheduler.admit(Scheduler::METADATA, Scheduler::client_of(req), 0);
+        m_backend->register_model(req, client_addr, name, *config, size, signature);
+    }
+
+    /**
+     * @brief RPC called when a client wants the size, signature
+     * and version of a model, without its configuration.
+     *
+     * @param req Thallium request
+     * @param client_addr Address of the client
+     * @param name Model name
+     */
+    void on_stat_model(
+            const tl::request& req,
+            const std::string& client_addr,
+            const std::string& name)
+    {
+        m_logger->debug("Stat of model {} for client {}", name, client_addr);
+        if(m_backend) {
+            auto ticket = m_scheduler.admit(Scheduler::METADATA, Scheduler::client_of(req), 0);
+            m_backend->get_model_info(req, client_addr, name, tl::bulk(), 0, 0);
+        } else {
+            m_logger->error("No backend found!");
+            model_info info;
+            info.m_status = Status(FLAMESTORE_EBACKEND, "No FlameStore backend found");
+            req.respond(info);
+        }
+    }
+
+    /**
+     * @brief RPC called when a client wants to retrieve the configuration
+     * of a model, along with its size, signature and version.
+     *
+     * @param req Thallium request
+     * @param client_addr Address of the client
+     * @param name Model name
+     * @param remote_bulk Bulk handle in which to push the config (may be null)
+     * @param capacity Size of the memory behind remote_bulk
+     * @param max_inline Size up to which the config can be sent inline
+     */
+    void on_fetch_model_config(
+            const tl::request& req,
+            const std::string& client_addr,
+            const std::string& name,
+            const tl::bulk& remote_bulk,
+            const std::size_t& capacity,
+            const std::size_t& max_inline)
+    {
+        m_logger->debug("Fetching config of model {} for client {}", name, client_addr);
+        if(m_backend) {
+            auto ticket = m_scheduler.admit(Scheduler::METADATA, Scheduler::client_of(req), 0);
+            m_backend->get_model_info(req, client_addr, name, remote_bulk, capacity, max_inline);
+        } else {
+            m_logger->error("No backend found!");
+            model_info info;
+            info.m_status = Status(FLAMESTORE_EBACKEND, "No FlameStore backend found");
+            req.respond(info);
+        }
+    }
+
+    /**
+     * @brief RPC called when a client registers a model and writes
+     * its data in the same request. The backend admits the write as a
+     * checkpoint with the scheduler, like on_write_model_data.
+     *
+     * @param req Thallium request
+     * @param client_addr Address of the client
+     * @param name Model name
+     * @param config Model configuration (architecture + optimizer)
+     * @param size Size of the model data
+     * @param signature Model signature for consistency checking
+     * @param remote_bulk Bulk handle pointing to the model's memory
+     * @param data Model data if sent inline (remote_bulk is then ignored)
+     */
+    void on_register_and_write_model(
+            const tl::request& req,
+            const std::string& client_addr,
+            const std::string& name,
+            std::string& config,
+            std::size_t& size,
+            std::string& signature,
+            const tl::bulk& remote_bulk,
+            const std::vector<char>& data)
+    {
+        m_logger->debug("Registering and writing model {} from client {}", name, client_addr);
+        if(m_backend) {
+            m_backend->register_and_write_model(req, client_addr, name, config, size,
+                                                signature, remote_bulk, data);
+        } else {
+            m_logger->error("No backend found!");
+            req.respond(Status(FLAMESTORE_EBACKEND, "No FlameStore backend found"));
+        }
+    }
+
+    /**
+     * @brief RPC called when a client wants to retrieve the
+     * configuration of a model along with its data.
+     *
+     * @param req Thallium request
+     * @param client_addr Address of the client
+     * @param name Model name
+     * @param remote_bulk Bulk handle in which to push the data (may be null)
+     * @param capacity Size of the memory behind remote_bulk
+     * @param config_bulk Bulk handle in which to push the config (may be null)
+     * @param config_capacity Size of the memory behind config_bulk
+     * @param max_inline Size up to which the data and the config can be sent inline
+     */
+    void on_reload_model_data(
+            const tl::request& req,
+            const std::string& client_addr,
+            const std::string& name,
+            const tl::bulk& remote_bulk,
+            const std::size_t& capacity,
+            const tl::bulk& config_bulk,
+            const std::size_t& config_capacity,
+            const std::size_t& max_inline)
+    {
+        m_logger->debug("Reloading model {} with its data to client {}", name, client_addr);
+        if(m_backend) {
+            auto ticket = m_scheduler.admit(Scheduler::RESTORE, Scheduler::client_of(req), std::max(capacity, max_inline));
+            m_backend->reload_model_data(req, client_addr, name, remote_bulk, capacity,
+                                         config_bulk, config_capacity, max_inline);
+        } else {
+            m_logger->error("No backend found!");
+            reload_result result;
+            result.m_status = Status(FLAMESTORE_EBACKEND, "No FlameStore backend found");
+            req.respond(result);
+        }
+    }
+
     /**
      * @brief RPC called when a client wants to write data to a model.
      *
@@ -137,6 +353,7 @@ class MasterProvider : public tl::provider<MasterProvider> {
     {
         m_logger->debug("Reading model data for model {} requested by client {}", name, client_addr);
         if(m_backend) {
+            auto ticket = m_scheduler.admit(Scheduler::RESTORE, Scheduler::client_of(req), size);
             m_backend->read_model(req, client_addr, name, signature, remote_bulk, size);
         } else {
             m_logger->error("No backend found!");
@@ -144,6 +361,112 @@ class MasterProvider : public tl::provider<MasterProvider> {
         }
     }
 
+    /**
+     * @brief RPC called when a client wants to write data to a small
+     * model, sending the data in the RPC arguments.
+     *
+     * @param req Thallium request
+     * @param client_addr Address of the client
+     * @param name Name of the model
+     * @param signature Signature of the model
+     * @param data Model data
+     */
+    void on_write_model_inline(
+            const tl::request& req,
+            const std::string& client_addr,
+            const std::string& name,
+            const std::string& signature,
+            const std::vector<char>& data)
+    {
+        m_logger->debug("Writing {} bytes inline for model {} from client {}", data.size(), name, client_addr);
+        if(m_backend) {
+            m_backend->write_model_inline(req, client_addr, name, signature, data);
+        } else {
+            m_logger->error("No backend found!");
+            req.respond(Status(FLAMESTORE_EBACKEND, "No FlameStore backend found"));
+        }
+    }
+
+    /**
+     * @brief RPC called when a client wants to read a small model,
+     * the data being sent back in the response.
+     *
+     * @param req Thallium request
+     * @param client_addr Address of the client
+     * @param name Name of the model
+     * @param signature Signature of the model
+     * @param size Size of the model data, in bytes
+     */
+    void on_read_model_inline(
+            const tl::request& req,
+            const std::string& client_addr,
+            const std::string& name,
+            const std::string& signature,
+            const std::size_t& size)
+    {
+        m_logger->debug("Reading model {} inline for client {}", name, client_addr);
+        if(m_backend) {
+            auto ticket = m_scheduler.admit(Scheduler::RESTORE, Scheduler::client_of(req), size);
+            m_backend->read_model_inline(req, client_addr, name, signature, size);
+        } else {
+            m_logger->error("No backend found!");
+            req.respond(std::make_pair(
+                        Status(FLAMESTORE_EBACKEND, "No FlameStore backend found"),
+                        std::vector<char>()));
+        }
+    }
+
+    /**
+     * @brief RPC called when a client writes several models at once.
+     *
+     * @param req Thallium request
+     * @param client_addr Address of the client
+     * @param entries Models to write
+     * @param remote_bulk Bulk handle pointing to the models' memory
+     * @param atomic Whether the models should all be committed or none
+     */
+    void on_write_model_batch(
+            const tl::request& req,
+            const std::string& client_addr,
+            const std::vector<batch_entry>& entries,
+            const tl::bulk& remote_bulk,
+            bool atomic)
+    {
+        m_logger->debug("Writing {} models from client {}", entries.size(), client_addr);
+        if(m_backend) {
+            m_backend->write_model_batch(req, client_addr, entries, remote_bulk, atomic);
+        } else {
+            m_logger->error("No backend found!");
+            req.respond(std::vector<Status>(entries.size(),
+                        Status(FLAMESTORE_EBACKEND, "No FlameStore backend found")));
+        }
+    }
+
+    /**
+     * @brief RPC called when a client reads several models at once.
+     *
+     * @param req Thallium request
+     * @param client_addr Address of the client
+     * @param entries Models to read
+     * @param remote_bulk Bulk handle pointing to the models' memory
+     */
+    void on_read_model_batch(
+            const tl::request& req,
+            const std::string& client_addr,
+            const std::vector<batch_entry>& entries,
+            const tl::bulk& remote_bulk)
+    {
+        m_logger->debug("Reading {} models for client {}", entries.size(), client_addr);
+        if(m_backend) {
+            auto ticket = m_scheduler.admit(Scheduler::RESTORE, Scheduler::client_of(req), batch_bytes(entries));
+            m_backend->read_model_batch(req, client_addr, entries, remote_bulk);
+        } else {
+            m_logger->error("No backend found!");
+            req.respond(std::vector<Status>(entries.size(),
+                        Status(FLAMESTORE_EBACKEND, "No FlameStore backend found")));
+        }
+    }
+
     /**
      * @brief RPC called when a client duplicates a model.
      *
@@ -165,6 +488,171 @@ class MasterProvider : public tl::provider<MasterProvider> {
         }
     }
 
+    /**
+     * @brief RPC called when a client duplicates a model into several
+     * new models.
+     *
+     * @param req Thallium request
+     * @param name Model name
+     * @param new_names Duplicated model names
+     */
+    void on_duplicate_many(
+            const tl::request& req,
+            const std::string& name,
+            const std::vector<std::string>& new_names)
+    {
+        m_logger->debug("Duplicating model {} into {} models", name, new_names.size());
+        if(m_backend) {
+            m_backend->duplicate_many(req, name, new_names);
+        } else {
+            m_logger->error("No backend found!");
+            req.respond(std::vector<Status>(new_names.size(),
+                        Status(FLAMESTORE_EBACKEND, "No FlameStore backend found")));
+        }
+    }
+
+    /**
+     * @brief RPC called when a client lists the models matching a query.
+     *
+     * @param req Thallium request
+     * @param query Query
+     */
+    void on_list_models(
+            const tl::request& req,
+            const list_query& query)
+    {
+        m_logger->debug("Listing models (prefix \"{}\", after \"{}\")", query.m_prefix, query.m_after);
+        if(m_backend) {
+            m_backend->list_models(req, query);
+        } else {
+            m_logger->error("No backend found!");
+            list_page page;
+            page.m_status = Status(FLAMESTORE_EBACKEND, "No FlameStore backend found");
+            req.respond(page);
+        }
+    }
+
+    /**
+     * @brief RPC called when a client sets the tags of a model.
+     *
+     * @param req Thallium request
+     * @param name Model name
+     * @param tags Tags
+     */
+    void on_set_model_tags(
+            const tl::request& req,
+            const std::string& name,
+            const std::map<std::string, std::string>& tags)
+    {
+        m_logger->debug("Setting {} tags on model {}", tags.size(), name);
+        if(m_backend) {
+            m_backend->set_model_tags(req, name, tags);
+        } else {
+            m_logger->error("No backend found!");
+            req.respond(Status(FLAMESTORE_EBACKEND, "No FlameStore backend found"));
+        }
+    }
+
+    /**
+     * @brief RPC called by a client to wait until all the model data
+     * written so far has been persisted.
+     *
+     * @param req Thallium request
+     */
+    void on_flush(const tl::request& req)
+    {
+        m_logger->debug("Flushing");
+        if(m_backend) {
+            m_backend->flush(req);
+        } else {
+            m_logger->error("No backend found!");
+            req.respond(Status(FLAMESTORE_EBACKEND, "No FlameStore backend found"));
+        }
+    }
+
+    /**
+     * @brief RPC called by a storage server before it leaves the group,
+     * so that the data it holds can be moved elsewhere.
+     *
+     * @param req Thallium request
+     * @param worker_addr Address of the storage server
+     */
+    void on_drain_worker(
+            const tl::request& req,
+            const std::string& worker_addr)
+    {
+        m_logger->debug("Draining storage server {}", worker_addr);
+        if(m_backend) {
+            m_backend->drain_worker(req, worker_addr);
+        } else {
+            m_logger->error("No backend found!");
+            req.respond(Status(FLAMESTORE_EBACKEND, "No FlameStore backend found"));
+        }
+    }
+
+    /**
+     * @brief RPC called by an admin to get the backend's counters.
+     *
+     * @param req Thallium request
+     */
+    void on_backend_stats(const tl::request& req)
+    {
+        m_logger->debug("Getting backend stats");
+        if(m_backend) {
+            m_backend->get_stats(req);
+        } else {
+            m_logger->error("No backend found!");
+            req.respond(std::map<std::string, uint64_t>());
+        }
+    }
+
+    /**
+     * @brief RPC called by a client to set its priority, which
+     * multiplies the weight of its requests in the scheduler. The
+     * client is the sender of the request (see Scheduler::client_of).
+     *
+     * @param req Thallium request
+     * @param client_addr Address of the client (ignored)
+     * @param priority Priority (1 by default)
+     */
+    void on_set_client_priority(
+            const tl::request& req,
+            const std::string& client_addr,
+            uint32_t priority)
+    {
+        auto client = Scheduler::client_of(req);
+        m_logger->debug("Setting priority of client {} to {}", client, priority);
+        m_scheduler.set_priority(client, priority);
+        req.respond(Status::OK());
+    }
+
+    /**
+     * @brief RPC called by an admin to get the scheduler's counters.
+     *
+     * @param req Thallium request
+     */
+    void on_scheduler_stats(const tl::request& req)
+    {
+        m_logger->debug("Getting scheduler stats");
+        req.respond(m_scheduler.stats());
+    }
+
+    /**
+     * @brief RPC (without response) by which storage servers
+     * periodically report their load.
+     *
+     * @param req Thallium request
+     * @param report Report of the storage server
+     */
+    void on_storage_report(
+            const tl::request& req,
+            const storage_report& report)
+    {
+        m_logger->trace("Received load report from storage server {}", report.m_addr);
+        if(m_backend)
+            m_backend->on_storage_report(report);
+    }
+
     public:
 
     /**
@@ -172,18 +660,46 @@ class MasterProvider : public tl::provider<MasterProvider> {
      *
      * @param engine Thallium engine
      * @param logger Logger
+     * @param metadata_pool Pool running the metadata RPCs
+     * @param data_pool Pool running the RPCs transferring model data
+     * @param scheduler_config JSON configuration of the scheduler
      * @param provider_id provider id
      */
-    MasterProvider(tl::engine& engine, spdlog::logger* logger, uint16_t provider_id = 0)
+    MasterProvider(tl::engine& engine, spdlog::logger* logger,
+            const tl::pool& metadata_pool, const tl::pool& data_pool,
+            const std::string& scheduler_config = "",
+            uint16_t provider_id = 0)
     : tl::provider<MasterProvider>(engine, provider_id)
-    , m_logger(logger) {
+    , m_logger(logger)
+    , m_scheduler(logger, scheduler_config) {
         m_logger->debug("Registering RPCs on MasterProvider with provider id {}", provider_id);
-        define("flamestore_shutdown",         &MasterProvider::on_shutdown);
-        define("flamestore_register_model",   &MasterProvider::on_register_model);
-        define("flamestore_reload_model",     &MasterProvider::on_reload_model);
-        define("flamestore_write_model_data", &MasterProvider::on_write_model_data);
-        define("flamestore_read_model_data",  &MasterProvider::on_read_model_data);
-        define("flamestore_dup_model",        &MasterProvider::on_duplicate_model);
+        // RPCs that move model data (or wait for it to move) run in the data
+        // pool so that large checkpoints do not delay the metadata RPCs
+        define("flamestore_shutdown",         &MasterProvider::on_shutdown, metadata_pool);
+        define("flamestore_register_model",   &MasterProvider::on_register_model, metadata_pool);
+        define("flamestore_reload_model",     &MasterProvider::on_reload_model, metadata_pool);
+        define("flamestore_register_model_bulk", &MasterProvider::on_register_model_bulk, metadata_pool);
+        define("flamestore_register_model_by_key", &MasterProvider::on_register_model_by_key, metadata_pool);
+        define("flamestore_stat_model",          &MasterProvider::on_stat_model, metadata_pool);
+        define("flamestore_fetch_model_config",  &MasterProvider::on_fetch_model_config, metadata_pool);
+        define("flamestore_register_and_write_model", &MasterProvider::on_register_and_write_model, data_pool);
+        define("flamestore_reload_model_data",        &MasterProvider::on_reload_model_data, data_pool);
+        define("flamestore_write_model_data", &MasterProvider::on_write_model_data, data_pool);
+        define("flamestore_read_model_data",  &MasterProvider::on_read_model_data, data_pool);
+        define("flamestore_write_model_inline", &MasterProvider::on_write_model_inline, data_pool);
+        define("flamestore_read_model_inline",  &MasterProvider::on_read_model_inline, data_pool);
+        define("flamestore_write_model_batch",  &MasterProvider::on_write_model_batch, data_pool);
+        define("flamestore_read_model_batch",   &MasterProvider::on_read_model_batch, data_pool);
+        define("flamestore_dup_model",        &MasterProvider::on_duplicate_model, data_pool);
+        define("flamestore_dup_many",         &MasterProvider::on_duplicate_many, data_pool);
+        define("flamestore_list_models",      &MasterProvider::on_list_models, metadata_pool);
+        define("flamestore_set_model_tags",   &MasterProvider::on_set_model_tags, metadata_pool);
+        define("flamestore_flush",            &MasterProvider::on_flush, data_pool);
+        define("flamestore_drain_worker",     &MasterProvider::on_drain_worker, data_pool);
+        define("flamestore_backend_stats",    &MasterProvider::on_backend_stats, metadata_pool);
+        define("flamestore_set_client_priority", &MasterProvider::on_set_client_priority, metadata_pool);
+        define("flamestore_scheduler_stats",  &MasterProvider::on_scheduler_stats, metadata_pool);
+        define("flamestore_storage_report",   &MasterProvider::on_storage_report, metadata_pool).disable_response();
         m_logger->debug("RPCs registered");
     }
 
@@ -201,6 +717,14 @@ class MasterProvider : public tl::provider<MasterProvider> {
     inline const std::unique_ptr<AbstractServerBackend>& backend() const {
         return m_backend;
     }
+
+    inline StringPool& strings() {
+        return m_strings;
+    }
+
+    inline Scheduler& scheduler() {
+        return m_scheduler;
+    }
 };
 
 }
@@ -10,7 +10,9 @@ MasterServer::MasterServer(pymargo_instance_id mid,
            const std::string& workspace_path,
            const std::string& backend_name,
            const std::string& logfile, int loglevel,
-           const backend_config_t& backend_config)
+           const backend_config_t& backend_config,
+           const std::string& threading_config,
+           const std::string& scheduler_config)
 : m_engine(CAPSULE2MID(mid))
 , m_workspace_path(workspace_path) {
     // Setting up logging
@@ -31,22 +33,31 @@ MasterServer::MasterServer(pymargo_instance_id mid,
     m_engine.push_prefinalize_callback([this]() {
             m_logger->trace("Pre-finalizing...");
 //            m_provider->backend()->on_shutdown();
+            _stop_membership_processing();
             _ssg_finalize();
             });
     m_engine.push_finalize_callback([this]() {
             m_logger->trace("Finalizing...");
             m_provider.reset();
             m_logger->trace("MasterProvider destroyed");
+            m_pools.reset();
             });
     // Setting up the MasterProvider
     m_engine.enable_remote_shutdown();
-    m_provider = std::make_unique<MasterProvider>(m_engine, m_logger.get());
+    m_pools = std::make_unique<ThreadPools>(m_engine, m_logger.get(), threading_config);
+    m_provider = std::make_unique<MasterProvider>(m_engine, m_logger.get(),
+            m_pools->metadata_pool(), m_pools->data_pool(), scheduler_config);
     // Setting up the backend
     m_server_context.m_engine = &m_engine;
     m_server_context.m_logger = m_logger.get();
+    m_server_context.m_strings = &m_provider->strings();
+    m_server_context.m_io_pool = &m_pools->io_pool();
+    m_server_context.m_scheduler = &m_provider->scheduler();
     m_logger->info("Setting up backend as \"{}\"", backend_name);
     m_provider->backend() = AbstractServerBackend::create(
             backend_name, m_server_context, backend_config, m_logger.get());
+    // Membership changes received so far were queued until the backend exists
+    _start_membership_processing();
 }
 
 std::string MasterServer::get_connection_info() const {
@@ -116,16 +127,83 @@ void MasterServer::_ssg_membership_update(void* arg,
         ssg_member_id_t member_id,
         ssg_member_update_type_t update_type) {
     MasterServer* server = static_cast<MasterServer*>(arg);
+    membership_event e;
+    e.m_member_id = member_id;
+    e.m_type      = update_type;
     if(update_type == SSG_MEMBER_JOINED) {
         server->m_logger->info("Member {} joined", member_id);
+        // the endpoint holds its own copy of the address, which
+        // SSG may free before the event is processed
         hg_addr_t addr = ssg_get_group_member_addr(server->m_ssg_gid, member_id);
-        server->m_provider->backend()->on_worker_joined(static_cast<uint64_t>(member_id), addr);
+        e.m_endpoint = tl::endpoint(server->m_engine, addr, false);
     } else if(update_type == SSG_MEMBER_LEFT) {
         server->m_logger->info("Member {} left", member_id);
-        server->m_provider->backend()->on_worker_left(member_id);
     } else {
         server->m_logger->info("Member {} died", member_id);
-        server->m_provider->backend()->on_worker_died(member_id);
+    }
+    std::lock_guard<tl::mutex> lock(server->m_membership_mutex);
+    if(server->m_membership_stopped) return;
+    server->m_membership_events.push_back(std::move(e));
+    server->m_membership_cv.notify_one();
+}
+
+void MasterServer::_start_membership_processing() {
+    m_logger->debug("Starting the membership processing stream");
+    m_membership_pool = tl::pool::create(tl::pool::access::mpmc, tl::pool::kind::fifo_wait);
+    m_membership_es   = tl::xstream::create(tl::scheduler::predef::basic_wait, *m_membership_pool);
+    m_membership_ult  = m_membership_pool->make_thread([this]() { _process_membership_events(); });
+}
+
+void MasterServer::_stop_membership_processing() {
+    if(!m_membership_ult) return;
+    m_logger->debug("Stopping the membership processing stream");
+    {
+        std::lock_guard<tl::mutex> lock(m_membership_mutex);
+        m_membership_stopped = true;
+        m_membership_cv.notify_one();
+    }
+    m_membership_ult->join();
+    m_membership_es->join();
+    m_membership_ult = tl::managed<tl::thread>();
+    m_membership_es = tl::managed<tl::xstream>();
+    m_membership_pool = tl::managed<tl::pool>();
+}
+
+void MasterServer::_process_membership_events() {
+    auto& backend = m_provider->backend();
+    while(true) {
+        std::deque<membership_event> events;
+        {
+            std::unique_lock<tl::mutex> lock(m_membership_mutex);
+            while(m_membership_events.empty() && !m_membership_stopped)
+                m_membership_cv.wait(lock);
+            if(m_membership_stopped) break;
+            events.swap(m_membership_events);
+        }
+        if(!backend) continue;
+        // consecutive joins are handed to the backend together, so that
+        // a job starting hundreds of storage servers is absorbed in a few
+        // batches instead of one server at a time; a departure is never
+        // reordered with respect to the join of the same member
+        std::vector<std::pair<uint64_t, hg_addr_t>> joined;
+        auto flush_joined = [&]() {
+            if(joined.empty()) return;
+            m_logger->debug("Passing {} new member(s) to the backend", joined.size());
+            backend->on_workers_joined(joined);
+            joined.clear();
+        };
+        for(const auto& e : events) {
+            if(e.m_type == SSG_MEMBER_JOINED) {
+                joined.emplace_back(static_cast<uint64_t>(e.m_member_id), e.m_endpoint.get_addr());
+                continue;
+            }
+            flush_joined();
+            if(e.m_type == SSG_MEMBER_LEFT)
+                backend->on_worker_left(e.m_member_id);
+            else
+                backend->on_worker_died(e.m_member_id);
+        }
+        flush_joined();
     }
 }
 
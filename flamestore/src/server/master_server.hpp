@@ -5,6 +5,7 @@
 #include <thallium.hpp>
 #include <iostream>
 #include <mutex>
+#include <deque>
 #include <unordered_map>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/basic_file_sink.h>
@@ -15,6 +16,7 @@
 #include "server/server_context.hpp"
 #include "server/master_provider.hpp"
 #include "server/backend.hpp"
+#include "server/thread_pools.hpp"
 
 namespace flamestore {
 
@@ -23,13 +25,35 @@ namespace tl = thallium;
 
 class MasterServer {
 
+    /**
+     * @brief SSG membership change waiting to be passed to the backend.
+     */
+    struct membership_event {
+        ssg_member_id_t          m_member_id;
+        ssg_member_update_type_t m_type;
+        tl::endpoint             m_endpoint; // joined members only
+    };
+
     tl::engine                      m_engine;
     std::unique_ptr<spdlog::logger> m_logger;
+    std::unique_ptr<ThreadPools>    m_pools;
     std::unique_ptr<MasterProvider> m_provider;
     ServerContext                   m_server_context;
     std::string                     m_workspace_path;
     ssg_group_id_t                  m_ssg_gid;
 
+    // membership changes are queued by the SSG callback and handed to the
+    // backend by a ULT running in a dedicated pool and execution stream,
+    // so that slow backend callbacks (e.g. probing new storage servers)
+    // neither block SSG nor the RPC handlers
+    tl::mutex                       m_membership_mutex;
+    tl::condition_variable          m_membership_cv;
+    std::deque<membership_event>    m_membership_events;
+    bool                            m_membership_stopped = false;
+    tl::managed<tl::pool>           m_membership_pool;
+    tl::managed<tl::xstream>        m_membership_es;
+    tl::managed<tl::thread>         m_membership_ult;
+
     public:
 
     typedef std::unordered_map<std::string,std::string> backend_config_t;
@@ -38,7 +62,9 @@ class MasterServer {
            const std::string& workspace_path = ".",
            const std::string& backend_name = "master-memory",
            const std::string& logfile = "", int loglevel=2,
-           const backend_config_t& backend_config = backend_config_t());
+           const backend_config_t& backend_config = backend_config_t(),
+           const std::string& threading_config = "",
+           const std::string& scheduler_config = "");
 
     std::string get_connection_info() const;
 
@@ -53,6 +79,12 @@ class MasterServer {
     static void _ssg_membership_update(void* arg,
             ssg_member_id_t member_id,
             ssg_member_update_type_t update_type);
+
+    void _start_membership_processing();
+
+    void _stop_membership_processing();
+
+    void _process_membership_events();
 };
 
 }
@@ -1,5 +1,6 @@
 #include <mutex>
 #include <map>
+#include <algorithm>
 #include <spdlog/spdlog.h>
 #include "model.hpp"
 #include "backend.hpp"
@@ -13,6 +14,7 @@ class MemoryBackend : public AbstractServerBackend {
         struct model_impl {
             std::vector<char> m_model_data;
             tl::bulk          m_model_data_bulk;
+            uint64_t          m_version = 0; // number of writes
         };
 
     public:
@@ -25,6 +27,8 @@ class MemoryBackend : public AbstractServerBackend {
 
         tl::engine*                                   m_engine;
         spdlog::logger*                               m_logger;
+        StringPool*                                   m_strings; // shared configs and signatures
+        Scheduler*                                    m_scheduler; // admission of checkpoints (may be null)
         mutable tl::rwlock                            m_models_rwlock;
         std::map<name_t, std::unique_ptr<model_t>>    m_models;
 
@@ -79,11 +83,49 @@ class MemoryBackend : public AbstractServerBackend {
             }
         }
 
+        /**
+         * @brief Sets the configuration and signature of a newly created
+         * model and allocates its data. The model must be locked.
+         */
+        inline void _init_model(model_t* model,
+                const std::string& model_config,
+                std::size_t model_size,
+                const std::string& model_signature) {
+            model->m_model_config        = m_strings->intern(model_config);
+            model->m_model_signature     = m_strings->intern(model_signature);
+            model->m_impl.m_model_data.resize(model_size);
+            if(model->m_impl.m_model_data.size() != 0) {
+                std::vector<std::pair<void*, size_t>> model_data_ptr(1);
+                model_data_ptr[0].first  = (void*)(model->m_impl.m_model_data.data());
+                model_data_ptr[0].second = model->m_impl.m_model_data.size();
+                model->m_impl.m_model_data_bulk = m_engine->expose(model_data_ptr, tl::bulk_mode::read_write);
+            }
+        }
+
+        /**
+         * @brief Copies the configuration, signature, tags and data of a model
+         * into another model. Both models must be locked.
+         */
+        inline void _copy_model(const model_t* model, model_t* new_model) {
+            new_model->m_model_config = model->m_model_config;
+            new_model->m_model_signature = model->m_model_signature;
+            new_model->m_tags = model->m_tags;
+            new_model->m_impl.m_model_data = model->m_impl.m_model_data;
+            if(new_model->m_impl.m_model_data.size() != 0) {
+                std::vector<std::pair<void*, size_t>> new_model_data_ptr(1);
+                new_model_data_ptr[0].first  = (void*)(new_model->m_impl.m_model_data.data());
+                new_model_data_ptr[0].second = new_model->m_impl.m_model_data.size();
+                new_model->m_impl.m_model_data_bulk = m_engine->expose(new_model_data_ptr, tl::bulk_mode::read_write);
+            }
+        }
+
     public:
 
         MemoryBackend(const ServerContext& ctx, const AbstractServerBackend::config_type& config)
         : m_engine(ctx.m_engine)
-        , m_logger(ctx.m_logger) {
+        , m_logger(ctx.m_logger)
+        , m_strings(ctx.m_strings)
+        , m_scheduler(ctx.m_scheduler) {
             m_logger->debug("Initializing memory backend");
         }
 
@@ -114,6 +156,34 @@ class MemoryBackend : public AbstractServerBackend {
                 const tl::bulk& remote_bulk,
                 const std::size_t& size) override;
 
+        virtual void register_and_write_model(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const std::string& model_config,
+                std::size_t& model_size,
+                const std::string& model_signature,
+                const tl::bulk& remote_bulk,
+                const std::vector<char>& data) override;
+
+        virtual void reload_model_data(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const tl::bulk& remote_bulk,
+                const std::size_t& capacity,
+                const tl::bulk& config_bulk,
+                const std::size_t& config_capacity,
+                const std::size_t& max_inline) override;
+
+        virtual void get_model_info(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const tl::bulk& remote_bulk,
+                const std::size_t& capacity,
+                const std::size_t& max_inline) override;
+
         virtual void read_model(
                 const tl::request& req,
                 const std::string& client_addr,
@@ -122,10 +192,51 @@ class MemoryBackend : public AbstractServerBackend {
                 const tl::bulk& remote_bulk,
                 const std::size_t& size) override;
 
+        virtual void write_model_inline(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const std::string& model_signature,
+                const std::vector<char>& data) override;
+
+        virtual void read_model_inline(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const std::string& model_signature,
+                const std::size_t& size) override;
+
+        virtual void write_model_batch(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::vector<batch_entry>& entries,
+                const tl::bulk& remote_bulk,
+                bool atomic) override;
+
+        virtual void read_model_batch(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::vector<batch_entry>& entries,
+                const tl::bulk& remote_bulk) override;
+
+        virtual void list_models(
+                const tl::request& req,
+                const list_query& query) override;
+
+        virtual void set_model_tags(
+                const tl::request& req,
+                const std::string& model_name,
+                const std::map<std::string, std::string>& tags) override;
+
         virtual void duplicate_model(
                 const tl::request& req,
                 const std::string& model_name,
                 const std::string& new_model_name) override;
+
+        virtual void duplicate_many(
+                const tl::request& req,
+                const std::string& model_name,
+                const std::vector<std::string>& new_model_names) override;
 };
 
 REGISTER_FLAMESTORE_BACKEND("master-memory",MemoryBackend);
@@ -158,16 +269,7 @@ void MemoryBackend::register_model(
 
     try {
 
-        model->m_model_config        = std::move(model_config);
-        model->m_model_signature     = std::move(model_signature);
-        model->m_impl.m_model_data.resize(model_size);
-
-        if(model->m_impl.m_model_data.size() != 0) {
-            std::vector<std::pair<void*, size_t>> model_data_ptr(1);
-            model_data_ptr[0].first  = (void*)(model->m_impl.m_model_data.data());
-            model_data_ptr[0].second = model->m_impl.m_model_data.size();
-            model->m_impl.m_model_data_bulk = m_engine->expose(model_data_ptr, tl::bulk_mode::read_write);
-        }
+        _init_model(model, model_config, model_size, model_signature);
 
     } catch(const tl::exception& e) {
         m_logger->critical("Exception caught in flamestore_provider::on_register_model: {}", e.what());
@@ -192,6 +294,130 @@ void MemoryBackend::reload_model(
     req.respond(Status::OK(model->m_model_config));
 }
 
+void MemoryBackend::register_and_write_model(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::string& model_name,
+        const std::string& model_config,
+        std::size_t& model_size,
+        const std::string& model_signature,
+        const tl::bulk& remote_bulk,
+        const std::vector<char>& data)
+{
+    if(!data.empty() && data.size() != model_size) {
+        m_logger->error("Size {} does not match the size {} of model \"{}\"",
+                data.size(), model_size, model_name);
+        req.respond(Status(FLAMESTORE_EINVAL, "Data size does not match the model's size"));
+        return;
+    }
+    bool created = false;
+    auto model = _find_or_create_model(model_name, created);
+    if(not created) {
+        m_logger->error("Model \"{}\" already exists", model_name);
+        req.respond(Status(
+                    FLAMESTORE_EEXISTS,
+                    "A model with the same name is already registered"));
+        return;
+    }
+    m_logger->info("Registering and writing model \"{}\"", model_name);
+    auto admission = _admit_checkpoint(m_scheduler, req, model_size);
+    lock_guard_t guard(model->m_mutex);
+    try {
+        _init_model(model, model_config, model_size, model_signature);
+        auto& model_data = model->m_impl.m_model_data;
+        if(!data.empty())
+            std::copy(data.begin(), data.end(), model_data.begin());
+        else if(model_size != 0)
+            model->m_impl.m_model_data_bulk << remote_bulk.on(req.get_endpoint());
+    } catch(const tl::exception& e) {
+        m_logger->error("Failed to write model \"{}\": {}", model_name, e.what());
+        req.respond(Status(FLAMESTORE_EIO, "Failed to pull model data"));
+        return;
+    }
+    model->m_impl.m_version += 1;
+    req.respond(Status::OK());
+}
+
+void MemoryBackend::reload_model_data(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::string& model_name,
+        const tl::bulk& remote_bulk,
+        const std::size_t& capacity,
+        const tl::bulk& config_bulk,
+        const std::size_t& config_capacity,
+        const std::size_t& max_inline)
+{
+    reload_result result;
+    auto model = _find_model(model_name);
+    if(model == nullptr) {
+        m_logger->error("Model \"{}\" does not exist", model_name);
+        result.m_status = Status(
+                    FLAMESTORE_ENOEXISTS,
+                    "No model found with provided name");
+        req.respond(result);
+        return;
+    }
+    m_logger->info("Getting model config and data for model \"{}\"", model_name);
+    lock_guard_t guard(model->m_mutex);
+    const auto& model_data = model->m_impl.m_model_data;
+    result.m_status    = Status::OK();
+    result.m_signature = model->m_model_signature;
+    result.m_size      = model_data.size();
+    try {
+        _attach_config(result, model->m_model_config, *m_engine, req, config_bulk, config_capacity, max_inline);
+    } catch(const tl::exception& e) {
+        m_logger->error("Failed to push config of model \"{}\": {}", model_name, e.what());
+        result.m_status = Status(FLAMESTORE_EIO, "Failed to push model config");
+        req.respond(result);
+        return;
+    }
+    if(result.m_size <= max_inline) {
+        result.m_data.assign(model_data.begin(), model_data.end());
+        result.m_transfer = reload_result::INLINE;
+    } else if(!remote_bulk.is_null() && result.m_size <= capacity) {
+        try {
+            model->m_impl.m_model_data_bulk >> remote_bulk.on(req.get_endpoint()).select(0, result.m_size);
+            result.m_transfer = reload_result::BULK;
+        } catch(const tl::exception& e) {
+            m_logger->warn("Failed to push data of model \"{}\": {}", model_name, e.what());
+        }
+    }
+    req.respond(result);
+}
+
+void MemoryBackend::get_model_info(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::string& model_name,
+        const tl::bulk& remote_bulk,
+        const std::size_t& capacity,
+        const std::size_t& max_inline)
+{
+    model_info info;
+    auto model = _find_model(model_name);
+    if(model == nullptr) {
+        m_logger->error("Model \"{}\" does not exist", model_name);
+        info.m_status = Status(
+                    FLAMESTORE_ENOEXISTS,
+                    "No model found with provided name");
+        req.respond(info);
+        return;
+    }
+    lock_guard_t guard(model->m_mutex);
+    info.m_status    = Status::OK();
+    info.m_signature = model->m_model_signature;
+    info.m_size      = model->m_impl.m_model_data.size();
+    info.m_version   = model->m_impl.m_version;
+    try {
+        _attach_config(info, model->m_model_config, *m_engine, req, remote_bulk, capacity, max_inline);
+    } catch(const tl::exception& e) {
+        m_logger->error("Failed to push config of model \"{}\": {}", model_name, e.what());
+        info.m_status = Status(FLAMESTORE_EIO, "Failed to push model config");
+    }
+    req.respond(info);
+}
+
 void MemoryBackend::write_model(
         const tl::request& req,
         const std::string& client_addr,
@@ -209,18 +435,51 @@ void MemoryBackend::write_model(
         m_logger->trace("Leaving write_model");
         return;
     }
+    // a write overtaken by a newer write of the same model does not
+    // transfer its data: it waits for the outcome of the newer write,
+    // and is retried if the latter fails (see pending_writes)
+    pending_writes::guard pending(model->m_pending_writes, model_signature);
     m_logger->info("Pulling data from model \"{}\"", model_name);
-    lock_guard_t guard(model->m_mutex);
-    if(model->m_model_signature != model_signature) {
-        m_logger->error("Unmatching signatures when writing model \"{}\"", model_name);
-        req.respond(Status(
-                    FLAMESTORE_ESIGNATURE,
-                    "Unmatching signatures"));
-        m_logger->trace("Leaving write_model");
+    for(;;) {
+        std::unique_lock<tl::mutex> lock(model->m_mutex);
+        if(model->m_model_signature != model_signature) {
+            m_logger->error("Unmatching signatures when writing model \"{}\"", model_name);
+            req.respond(Status(
+                        FLAMESTORE_ESIGNATURE,
+                        "Unmatching signatures"));
+            m_logger->trace("Leaving write_model");
+            return;
+        }
+        if(size != model->m_impl.m_model_data.size()) {
+            m_logger->error("Size {} does not match the size of model \"{}\"", size, model_name);
+            req.respond(Status(FLAMESTORE_EINVAL, "Data size does not match the model's size"));
+            return;
+        }
+        auto decision = pending.check();
+        Scheduler::ticket admission;
+        if(decision == pending_writes::PROCEED) {
+            bool waited;
+            admission = _admit_checkpoint(m_scheduler, req, size, lock, waited);
+            if(waited) decision = pending.check();
+        }
+        if(decision != pending_writes::PROCEED) {
+            lock.unlock();
+            admission = Scheduler::ticket();
+            if(decision == pending_writes::PARK) {
+                m_logger->debug("Write of model \"{}\" parked behind a newer one", model_name);
+                decision = pending.wait();
+            }
+            if(decision == pending_writes::RETRY) continue;
+            m_logger->debug("Write of model \"{}\" superseded by a newer one", model_name);
+            req.respond(Status(FLAMESTORE_ESUPERSEDED, "Superseded by a newer write"));
+            return;
+        }
+        model->m_impl.m_model_data_bulk << remote_bulk.on(req.get_endpoint());
+        model->m_impl.m_version += 1;
+        pending.complete(true);
+        req.respond(Status::OK());
         return;
     }
-    model->m_impl.m_model_data_bulk << remote_bulk.on(req.get_endpoint());
-    req.respond(Status::OK());
 }
 
 void MemoryBackend::read_model(
@@ -254,6 +513,242 @@ void MemoryBackend::read_model(
     req.respond(Status::OK());
 }
 
+void MemoryBackend::write_model_inline(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::string& model_name,
+        const std::string& model_signature,
+        const std::vector<char>& data)
+{
+    auto model = _find_model(model_name);
+    if(model == nullptr) {
+        m_logger->error("Model \"{}\" does not exist", model_name);
+        req.respond(Status(
+                    FLAMESTORE_ENOEXISTS,
+                    "No model found with provided name"));
+        return;
+    }
+    m_logger->info("Copying inline data to model \"{}\"", model_name);
+    std::unique_lock<tl::mutex> lock(model->m_mutex);
+    if(model->m_model_signature != model_signature) {
+        m_logger->error("Unmatching signatures when writing model \"{}\"", model_name);
+        req.respond(Status(
+                    FLAMESTORE_ESIGNATURE,
+                    "Unmatching signatures"));
+        return;
+    }
+    auto& model_data = model->m_impl.m_model_data;
+    if(data.size() != model_data.size()) {
+        m_logger->error("Size {} does not match the size of model \"{}\"", data.size(), model_name);
+        req.respond(Status(FLAMESTORE_EINVAL, "Data size does not match the model's size"));
+        return;
+    }
+    bool waited;
+    auto admission = _admit_checkpoint(m_scheduler, req, data.size(), lock, waited);
+    std::copy(data.begin(), data.end(), model_data.begin());
+    model->m_impl.m_version += 1;
+    req.respond(Status::OK());
+}
+
+void MemoryBackend::read_model_inline(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::string& model_name,
+        const std::string& model_signature,
+        const std::size_t& size)
+{
+    auto model = _find_model(model_name);
+    if(model == nullptr) {
+        m_logger->error("Model \"{}\" does not exist", model_name);
+        req.respond(std::make_pair(Status(
+                    FLAMESTORE_ENOEXISTS,
+                    "No model found with provided name"), std::vector<char>()));
+        return;
+    }
+    lock_guard_t guard(model->m_mutex);
+    if(model->m_model_signature != model_signature) {
+        m_logger->error("Unmatching signatures when reading model \"{}\"", model_name);
+        req.respond(std::make_pair(Status(
+                    FLAMESTORE_ESIGNATURE,
+                    "Unmatching signatures"), std::vector<char>()));
+        return;
+    }
+    m_logger->info("Sending inline data of model \"{}\"", model_name);
+    const auto& model_data = model->m_impl.m_model_data;
+    std::vector<char> data(model_data.begin(),
+                           model_data.begin() + std::min(size, model_data.size()));
+    req.respond(std::make_pair(Status::OK(), std::move(data)));
+}
+
+void MemoryBackend::write_model_batch(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::vector<batch_entry>& entries,
+        const tl::bulk& remote_bulk,
+        bool atomic)
+{
+    auto ep = req.get_endpoint();
+    auto n = entries.size();
+    std::vector<Status> statuses(n, Status::OK());
+    std::vector<model_t*> models(n, nullptr);
+    bool failed = false;
+    for(std::size_t i = 0; i < n; i++) {
+        models[i] = _find_model(entries[i].m_name);
+        if(models[i] == nullptr) {
+            m_logger->error("Model \"{}\" does not exist", entries[i].m_name);
+            statuses[i] = Status(FLAMESTORE_ENOEXISTS, "No model found with provided name");
+            failed = true;
+        }
+    }
+    if(!atomic) {
+        for(std::size_t i = 0; i < n; i++) {
+            auto model = models[i];
+            if(!model) continue;
+            auto admission = _admit_checkpoint(m_scheduler, req, entries[i].m_size);
+            lock_guard_t guard(model->m_mutex);
+            if(model->m_model_signature != entries[i].m_signature) {
+                m_logger->error("Unmatching signatures when writing model \"{}\"", model->m_name);
+                statuses[i] = Status(FLAMESTORE_ESIGNATURE, "Unmatching signatures");
+                continue;
+            }
+            auto size = entries[i].m_size;
+            if(size != model->m_impl.m_model_data.size()) {
+                m_logger->error("Size {} does not match the size of model \"{}\"", size, model->m_name);
+                statuses[i] = Status(FLAMESTORE_EINVAL, "Data size does not match the model's size");
+                continue;
+            }
+            try {
+                if(size != 0)
+                    model->m_impl.m_model_data_bulk(0, size) << remote_bulk.on(ep).select(entries[i].m_offset, size);
+                model->m_impl.m_version += 1;
+            } catch(const tl::exception& e) {
+                m_logger->error("Failed to pull data of model \"{}\": {}", model->m_name, e.what());
+                statuses[i] = Status(FLAMESTORE_EIO, "Failed to pull model data");
+            }
+        }
+        req.respond(statuses);
+        return;
+    }
+    // all-or-nothing: the data is pulled into temporary buffers and
+    // copied into the models only if it could be pulled for all of them;
+    // locks are taken in name order so that concurrent batches cannot deadlock
+    std::map<std::string, model_t*> sorted;
+    for(std::size_t i = 0; i < n; i++) {
+        if(models[i] && !sorted.emplace(entries[i].m_name, models[i]).second) {
+            statuses[i] = Status(FLAMESTORE_EOTHER, "Model appears twice in the batch");
+            failed = true;
+        }
+    }
+    // admitted as a whole before locking the models, since they cannot
+    // all be unlocked while the batch is queued
+    Scheduler::ticket admission;
+    if(!failed) admission = _admit_checkpoint(m_scheduler, req, batch_bytes(entries));
+    std::vector<std::unique_lock<tl::mutex>> locks;
+    for(auto& m : sorted)
+        locks.emplace_back(m.second->m_mutex);
+    std::vector<std::vector<char>> data(n);
+    for(std::size_t i = 0; i < n && !failed; i++) {
+        if(models[i]->m_model_signature != entries[i].m_signature) {
+            m_logger->error("Unmatching signatures when writing model \"{}\"", models[i]->m_name);
+            statuses[i] = Status(FLAMESTORE_ESIGNATURE, "Unmatching signatures");
+            failed = true;
+            break;
+        }
+        auto size = entries[i].m_size;
+        if(size != models[i]->m_impl.m_model_data.size()) {
+            m_logger->error("Size {} does not match the size of model \"{}\"", size, models[i]->m_name);
+            statuses[i] = Status(FLAMESTORE_EINVAL, "Data size does not match the model's size");
+            failed = true;
+            break;
+        }
+        if(size == 0) continue;
+        data[i].resize(size);
+        try {
+            std::vector<std::pair<void*, size_t>> segment(1, {data[i].data(), size});
+            auto local_bulk = m_engine->expose(segment, tl::bulk_mode::write_only);
+            local_bulk << remote_bulk.on(ep).select(entries[i].m_offset, size);
+        } catch(const tl::exception& e) {
+            m_logger->error("Failed to pull data of model \"{}\": {}", models[i]->m_name, e.what());
+            statuses[i] = Status(FLAMESTORE_EIO, "Failed to pull model data");
+            failed = true;
+        }
+    }
+    if(failed) {
+        for(auto& status : statuses)
+            if(status.m_code == FLAMESTORE_OK)
+                status = Status(FLAMESTORE_EOTHER, "Batch aborted");
+        req.respond(statuses);
+        return;
+    }
+    for(std::size_t i = 0; i < n; i++) {
+        std::copy(data[i].begin(), data[i].end(), models[i]->m_impl.m_model_data.begin());
+        models[i]->m_impl.m_version += 1;
+    }
+    req.respond(statuses);
+}
+
+void MemoryBackend::read_model_batch(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::vector<batch_entry>& entries,
+        const tl::bulk& remote_bulk)
+{
+    auto ep = req.get_endpoint();
+    std::vector<Status> statuses(entries.size(), Status::OK());
+    for(std::size_t i = 0; i < entries.size(); i++) {
+        auto model = _find_model(entries[i].m_name);
+        if(model == nullptr) {
+            m_logger->error("Model \"{}\" does not exist", entries[i].m_name);
+            statuses[i] = Status(FLAMESTORE_ENOEXISTS, "No model found with provided name");
+            continue;
+        }
+        lock_guard_t guard(model->m_mutex);
+        if(model->m_model_signature != entries[i].m_signature) {
+            m_logger->error("Unmatching signatures when reading model \"{}\"", model->m_name);
+            statuses[i] = Status(FLAMESTORE_ESIGNATURE, "Unmatching signatures");
+            continue;
+        }
+        auto size = std::min(entries[i].m_size, model->m_impl.m_model_data.size());
+        try {
+            if(size != 0)
+                model->m_impl.m_model_data_bulk(0, size) >> remote_bulk.on(ep).select(entries[i].m_offset, size);
+        } catch(const tl::exception& e) {
+            m_logger->error("Failed to push data of model \"{}\": {}", model->m_name, e.what());
+            statuses[i] = Status(FLAMESTORE_EIO, "Failed to push model data");
+        }
+    }
+    req.respond(statuses);
+}
+
+void MemoryBackend::list_models(
+        const tl::request& req,
+        const list_query& query)
+{
+    m_logger->info("Entering MemoryBackend::list_models");
+    auto page = _list_page(m_models, m_models_rwlock, query,
+            [](const model_t& model) { return model.m_impl.m_model_data.size(); });
+    req.respond(page);
+}
+
+void MemoryBackend::set_model_tags(
+        const tl::request& req,
+        const std::string& model_name,
+        const std::map<std::string, std::string>& tags)
+{
+    m_logger->info("Entering MemoryBackend::set_model_tags");
+    auto model = _find_model(model_name);
+    if(model == nullptr) {
+        m_logger->error("Model \"{}\" does not exist", model_name);
+        req.respond(Status(
+                    FLAMESTORE_ENOEXISTS,
+                    "No model found with provided name"));
+        return;
+    }
+    lock_guard_t guard(model->m_mutex);
+    model->m_tags = tags;
+    req.respond(Status::OK());
+}
+
 void MemoryBackend::duplicate_model(
         const tl::request& req,
         const std::string& model_name,
@@ -281,17 +776,42 @@ void MemoryBackend::duplicate_model(
 
     lock_guard_t guard(model->m_mutex);
     lock_guard_t guard2(new_model->m_mutex);
-    new_model->m_model_config = model->m_model_config;
-    new_model->m_model_signature = model->m_model_signature;
-    new_model->m_impl.m_model_data = model->m_impl.m_model_data;
-    if(new_model->m_impl.m_model_data.size() != 0) {
-        std::vector<std::pair<void*, size_t>> new_model_data_ptr(1);
-        new_model_data_ptr[0].first  = (void*)(new_model->m_impl.m_model_data.data());
-        new_model_data_ptr[0].second = new_model->m_impl.m_model_data.size();
-        new_model->m_impl.m_model_data_bulk = m_engine->expose(new_model_data_ptr, tl::bulk_mode::read_write);
-    }
+    _copy_model(model, new_model);
     req.respond(Status::OK());
 }
 
+void MemoryBackend::duplicate_many(
+        const tl::request& req,
+        const std::string& model_name,
+        const std::vector<std::string>& new_model_names)
+{
+    m_logger->info("Entering MemoryBackend::duplicate_many");
+    std::vector<Status> result(new_model_names.size());
+    auto model = _find_model(model_name);
+    if(model == nullptr) {
+        m_logger->error("Model \"{}\" does not exist", model_name);
+        std::fill(result.begin(), result.end(), Status(
+                    FLAMESTORE_ENOEXISTS,
+                    "No model found with provided name"));
+        req.respond(result);
+        return;
+    }
+    lock_guard_t guard(model->m_mutex);
+    for(std::size_t i = 0; i < new_model_names.size(); i++) {
+        bool created = false;
+        auto new_model = _find_or_create_model(new_model_names[i], created);
+        if(not created) {
+            m_logger->error("Model \"{}\" already exists", new_model_names[i]);
+            result[i] = Status(
+                    FLAMESTORE_EEXISTS,
+                    "A model with the same name is already registered");
+            continue;
+        }
+        lock_guard_t guard2(new_model->m_mutex);
+        _copy_model(model, new_model);
+    }
+    req.respond(result);
+}
+
 }
 
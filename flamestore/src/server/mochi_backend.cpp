@@ -1,11 +1,29 @@
 #include <mutex>
 #include <map>
+#include <set>
+#include <deque>
 #include <unordered_map>
 #include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <cstring>
+#include <chrono>
+#include <tuple>
+#include <iterator>
 #include <spdlog/spdlog.h>
+#include <json/json.h>
 #include <bake-client.hpp>
 #include "model.hpp"
 #include "backend.hpp"
+#include "commit_record.hpp"
+#include "placement.hpp"
+#include "storage_stats.hpp"
+#include "erasure_code.hpp"
+#include "catalog.hpp"
+#include "persist_request.hpp"
+#include "copy_request.hpp"
+#include "slab_allocator.hpp"
+#include "read_cache.hpp"
 
 namespace flamestore {
 
@@ -13,17 +31,253 @@ namespace tl = thallium;
 
 class MochiBackend : public AbstractServerBackend {
 
+        /**
+         * @brief Persist request waiting to be sent as part of a batch.
+         */
+        struct pending_persist {
+            persist_request       m_request;
+            tl::eventual<int32_t> m_result;
+        };
+
+        /**
+         * @brief Persist requests queued for a storage target (group commit).
+         */
+        struct persist_queue {
+            tl::mutex                                     m_mutex;
+            tl::condition_variable                        m_cv;
+            std::vector<std::shared_ptr<pending_persist>> m_pending;
+            std::size_t                                   m_bytes = 0;
+            bool                                          m_leader = false;
+        };
+
+        struct model_impl;
+        using hosted_model = flamestore_model<model_impl>;
+
+        /**
+         * @brief Slabs of a location: shared Bake regions holding the
+         * extents of packed (small) models, see _allocate_packed.
+         */
+        struct slab_set {
+            tl::mutex                                    m_mutex;
+            SlabAllocator                                m_allocator;
+            std::vector<bake::region>                    m_regions; // by slab index
+            std::unordered_map<std::string, std::size_t> m_index;   // encoded region -> slab index
+            std::map<std::pair<std::size_t, std::size_t>,
+                     hosted_model*>                      m_extents; // (slab, offset) -> model
+            std::atomic<bool>                            m_compacting{false};
+        };
+
+        /**
+         * @brief Last load report received for a location.
+         */
+        struct location_report {
+            target_stats                          m_stats;
+            uint64_t                              m_pending = 0; // ULTs waiting on the server
+            std::chrono::steady_clock::time_point m_time;
+        };
+
         struct location {
-            tl::endpoint          m_endpoint;
-            uint64_t              m_ssg_member_id;
-            bake::provider_handle m_phandle;
-            bake::target          m_target;
+            tl::endpoint             m_endpoint;
+            uint64_t                 m_ssg_member_id;
+            bake::provider_handle    m_phandle;
+            bake::target             m_target;
+            std::string              m_key;
+            std::string              m_target_id;     // persistent id of the Bake target
+            std::size_t              m_target_index = 0; // position in the server's probe
+            std::atomic<std::size_t> m_capacity{0};  // refreshed by the storage reports
+            std::atomic<std::size_t> m_allocated{0};
+            std::atomic<std::size_t> m_inflight{0};
+            std::atomic<uint32_t>    m_operations{0}; // Bake operations in progress, see inflight_guard
+            std::atomic<uint32_t>    m_latency_us{0}; // moving average of their duration
+            std::atomic<uint64_t>    m_completed{0};
+            std::atomic<bool>        m_draining{false};
+            persist_queue            m_persist_queue;
+            slab_set                 m_slabs;
+            std::shared_ptr<const location_report> m_report; // atomic access, see _report_of
+            mutable tl::mutex        m_hosted_mutex;
+            std::unordered_map<hosted_model*, std::size_t> m_hosted; // models with replicas here
+
+            /**
+             * @brief Index of the models having replicas on this location
+             * (with their number of replicas here), so that the rebalancer
+             * and drains do not have to go through all the models.
+             */
+            void host(hosted_model* model) {
+                std::lock_guard<tl::mutex> lock(m_hosted_mutex);
+                m_hosted[model] += 1;
+            }
+
+            void unhost(hosted_model* model) {
+                std::lock_guard<tl::mutex> lock(m_hosted_mutex);
+                auto it = m_hosted.find(model);
+                if(it != m_hosted.end() && --it->second == 0)
+                    m_hosted.erase(it);
+            }
+
+            std::vector<hosted_model*> hosted() const {
+                std::lock_guard<tl::mutex> lock(m_hosted_mutex);
+                std::vector<hosted_model*> result;
+                result.reserve(m_hosted.size());
+                for(const auto& p : m_hosted)
+                    result.push_back(p.first);
+                return result;
+            }
         };
 
-        struct model_impl {
+        /**
+         * @brief Accounts for a Bake operation issued by the master to/from
+         * a location for the duration of a scope: its bytes in flight, the
+         * number of operations in progress, and (when the scope ends) the
+         * moving average of the duration of an operation, which the
+         * placement uses as a tie-break.
+         */
+        struct inflight_guard {
+            location&                             m_location;
+            std::size_t                           m_size;
+            std::chrono::steady_clock::time_point m_start;
+
+            inflight_guard(location& loc, std::size_t size)
+            : m_location(loc)
+            , m_size(size)
+            , m_start(std::chrono::steady_clock::now()) {
+                m_location.m_inflight   += m_size;
+                m_location.m_operations += 1;
+            }
+
+            ~inflight_guard() {
+                auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - m_start).count();
+                uint32_t old = m_location.m_latency_us;
+                m_location.m_latency_us  = old == 0 ? (uint32_t)us
+                                         : (uint32_t)((7*(uint64_t)old + (uint64_t)us) / 8);
+                m_location.m_completed  += 1;
+                m_location.m_operations -= 1;
+                m_location.m_inflight   -= m_size;
+            }
+        };
+
+        /**
+         * @brief A replica is a copy of a stripe on a given location.
+         * Replicas of the stripes for which model_impl::has_commit is
+         * true also hold a copy of the model's commit region.
+         */
+        struct replica {
             std::weak_ptr<location> m_location;
-            bake::region            m_region;
-            std::size_t             m_size;
+            std::string             m_target_id;     // survives the location
+            bake::region            m_regions[2];    // shadow extents
+            bake::region            m_commit_region; // see model_impl::has_commit
+            std::size_t             m_offsets[2] = {0, 0}; // of the shadow extents in their regions
+            std::size_t             m_commit_offset = 0;
+            std::size_t             m_slab = 0;      // slab index, packed models only
+            std::size_t             m_slab_size = 0; // size of this slab
+            uint64_t                m_version = 0;   // last version written here
+
+            void bind(const std::shared_ptr<location>& loc, hosted_model* model) {
+                m_location  = loc;
+                m_target_id = loc->m_target_id;
+                loc->host(model);
+            }
+        };
+
+        /**
+         * @brief Piece of a Bake region.
+         */
+        struct extent {
+            bake::region m_region;
+            std::size_t  m_offset = 0;
+        };
+
+        /**
+         * @brief A stripe is a contiguous piece of a model's data,
+         * replicated on locations of distinct storage servers.
+         */
+        struct stripe {
+            std::vector<replica>    m_replicas;
+            std::size_t             m_offset = 0; // offset in the model's data
+            std::size_t             m_size = 0;
+        };
+
+        /**
+         * @brief Version of a model held in the burst buffer,
+         * waiting to be written to Bake.
+         */
+        struct staged_write {
+            std::vector<char>       m_data;
+            tl::bulk                m_bulk;
+            uint64_t                m_burst_seq = 0; // see _reserve_burst_buffer
+        };
+
+        /**
+         * @brief Progress of the copy of a model being duplicated. Each
+         * replica of the new model is filled either by cloning a replica
+         * of the source on the same target, or chunk by chunk from another
+         * target; m_left counts the copies still running for each replica.
+         * It is shared with the source model, which must not overwrite or
+         * move the regions being copied until the copy is done.
+         */
+        struct copy_state {
+            tl::mutex                             m_mutex;
+            tl::condition_variable                m_cv;
+            std::vector<std::vector<std::size_t>> m_left;   // [stripe][replica]
+            std::vector<std::vector<char>>        m_failed; // [stripe][replica]
+            std::size_t                           m_total_left = 0;
+            std::string                           m_error;
+
+            inline bool ready(std::size_t i, std::size_t j) const {
+                return m_left[i][j] == 0 && !m_failed[i][j];
+            }
+
+            /**
+             * @brief A stripe is settled once one of its replicas is
+             * ready to be read or all of them are done or failed.
+             */
+            inline bool settled(std::size_t i) const {
+                for(std::size_t j = 0; j < m_left[i].size(); j++)
+                    if(ready(i, j)) return true;
+                for(std::size_t j = 0; j < m_left[i].size(); j++)
+                    if(m_left[i][j] != 0 && !m_failed[i][j]) return false;
+                return true;
+            }
+        };
+
+        struct model_impl {
+            std::vector<stripe>     m_stripes;
+            uint64_t                m_version = 0;   // last committed version
+            uint64_t                m_writes = 0;    // writes acknowledged, never decreases
+            std::size_t             m_size = 0;      // set by _register, see _size_of
+            unsigned                m_ec_data = 0;   // 0 if not erasure coded
+            unsigned                m_ec_parity = 0;
+            std::deque<std::shared_ptr<staged_write>> m_staged; // oldest first
+            std::shared_ptr<staged_write>             m_failed; // last staged version that failed to drain
+            std::shared_ptr<copy_state>               m_copy;   // being filled by a duplicate
+            bool                                      m_packed = false; // replicas are slab extents
+            std::vector<std::shared_ptr<copy_state>>  m_copies_out; // duplicates reading from it
+            std::size_t                               m_commit_stripes = 1; // see has_commit
+            std::string                               m_copy_error; // set if filling it as a duplicate failed
+
+            inline uint32_t committed_slot() const {
+                return commit_record::slot_of(m_version);
+            }
+
+            /**
+             * @brief Latest version of the model held in the burst buffer,
+             * if it is more recent than the committed one. A version that
+             * failed to drain is kept readable until a flush reports it.
+             */
+            inline const staged_write* latest_staged() const {
+                if(!m_staged.empty()) return m_staged.back().get();
+                return m_failed.get();
+            }
+
+            /**
+             * @brief Whether the replicas of stripe i hold a copy of the
+             * commit records: the first stripe of a replicated model, the
+             * first m+1 fragments of an erasure-coded one (so that the
+             * records survive the loss of any m fragments).
+             */
+            inline bool has_commit(std::size_t i) const {
+                return i < m_commit_stripes;
+            }
         };
 
 
@@ -32,17 +286,67 @@ class MochiBackend : public AbstractServerBackend {
         using model_t = flamestore_model<model_impl>;
         using name_t = std::string;
         using lock_guard_t = std::lock_guard<tl::mutex>;
+        using location_table = std::vector<std::shared_ptr<location>>;
 
     private:
 
         tl::engine*                                 m_engine;
         spdlog::logger*                             m_logger;
+        StringPool*                                 m_strings; // shared configs and signatures
+        Scheduler*                                  m_scheduler; // admission of checkpoints (may be null)
+        tl::pool                                    m_io_pool; // runs the background I/O ULTs
+        std::atomic<uint64_t>                       m_superseded_writes{0};
         mutable tl::rwlock                          m_models_rwlock;
         std::map<name_t, std::unique_ptr<model_t>>  m_models;
         bake::client                                m_bake_client;
 
-        std::vector<std::shared_ptr<location>>      m_storage_locations;
-        tl::rwlock                                  m_storage_locations_lock;
+        // the location table is immutable once published: readers take a
+        // reference to the current table (see _locations), writers build a
+        // new table and publish it atomically (see _update_locations)
+        std::shared_ptr<const location_table>       m_storage_locations = std::make_shared<const location_table>();
+        tl::mutex                                   m_storage_locations_mutex; // writers only
+        std::unique_ptr<AbstractPlacementPolicy>    m_placement;
+        tl::remote_procedure                        m_rpc_storage_stats;
+        std::size_t                                 m_stripe_size = 0;
+        std::size_t                                 m_stripe_count = 1; // 0 = number of targets
+        std::size_t                                 m_replication = 1;
+        unsigned                                    m_hedge_delay_ms = 0;
+        std::unique_ptr<ErasureCode>                m_erasure_code;
+        std::unique_ptr<Catalog>                    m_catalog;
+        bool                                        m_catalog_sync = false; // flush before acknowledging new models
+        unsigned                                    m_group_commit_us = 0; // 0 = disabled
+        std::size_t                                 m_group_commit_bytes = 16*1024*1024;
+        tl::remote_procedure                        m_rpc_persist_batch;
+        std::size_t                                 m_burst_buffer_size = 0; // 0 = disabled
+        std::size_t                                 m_burst_used = 0;
+        uint64_t                                    m_burst_next_seq = 0;
+        std::set<uint64_t>                          m_burst_pending;      // staged writes not drained
+        std::size_t                                 m_burst_failures = 0; // since the last flush
+        std::string                                 m_burst_error;
+        std::set<model_t*>                          m_burst_failed;       // models holding a failed version
+        tl::mutex                                   m_burst_mutex;
+        tl::condition_variable                      m_burst_cv;
+        std::unique_ptr<ReadCache>                  m_read_cache;
+        tl::remote_procedure                        m_rpc_copy_chunk;
+        std::size_t                                 m_copy_chunk_size = 4*1024*1024;
+        std::size_t                                 m_copy_parallelism = 8;
+        bool                                        m_duplicate_locality = true;
+        std::size_t                                 m_packed_threshold = 0; // 0 = disabled
+        std::size_t                                 m_slab_size = 16*1024*1024;
+        double                                      m_slab_compaction = 0.25;
+        tl::endpoint                                m_self_ep;
+        std::string                                 m_self_addr; // m_self_ep as a string
+        std::atomic<std::size_t>                    m_read_counter{0};
+        bool                                        m_rebalance = true;
+        double                                      m_rebalance_threshold = 0.1;
+        std::size_t                                 m_rebalance_rate = 0; // bytes/sec, 0 = unlimited
+        tl::mutex                                   m_rebalance_mutex;
+        tl::condition_variable                      m_rebalance_cv;
+        bool                                        m_rebalance_requested = false;
+        tl::managed<tl::thread>                     m_rebalancer;
+        uint64_t                                    m_report_ttl_ms = 5000;
+        uint32_t                                    m_busy_queue_depth = 8;
+        std::atomic<bool>                           m_shutting_down{false};
 
         /**
          * @brief Finds a model with the provided name in the map.
@@ -94,61 +398,2998 @@ class MochiBackend : public AbstractServerBackend {
             }
         }
 
-    public:
+        /**
+         * @brief Parses a size with an optional K, M, or G suffix.
+         */
+        static inline std::size_t _parse_size(const std::string& str) {
+            std::size_t pos = 0;
+            std::size_t size = std::stoul(str, &pos);
+            if(pos == str.size()) return size;
+            switch(str[pos]) {
+                case 'K': return size << 10;
+                case 'M': return size << 20;
+                case 'G': return size << 30;
+                default: throw std::invalid_argument("Invalid size "+str);
+            }
+        }
 
-        MochiBackend(const ServerContext& ctx, const AbstractServerBackend::config_type& config)
-        : m_engine(ctx.m_engine)
-        , m_logger(ctx.m_logger)
-        , m_bake_client(m_engine->get_margo_instance()) {
-            m_logger->debug("Initializing memory backend");
+        /**
+         * @brief Computes how a model of a given size is split into
+         * stripes. The model is cut into at most m_stripe_count
+         * contiguous pieces (at most the number of storage targets if
+         * m_stripe_count is 0, so that a model is spread on all the
+         * devices), each a multiple of m_stripe_size (except for the
+         * last one), so models smaller than m_stripe_size are never
+         * striped.
+         *
+         * @param size Size of the model.
+         * @param stripes Resulting stripes (only offsets and sizes are set).
+         */
+        inline void _compute_layout(std::size_t size, std::vector<stripe>& stripes) const {
+            std::size_t count = 1;
+            if(m_stripe_size != 0) {
+                count = (size + m_stripe_size - 1) / m_stripe_size;
+                auto max_count = m_stripe_count ? m_stripe_count : _locations()->size();
+                count = std::max<std::size_t>(1, std::min(count, max_count));
+            }
+            std::size_t piece = (size + count - 1) / count;
+            if(m_stripe_size != 0)
+                piece = ((piece + m_stripe_size - 1) / m_stripe_size) * m_stripe_size;
+            if(piece != 0)
+                count = (size + piece - 1) / piece;
+            stripes.resize(count);
+            for(std::size_t i = 0; i < count; i++) {
+                stripes[i].m_offset = i*piece;
+                stripes[i].m_size   = std::min(piece, size - i*piece);
+            }
         }
 
-        MochiBackend(const AbstractServerBackend&)            = delete;
-        MochiBackend(AbstractServerBackend&&)                 = delete;
-        MochiBackend& operator=(const AbstractServerBackend&) = delete;
-        MochiBackend& operator=(AbstractServerBackend&&)      = delete;
-        ~MochiBackend()                              = default;
+        /**
+         * @brief Returns the last load report of a location,
+         * or nullptr if none was received in the last m_report_ttl_ms.
+         */
+        inline std::shared_ptr<const location_report> _report_of(const location& l) const {
+            auto report = std::atomic_load(&l.m_report);
+            if(report && std::chrono::steady_clock::now() - report->m_time
+                    > std::chrono::milliseconds(m_report_ttl_ms))
+                return nullptr;
+            return report;
+        }
 
-        virtual void register_model(
-                const tl::request& req,
-                const std::string& client_addr,
-                const std::string& model_name,
-                const std::string& model_config,
-                std::size_t& model_size,
-                const std::string& model_signature) override;
+        /**
+         * @brief Whether the storage server of a location recently
+         * reported at least m_busy_queue_depth operations in progress
+         * on its target.
+         */
+        inline bool _busy(const location& l) const {
+            auto report = _report_of(l);
+            return report && report->m_stats.m_queue_depth >= m_busy_queue_depth;
+        }
 
-        virtual void reload_model(
-                const tl::request& req,
-                const std::string& client_addr,
-                const std::string& model_name) override;
+        /**
+         * @brief Returns the current location table. The table is never
+         * modified, so it can be used without any lock for as long as
+         * the returned pointer is held.
+         */
+        inline std::shared_ptr<const location_table> _locations() const {
+            return std::atomic_load(&m_storage_locations);
+        }
+
+        /**
+         * @brief Publishes a new location table, computed by applying f
+         * to a copy of the current one. Updates are serialized.
+         */
+        template<typename F>
+        inline void _update_locations(F&& f) {
+            lock_guard_t lock(m_storage_locations_mutex);
+            auto table = std::make_shared<location_table>(*_locations());
+            f(*table);
+            std::atomic_store(&m_storage_locations, std::shared_ptr<const location_table>(std::move(table)));
+        }
+
+        /**
+         * @brief Checks that a name can be used for a new model
+         * (model names are the keys of the catalog).
+         */
+        inline Status _check_name(const std::string& model_name) const {
+            if(m_catalog && model_name.size() > Catalog::s_max_key_size) {
+                m_logger->error("Model name of {} bytes exceeds the maximum of {} bytes",
+                        model_name.size(), (std::size_t)Catalog::s_max_key_size);
+                return Status(FLAMESTORE_EINVAL, "Model name too long");
+            }
+            return Status::OK();
+        }
+
+        /**
+         * @brief In catalog_sync mode, writes the catalog entries of new
+         * models to the database before they are acknowledged.
+         */
+        inline Status _sync_catalog() {
+            if(!m_catalog || !m_catalog_sync || m_catalog->flush())
+                return Status::OK();
+            m_logger->error("Catalog entries of new models could not be persisted");
+            return Status(FLAMESTORE_EIO, "Model created but its catalog entry could not be persisted");
+        }
+
+        /**
+         * @brief Uses the placement policy to select the locations of
+         * the replicas of each stripe of a model. Replicas of a same
+         * stripe are always on distinct storage servers. Stripes are
+         * spread on distinct storage servers first, then on distinct
+         * targets, and share targets only as a last resort.
+         *
+         * @param model_name Name of the model.
+         * @param size Space required on each location.
+         * @param num_stripes Number of stripes.
+         * @param replication Requested number of replicas per stripe.
+         * @param distinct_servers Whether all the replicas of all the
+         * stripes must be on distinct storage servers (fragments of an
+         * erasure-coded model), instead of only those of a same stripe.
+         *
+         * @return the selected locations ([stripe][replica]), or an empty
+         * vector if a stripe could not get any location. Stripes get fewer
+         * replicas than requested if there are not enough storage servers.
+         */
+        inline std::vector<std::vector<std::shared_ptr<location>>> _select_locations(
+                const std::string& model_name, std::size_t size,
+                std::size_t num_stripes, std::size_t replication,
+                bool distinct_servers = false) {
+            std::vector<placement_target> targets;
+            auto locations = *_locations();
+            targets.reserve(locations.size());
+            locations.erase(
+                std::remove_if(locations.begin(), locations.end(),
+                    [](const std::shared_ptr<location>& l) { return l->m_draining.load(); }),
+                locations.end());
+            for(const auto& l : locations) {
+                placement_target t;
+                t.m_key       = l->m_key;
+                t.m_server    = l->m_ssg_member_id;
+                t.m_capacity  = l->m_capacity;
+                t.m_allocated = l->m_allocated;
+                t.m_inflight  = l->m_inflight;
+                t.m_operations = l->m_operations;
+                t.m_latency_us = l->m_latency_us;
+                if(auto report = _report_of(*l)) {
+                    t.m_device_free = report->m_stats.m_device_free;
+                    t.m_queue_depth = report->m_stats.m_queue_depth;
+                    if(t.m_latency_us == 0)
+                        t.m_latency_us = report->m_stats.m_latency_us;
+                }
+                targets.push_back(std::move(t));
+            }
+            auto ranked = m_placement->select(targets, model_name, size, targets.size());
+            std::vector<std::vector<std::shared_ptr<location>>> result(num_stripes);
+            std::vector<bool> used_targets(targets.size(), false);
+            std::vector<uint64_t> used_servers;
+            auto contains = [](const std::vector<uint64_t>& v, uint64_t x) {
+                return std::find(v.begin(), v.end(), x) != v.end();
+            };
+            for(auto& stripe_locs : result) {
+                std::vector<uint64_t> stripe_servers;
+                for(std::size_t r = 0; r < replication; r++) {
+                    bool found = false;
+                    int passes = distinct_servers ? 1 : 3;
+                    for(int pass = 0; pass < passes && !found; pass++) {
+                        for(auto i : ranked) {
+                            auto server = targets[i].m_server;
+                            if(contains(stripe_servers, server)) continue;
+                            if(pass == 0 && contains(used_servers, server)) continue;
+                            if(pass <= 1 && used_targets[i]) continue;
+                            used_targets[i] = true;
+                            used_servers.push_back(server);
+                            stripe_servers.push_back(server);
+                            stripe_locs.push_back(locations[i]);
+                            m_logger->debug("Selecting storage target {}/{}", i+1, locations.size());
+                            found = true;
+                            break;
+                        }
+                    }
+                    if(!found) break;
+                }
+                if(stripe_locs.empty())
+                    return {};
+                if(stripe_locs.size() < replication)
+                    m_logger->warn("Only {} storage server(s) available for {} replicas of model \"{}\"",
+                            stripe_locs.size(), replication, model_name);
+            }
+            return result;
+        }
+
+        /**
+         * @brief Lists the (stripe, replica) index pairs of a model.
+         */
+        static inline std::vector<std::pair<std::size_t, std::size_t>>
+        _list_replicas(const model_t* model) {
+            std::vector<std::pair<std::size_t, std::size_t>> result;
+            const auto& stripes = model->m_impl.m_stripes;
+            for(std::size_t i = 0; i < stripes.size(); i++)
+                for(std::size_t j = 0; j < stripes[i].m_replicas.size(); j++)
+                    result.emplace_back(i, j);
+            return result;
+        }
+
+        /**
+         * @brief Returns the absolute time (as expected by
+         * tl::condition_variable::wait_until) ns nanoseconds from now.
+         */
+        static inline struct timespec _deadline_after(uint64_t ns) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec  += (deadline.tv_nsec + ns) / 1000000000;
+            deadline.tv_nsec  = (deadline.tv_nsec + ns) % 1000000000;
+            return deadline;
+        }
+
+        /**
+         * @brief Sends a batch of persist requests to the storage server
+         * holding a target and sets the result of each request.
+         */
+        inline void _send_persist_batch(location& loc,
+                const std::vector<std::shared_ptr<pending_persist>>& batch) {
+            std::vector<persist_request> requests;
+            requests.reserve(batch.size());
+            for(const auto& p : batch)
+                requests.push_back(p->m_request);
+            std::vector<int32_t> result;
+            try {
+                result = m_rpc_persist_batch.on(loc.m_endpoint)(requests).as<std::vector<int32_t>>();
+            } catch(const std::exception& ex) {
+                m_logger->error("Could not send persist batch to {}: {}", loc.m_key, ex.what());
+            }
+            for(std::size_t i = 0; i < batch.size(); i++)
+                batch[i]->m_result.set_value(i < result.size() ? result[i] : -1);
+            m_logger->debug("Persisted batch of {} request(s) on {}", batch.size(), loc.m_key);
+        }
+
+        /**
+         * @brief Persists a range of a region. If group commit is enabled,
+         * the request is queued with the other requests for the same target,
+         * and the queue is sent as a single flamestore_persist_batch RPC
+         * m_group_commit_us after the first request was queued, or as soon
+         * as m_group_commit_bytes are queued. The caller that finds the queue
+         * empty is in charge of sending the batch. Every caller returns only
+         * once its own request has been persisted.
+         *
+         * Throws std::runtime_error if the range could not be persisted.
+         */
+        inline void _persist(location& loc, const bake::region& region,
+                             std::size_t offset, std::size_t size) {
+            if(m_group_commit_us == 0) {
+                m_bake_client.persist(loc.m_phandle, loc.m_target, region, offset, size);
+                return;
+            }
+            auto entry = std::make_shared<pending_persist>();
+            entry->m_request.m_target = loc.m_target;
+            entry->m_request.m_region = region;
+            entry->m_request.m_offset = offset;
+            entry->m_request.m_size   = size;
+            auto& q = loc.m_persist_queue;
+            std::vector<std::shared_ptr<pending_persist>> batch;
+            {
+                std::unique_lock<tl::mutex> lock(q.m_mutex);
+                q.m_pending.push_back(entry);
+                q.m_bytes += size;
+                if(q.m_leader) {
+                    if(q.m_bytes >= m_group_commit_bytes)
+                        q.m_cv.notify_one();
+                } else {
+                    q.m_leader = true;
+                    auto deadline = _deadline_after((uint64_t)m_group_commit_us * 1000);
+                    while(q.m_bytes < m_group_commit_bytes && q.m_cv.wait_until(lock, &deadline));
+                    batch.swap(q.m_pending);
+                    q.m_bytes  = 0;
+                    q.m_leader = false;
+                }
+            }
+            if(!batch.empty())
+                _send_persist_batch(loc, batch);
+            int32_t ret = entry->m_result.wait();
+            if(ret != 0)
+                throw std::runtime_error("Bake persist failed with error code "+std::to_string(ret));
+        }
+
+        /**
+         * @brief Runs f(i) for i in [0, n) in concurrent ULTs (inline if
+         * n == 1) and waits for all of them to complete. Exceptions
+         * thrown by f are caught; the first one's message is put in error.
+         *
+         * @return true if all the calls succeeded.
+         */
+        template<typename F>
+        inline bool _parallel_for(std::size_t n, F&& f, std::string& error) {
+            std::vector<std::string> errors(n);
+            auto run = [&f, &errors](std::size_t i) {
+                try {
+                    f(i);
+                } catch(const std::exception& ex) {
+                    errors[i] = ex.what();
+                    if(errors[i].empty()) errors[i] = "Bake error";
+                }
+            };
+            if(n == 1) {
+                run(0);
+            } else {
+                std::vector<tl::managed<tl::thread>> ults;
+                ults.reserve(n);
+                for(std::size_t i = 0; i < n; i++)
+                    ults.push_back(tl::xstream::self().make_thread([&run, i]() { run(i); }));
+                for(auto& ult : ults)
+                    ult->join();
+            }
+            for(auto& e : errors) {
+                if(!e.empty()) {
+                    error = e;
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Size of the extent holding a replica of a packed model:
+         * both shadow extents followed by the commit records.
+         */
+        static inline std::size_t _packed_extent(std::size_t size) {
+            return 2*size + commit_record::region_size();
+        }
+
+        /**
+         * @brief Points a replica of a packed model to an extent of a slab.
+         */
+        static inline void _assign_packed(replica& r, const slab_set& slabs,
+                std::size_t slab, std::size_t base, std::size_t size) {
+            r.m_slab          = slab;
+            r.m_slab_size     = slabs.m_allocator.slab_size(slab);
+            r.m_regions[0]    = slabs.m_regions[slab];
+            r.m_regions[1]    = slabs.m_regions[slab];
+            r.m_commit_region = slabs.m_regions[slab];
+            r.m_offsets[0]    = base;
+            r.m_offsets[1]    = base + size;
+            r.m_commit_offset = base + 2*size;
+        }
+
+        /**
+         * @brief Allocates the extent of a replica of a packed model in
+         * one of the slabs of a location. A new slab (a single Bake region
+         * of m_slab_size bytes) is created if none has enough room, so
+         * that most registrations do not involve Bake at all.
+         *
+         * Throws an exception if a new slab could not be created.
+         */
+        inline void _allocate_packed(location& loc, std::size_t size, replica& r, hosted_model* model) {
+            auto& slabs = loc.m_slabs;
+            auto extent_size = _packed_extent(size);
+            std::lock_guard<tl::mutex> lock(slabs.m_mutex);
+            std::size_t slab, base;
+            if(!slabs.m_allocator.allocate(extent_size, slab, base)) {
+                auto slab_size = std::max(m_slab_size, extent_size);
+                auto region = m_bake_client.create(loc.m_phandle, loc.m_target, slab_size);
+                slab = slabs.m_allocator.add_slab(slab_size);
+                slabs.m_regions.push_back(region);
+                slabs.m_index[Catalog::encode_raw(region)] = slab;
+                m_logger->debug("Created slab {} of {} bytes on {}", slab, slab_size, loc.m_key);
+                slabs.m_allocator.allocate(extent_size, slab, base);
+            }
+            _assign_packed(r, slabs, slab, base, size);
+            slabs.m_extents[{ slab, base }] = model;
+            loc.m_allocated += extent_size;
+        }
+
+        /**
+         * @brief Marks the extent of a replica of a packed model loaded
+         * from the catalog as used in its slab, adding the slab to the
+         * location if it is not known yet.
+         *
+         * @return false if the extent overlaps another one.
+         */
+        inline bool _reserve_packed(location& loc, std::size_t size, replica& r, hosted_model* model) {
+            auto& slabs = loc.m_slabs;
+            auto extent_size = _packed_extent(size);
+            std::lock_guard<tl::mutex> lock(slabs.m_mutex);
+            auto key = Catalog::encode_raw(r.m_regions[0]);
+            auto it = slabs.m_index.find(key);
+            if(it == slabs.m_index.end()) {
+                auto slab = slabs.m_allocator.add_slab(r.m_slab_size);
+                slabs.m_regions.push_back(r.m_regions[0]);
+                it = slabs.m_index.emplace(key, slab).first;
+            }
+            if(!slabs.m_allocator.reserve(it->second, r.m_offsets[0], extent_size))
+                return false;
+            r.m_slab = it->second;
+            slabs.m_extents[{ r.m_slab, r.m_offsets[0] }] = model;
+            loc.m_allocated += extent_size;
+            return true;
+        }
+
+        /**
+         * @brief Releases the extent of a replica of a packed model, and
+         * starts compacting the slabs of the location if this leaves a
+         * slab sparse enough.
+         */
+        inline void _release_packed(const std::shared_ptr<location>& loc, std::size_t size, const replica& r) {
+            auto& slabs = loc->m_slabs;
+            auto extent_size = _packed_extent(size);
+            bool sparse;
+            {
+                std::lock_guard<tl::mutex> lock(slabs.m_mutex);
+                slabs.m_allocator.release(r.m_slab, r.m_offsets[0], extent_size);
+                slabs.m_extents.erase({ r.m_slab, r.m_offsets[0] });
+                sparse = slabs.m_allocator.is_active(r.m_slab)
+                      && slabs.m_allocator.used(r.m_slab)
+                            < m_slab_compaction * slabs.m_allocator.slab_size(r.m_slab);
+            }
+            loc->m_allocated -= extent_size;
+            if(sparse && !m_shutting_down && !loc->m_draining && !slabs.m_compacting.exchange(true)) {
+                m_io_pool.make_thread([this, loc]() {
+                    _compact_slabs(loc);
+                    loc->m_slabs.m_compacting = false;
+                }, tl::anonymous());
+            }
+        }
+
+        /**
+         * @brief Copies size bytes between two extents with the
+         * flamestore_copy_chunk RPC of the storage server holding the source.
+         *
+         * Throws std::runtime_error if the copy failed.
+         */
+        inline void _copy_extent(location& src, const extent& from,
+                                 location& dst, const extent& to, std::size_t size) {
+            copy_request c;
+            c.m_src_target = src.m_target;
+            c.m_src_region = from.m_region;
+            c.m_offset     = from.m_offset;
+            c.m_size       = size;
+            copy_destination d;
+            d.m_addr        = tl::endpoint(*m_engine, dst.m_phandle.address());
+            d.m_provider_id = dst.m_phandle.provider_id();
+            d.m_target      = dst.m_target;
+            d.m_region      = to.m_region;
+            d.m_offset      = to.m_offset;
+            c.m_destinations.push_back(std::move(d));
+            inflight_guard src_inflight(src, size);
+            inflight_guard dst_inflight(dst, size);
+            std::vector<int32_t> result = m_rpc_copy_chunk.on(src.m_endpoint)(c);
+            if(result.size() != 1 || result[0] != 0)
+                throw std::runtime_error("Could not copy extent");
+        }
+
+        /**
+         * @brief Compacts the sparse slabs of a location (see
+         * SlabAllocator::sparse_slabs): their extents, found through
+         * slab_set::m_extents, are moved to other slabs of the same
+         * location one at a time, and the slabs are removed from Bake
+         * once empty. Only the models owning these extents are locked.
+         */
+        inline void _compact_slabs(const std::shared_ptr<location>& loc) {
+            auto& slabs = loc->m_slabs;
+            std::vector<std::size_t> sparse;
+            {
+                std::lock_guard<tl::mutex> lock(slabs.m_mutex);
+                sparse = slabs.m_allocator.sparse_slabs(m_slab_compaction);
+                for(auto slab : sparse)
+                    slabs.m_allocator.retire(slab);
+            }
+            if(sparse.empty()) return;
+            m_logger->info("Compacting {} slab(s) on {}", sparse.size(), loc->m_key);
+            std::vector<std::pair<std::pair<std::size_t, std::size_t>, model_t*>> extents;
+            {
+                std::lock_guard<tl::mutex> lock(slabs.m_mutex);
+                for(auto slab : sparse) {
+                    auto it = slabs.m_extents.lower_bound({ slab, 0 });
+                    for(; it != slabs.m_extents.end() && it->first.first == slab; it++)
+                        extents.push_back(*it);
+                }
+            }
+            std::size_t moved = 0;
+            for(const auto& e : extents) {
+                if(m_shutting_down) break;
+                auto model = e.second;
+                lock_guard_t guard(model->m_mutex);
+                _finish_copy(model);
+                _wait_for_copies_out(model);
+                auto& s = model->m_impl.m_stripes[0];
+                for(auto& r : s.m_replicas) {
+                    if(r.m_location.lock() != loc) continue;
+                    if(r.m_slab != e.first.first || r.m_offsets[0] != e.first.second) continue;
+                    replica moved_to;
+                    try {
+                        _allocate_packed(*loc, s.m_size, moved_to, model);
+                        try {
+                            _copy_extent(*loc, extent{ r.m_regions[0], r.m_offsets[0] },
+                                         *loc, extent{ moved_to.m_regions[0], moved_to.m_offsets[0] },
+                                         _packed_extent(s.m_size));
+                        } catch(...) {
+                            _release_packed(loc, s.m_size, moved_to);
+                            throw;
+                        }
+                    } catch(const std::exception& ex) {
+                        m_logger->warn("Could not move extent of model \"{}\" out of slab {}: {}",
+                                model->m_name, r.m_slab, ex.what());
+                        break;
+                    }
+                    _release_packed(loc, s.m_size, r);
+                    auto target_id = r.m_target_id;
+                    auto version   = r.m_version;
+                    r = moved_to;
+                    r.m_location  = loc;
+                    r.m_target_id = target_id;
+                    r.m_version   = version;
+                    moved += 1;
+                    _record(model);
+                    break;
+                }
+            }
+            std::lock_guard<tl::mutex> lock(slabs.m_mutex);
+            for(auto slab : sparse) {
+                if(slabs.m_allocator.used(slab) != 0) {
+                    slabs.m_allocator.activate(slab);
+                    continue;
+                }
+                try {
+                    m_bake_client.remove(loc->m_phandle, loc->m_target, slabs.m_regions[slab]);
+                } catch(const std::exception& ex) {
+                    m_logger->warn("Could not remove slab {} from {}: {}", slab, loc->m_key, ex.what());
+                }
+                slabs.m_index.erase(Catalog::encode_raw(slabs.m_regions[slab]));
+                slabs.m_allocator.remove(slab);
+            }
+            m_logger->info("Compaction of {} done ({} extent(s) moved)", loc->m_key, moved);
+        }
+
+        /**
+         * @brief Creates the two shadow regions of each replica of a model,
+         * and the commit regions (see model_impl::has_commit).
+         * If the region of one of the slots is already provided (e.g.
+         * because it was migrated from another model), only the other
+         * slot's region is created.
+         *
+         * @param model Model.
+         * @param skip_slot Slot to leave untouched (-1 for none).
+         * @param error Error message in case of failure.
+         *
+         * @return true if all the regions were created.
+         */
+        inline bool _create_regions(model_t* model, int skip_slot, std::string& error) {
+            auto& stripes = model->m_impl.m_stripes;
+            auto replicas = _list_replicas(model);
+            return _parallel_for(replicas.size(), [&](std::size_t k) {
+                auto& s = stripes[replicas[k].first];
+                auto& r = s.m_replicas[replicas[k].second];
+                auto loc = r.m_location.lock();
+                if(!loc) throw std::runtime_error("Storage target not available");
+                if(model->m_impl.m_packed) {
+                    _allocate_packed(*loc, s.m_size, r, model);
+                    // the commit area may hold records left over by a
+                    // previous extent at the same place in the slab
+                    std::vector<char> zeros(commit_record::region_size(), 0);
+                    m_bake_client.write(loc->m_phandle, loc->m_target, r.m_commit_region,
+                                        r.m_commit_offset, zeros.data(), zeros.size());
+                    _persist(*loc, r.m_commit_region, r.m_commit_offset, zeros.size());
+                    return;
+                }
+                for(int slot = 0; slot < 2; slot++) {
+                    if(slot == skip_slot) continue;
+                    r.m_regions[slot] = m_bake_client.create(
+                        loc->m_phandle, loc->m_target, s.m_size);
+                }
+                loc->m_allocated += 2*s.m_size;
+                if(model->m_impl.has_commit(replicas[k].first)) {
+                    r.m_commit_region = m_bake_client.create(
+                        loc->m_phandle, loc->m_target, commit_record::region_size());
+                    loc->m_allocated += commit_record::region_size();
+                }
+            }, error);
+        }
+
+        /**
+         * @brief Writes and persists the commit record for the given
+         * version on every available replica holding a commit region, making
+         * the corresponding shadow regions the ones returned by subsequent
+         * reads. The record for the previous version is left untouched so
+         * that a crash in the middle of this function still leaves a valid
+         * record to restart from.
+         *
+         * @param model Model.
+         * @param version Version to commit.
+         * @param error Error message in case of failure.
+         *
+         * @return true if the record was persisted on at least one replica.
+         */
+        inline bool _commit(model_t* model, uint64_t version, std::string& error) {
+            std::vector<const replica*> replicas;
+            auto& stripes = model->m_impl.m_stripes;
+            for(std::size_t i = 0; i < stripes.size() && model->m_impl.has_commit(i); i++)
+                for(const auto& r : stripes[i].m_replicas)
+                    replicas.push_back(&r);
+            commit_record record(version, model->m_impl.m_size);
+            std::size_t offset = commit_record::offset_of(record.m_slot);
+            std::vector<char> committed(replicas.size(), 0);
+            _parallel_for(replicas.size(), [&](std::size_t r) {
+                auto loc = replicas[r]->m_location.lock();
+                if(!loc) return;
+                auto commit_offset = replicas[r]->m_commit_offset + offset;
+                m_bake_client.write(loc->m_phandle, loc->m_target,
+                                    replicas[r]->m_commit_region,
+                                    commit_offset, &record, sizeof(record));
+                _persist(*loc, replicas[r]->m_commit_region, commit_offset, sizeof(record));
+                committed[r] = 1;
+            }, error);
+            if(std::find(committed.begin(), committed.end(), 1) == committed.end()) {
+                if(error.empty()) error = "No replica available";
+                return false;
+            }
+            model->m_impl.m_version = version;
+            return true;
+        }
+
+        /**
+         * @brief State shared between the attempts of a hedged read.
+         */
+        struct hedge_state {
+            tl::mutex              m_mutex;
+            tl::condition_variable m_cv;
+            std::size_t            m_done = 0;
+            bool                   m_success = false;
+            std::vector<char>      m_data;
+            tl::bulk               m_bulk;
+        };
+
+        /**
+         * @brief Reads a stripe from one of its up-to-date replicas
+         * into the client's memory. Replicas are tried by increasing
+         * number of bytes in flight.
+         *
+         * If hedging is enabled and the stripe has more than one
+         * replica, the stripe is staged in the master's memory and
+         * a second replica is queried if the first one did not answer
+         * within m_hedge_delay_ms; the first response wins. Staging
+         * is required because a straggling Bake read cannot be
+         * cancelled and must not land in the client's memory after
+         * the client has been answered.
+         *
+         * The stripe goes at offset base + its offset in the model in
+         * the client's bulk handle (base being the offset of the model
+         * in a batch).
+         *
+         * Throws std::runtime_error if no replica could be read.
+         */
+        inline void _read_stripe(const model_t* model, std::size_t index,
+                const std::string& client_addr, const tl::endpoint& client_ep,
+                const tl::bulk& remote_bulk, std::size_t base = 0) {
+            const auto& s = model->m_impl.m_stripes[index];
+            if(s.m_size == 0) return;
+            auto slot = model->m_impl.committed_slot();
+            auto copied = _wait_for_stripe_copy(model, index);
+            std::vector<std::pair<std::shared_ptr<location>, extent>> candidates;
+            for(std::size_t j = 0; j < s.m_replicas.size(); j++) {
+                const auto& r = s.m_replicas[j];
+                if(r.m_version != model->m_impl.m_version) continue;
+                if(!copied.empty() && !copied[j]) continue;
+                auto loc = r.m_location.lock();
+                if(loc) candidates.emplace_back(std::move(loc), extent{ r.m_regions[slot], r.m_offsets[slot] });
+            }
+            if(candidates.empty())
+                throw std::runtime_error("No replica available");
+            // rotate so that equally loaded replicas take turns
+            std::rotate(candidates.begin(),
+                        candidates.begin() + (m_read_counter++ % candidates.size()),
+                        candidates.end());
+            std::stable_sort(candidates.begin(), candidates.end(),
+                [](const decltype(candidates)::value_type& a,
+                   const decltype(candidates)::value_type& b) {
+                    return a.first->m_inflight < b.first->m_inflight;
+                });
+
+            if(m_hedge_delay_ms == 0 || candidates.size() == 1) {
+                std::string error;
+                for(auto& c : candidates) {
+                    auto& loc = *c.first;
+                    try {
+                        inflight_guard inflight(loc, s.m_size);
+                        m_bake_client.read(loc.m_phandle, loc.m_target, c.second.m_region,
+                                c.second.m_offset, remote_bulk.get_bulk(), base + s.m_offset,
+                                client_addr, s.m_size);
+                        return;
+                    } catch(const bake::exception& ex) {
+                        m_logger->warn("Failed to read replica on {}: {}", loc.m_key, ex.what());
+                        error = ex.what();
+                    }
+                }
+                throw std::runtime_error(error);
+            }
+
+            auto state = std::make_shared<hedge_state>();
+            std::size_t size = s.m_size;
+            auto launch = [this, &state, &candidates, size](std::size_t i) {
+                auto loc    = candidates[i].first;
+                auto region = candidates[i].second;
+                auto st     = state;
+                tl::xstream::self().make_thread([this, st, loc, region, size]() {
+                    std::vector<char> data(size);
+                    tl::bulk bulk;
+                    bool ok = false;
+                    try {
+                        std::vector<std::pair<void*, std::size_t>> segment(1, {data.data(), size});
+                        bulk = m_engine->expose(segment, tl::bulk_mode::read_write);
+                        inflight_guard inflight(*loc, size);
+                        m_bake_client.read(loc->m_phandle, loc->m_target, region.m_region,
+                                region.m_offset, bulk.get_bulk(), 0, m_self_addr, size);
+                        ok = true;
+                    } catch(const std::exception& ex) {
+                        m_logger->warn("Failed to read replica on {}: {}", loc->m_key, ex.what());
+                    }
+                    std::unique_lock<tl::mutex> lock(st->m_mutex);
+                    st->m_done += 1;
+                    if(ok && !st->m_success) {
+                        st->m_success = true;
+                        st->m_data = std::move(data);
+                        st->m_bulk = std::move(bulk);
+                    }
+                    st->m_cv.notify_all();
+                }, tl::anonymous());
+            };
+
+            std::unique_lock<tl::mutex> lock(state->m_mutex);
+            std::size_t launched = 0;
+            launch(launched++);
+            while(!state->m_success) {
+                if(state->m_done == launched) {
+                    // all the attempts so far have failed
+                    if(launched == candidates.size()) break;
+                    launch(launched++);
+                } else if(launched < candidates.size()) {
+                    auto deadline = _deadline_after((uint64_t)m_hedge_delay_ms * 1000000);
+                    if(!state->m_cv.wait_until(lock, &deadline) && !state->m_success) {
+                        m_logger->debug("Hedging read of stripe {} of model \"{}\"",
+                                index, model->m_name);
+                        launch(launched++);
+                    }
+                } else {
+                    state->m_cv.wait(lock);
+                }
+            }
+            if(!state->m_success)
+                throw std::runtime_error("Failed to read any replica");
+            state->m_bulk >> remote_bulk.on(client_ep).select(base + s.m_offset, size);
+        }
+
+        /**
+         * @brief Computes the layout of an erasure-coded model: k data
+         * fragments followed by m parity fragments, each stored as a
+         * single-replica stripe. Fragment i covers bytes
+         * [i*len, (i+1)*len) of a staging buffer whose first
+         * model_size bytes are the model's data.
+         */
+        inline void _compute_ec_layout(std::size_t size, model_impl& impl) const {
+            impl.m_ec_data   = m_erasure_code->data_fragments();
+            impl.m_ec_parity = m_erasure_code->parity_fragments();
+            impl.m_commit_stripes = impl.m_ec_parity + 1;
+            auto len = m_erasure_code->fragment_size(size);
+            impl.m_stripes.resize(impl.m_ec_data + impl.m_ec_parity);
+            for(std::size_t i = 0; i < impl.m_stripes.size(); i++) {
+                impl.m_stripes[i].m_offset = i*len;
+                impl.m_stripes[i].m_size   = len;
+            }
+        }
+
+        /**
+         * @brief Returns the erasure code for a model (models keep the
+         * parameters they were registered with).
+         */
+        inline std::unique_ptr<ErasureCode> _erasure_code_for(const model_t* model) const {
+            return std::make_unique<ErasureCode>(
+                    model->m_impl.m_ec_data, model->m_impl.m_ec_parity);
+        }
+
+        /**
+         * @brief Exposes a zeroed staging buffer for the
+         * fragments of an erasure-coded model.
+         */
+        inline tl::bulk _expose_staging(std::vector<char>& buffer, std::size_t size) {
+            buffer.assign(size, 0);
+            std::vector<std::pair<void*, std::size_t>> segment(1, {buffer.data(), size});
+            return m_engine->expose(segment, tl::bulk_mode::read_write);
+        }
+
+        /**
+         * @brief Writes a new version of an erasure-coded model: pulls the
+         * data from its source into a staging buffer, computes the parity
+         * fragments, and writes all the fragments to Bake in parallel.
+         *
+         * @param written Set to 1 for each fragment written and persisted.
+         * @param base Offset of the data in the source's bulk handle.
+         */
+        inline void _write_fragments(model_t* model, uint32_t slot,
+                const tl::endpoint& source_ep, const tl::bulk& source_bulk,
+                std::size_t size, std::vector<char>& written, std::string& error,
+                std::size_t base = 0) {
+            auto ec = _erasure_code_for(model);
+            auto& stripes = model->m_impl.m_stripes;
+            auto k = model->m_impl.m_ec_data;
+            auto len = stripes[0].m_size;
+            std::vector<char> buffer;
+            try {
+                auto local_bulk = _expose_staging(buffer, stripes.size()*len);
+                if(size != 0)
+                    local_bulk(0, size) << source_bulk.on(source_ep).select(base, size);
+                std::vector<uint8_t*> fragments(stripes.size());
+                for(std::size_t i = 0; i < stripes.size(); i++)
+                    fragments[i] = reinterpret_cast<uint8_t*>(buffer.data()) + i*len;
+                ec->encode(fragments.data(), fragments.data() + k, len);
+                _parallel_for(stripes.size(), [&](std::size_t i) {
+                    auto& r = stripes[i].m_replicas[0];
+                    auto loc = r.m_location.lock();
+                    if(!loc) return; // storage server is gone, fragment stays stale
+                    inflight_guard inflight(*loc, len);
+                    m_bake_client.write(loc->m_phandle, loc->m_target, r.m_regions[slot],
+                            r.m_offsets[slot], local_bulk.get_bulk(), i*len, m_self_addr, len);
+                    _persist(*loc, r.m_regions[slot], r.m_offsets[slot], len);
+                    written[i] = 1;
+                }, error);
+            } catch(const tl::exception& ex) {
+                error = ex.what();
+            }
+        }
+
+        /**
+         * @brief Reads an erasure-coded model into the client's memory.
+         * If all the data fragments are available, they are read directly
+         * into the client's memory. Otherwise (or if one of these reads
+         * fails) this is a degraded read: k available fragments are read
+         * into a staging buffer, the missing data fragments are rebuilt,
+         * and the data is pushed to the client. The data goes at offset
+         * base in the client's bulk handle.
+         *
+         * Throws std::runtime_error if fewer than k fragments can be read.
+         */
+        inline void _read_fragments(const model_t* model,
+                const std::string& client_addr, const tl::endpoint& client_ep,
+                const tl::bulk& remote_bulk, std::size_t size, std::size_t base = 0) {
+            const auto& stripes = model->m_impl.m_stripes;
+            auto k = model->m_impl.m_ec_data;
+            auto n = stripes.size();
+            auto len = stripes[0].m_size;
+            auto slot = model->m_impl.committed_slot();
+            std::vector<std::shared_ptr<location>> locs(n);
+            std::vector<bool> available(n, false);
+            for(std::size_t i = 0; i < n; i++) {
+                const auto& r = stripes[i].m_replicas[0];
+                if(r.m_version != model->m_impl.m_version) continue;
+                auto copied = _wait_for_stripe_copy(model, i);
+                if(!copied.empty() && !copied[0]) continue;
+                locs[i] = r.m_location.lock();
+                available[i] = (bool)locs[i];
+            }
+            auto read_fragment = [&](std::size_t i, hg_bulk_t bulk, std::size_t offset,
+                                     const std::string& addr, std::size_t fragment_size) {
+                auto& loc = *locs[i];
+                inflight_guard inflight(loc, fragment_size);
+                const auto& r = stripes[i].m_replicas[0];
+                m_bake_client.read(loc.m_phandle, loc.m_target,
+                        r.m_regions[slot], r.m_offsets[slot],
+                        bulk, offset, addr, fragment_size);
+            };
+            std::string error;
+            // healthy path: data fragments go straight to the client
+            if(std::find(available.begin(), available.begin() + k, false) == available.begin() + k) {
+                std::vector<char> failed(k, 0);
+                bool ok = _parallel_for(k, [&](std::size_t i) {
+                    if(i*len >= size) return;
+                    try {
+                        read_fragment(i, remote_bulk.get_bulk(), base + i*len, client_addr,
+                                      std::min(len, size - i*len));
+                    } catch(...) {
+                        failed[i] = 1;
+                        throw;
+                    }
+                }, error);
+                if(ok) return;
+                m_logger->warn("Failed to read data fragment of model \"{}\": {}", model->m_name, error);
+                for(std::size_t i = 0; i < k; i++)
+                    if(failed[i]) available[i] = false;
+            }
+            // degraded path
+            m_logger->info("Degraded read of model \"{}\"", model->m_name);
+            auto ec = _erasure_code_for(model);
+            std::vector<char> buffer;
+            auto local_bulk = _expose_staging(buffer, n*len);
+            std::vector<bool> valid(n, false);
+            while(true) {
+                std::vector<std::size_t> to_read;
+                std::size_t count = std::count(valid.begin(), valid.end(), true);
+                for(std::size_t i = 0; i < n && count + to_read.size() < k; i++)
+                    if(available[i] && !valid[i]) to_read.push_back(i);
+                if(count + to_read.size() < k)
+                    throw std::runtime_error("Not enough fragments available to rebuild model");
+                std::vector<char> done(to_read.size(), 0);
+                _parallel_for(to_read.size(), [&](std::size_t j) {
+                    read_fragment(to_read[j], local_bulk.get_bulk(), to_read[j]*len, m_self_addr, len);
+                    done[j] = 1;
+                }, error);
+                for(std::size_t j = 0; j < to_read.size(); j++) {
+                    if(done[j]) valid[to_read[j]] = true;
+                    else available[to_read[j]] = false;
+                }
+                if((std::size_t)std::count(valid.begin(), valid.end(), true) >= k)
+                    break;
+            }
+            std::vector<uint8_t*> fragments(n);
+            for(std::size_t i = 0; i < n; i++)
+                fragments[i] = reinterpret_cast<uint8_t*>(buffer.data()) + i*len;
+            if(!ec->decode(fragments.data(), valid, len))
+                throw std::runtime_error("Failed to rebuild model from its fragments");
+            if(size != 0)
+                local_bulk(0, size) >> remote_bulk.on(client_ep).select(base, size);
+        }
+
+        /**
+         * @brief A replica that the rebalancer or the drain
+         * protocol may move to another location.
+         */
+        struct move_candidate {
+            model_t*    m_model;
+            std::size_t m_stripe;
+            std::size_t m_replica;
+            std::size_t m_size; // bytes allocated for the replica
+        };
+
+        /**
+         * @brief Returns the locations that are not being drained,
+         * sorted by increasing load (see _load).
+         */
+        inline std::vector<std::shared_ptr<location>> _sorted_locations(double& default_capacity) {
+            auto locations = *_locations();
+            locations.erase(
+                std::remove_if(locations.begin(), locations.end(),
+                    [](const std::shared_ptr<location>& l) { return l->m_draining.load(); }),
+                locations.end());
+            double known = 0.0;
+            std::size_t count = 0;
+            for(const auto& l : locations) {
+                if(l->m_capacity == 0) continue;
+                known += l->m_capacity;
+                count += 1;
+            }
+            default_capacity = count ? known / count : 1.0;
+            std::stable_sort(locations.begin(), locations.end(),
+                [default_capacity](const std::shared_ptr<location>& a, const std::shared_ptr<location>& b) {
+                    return _load(*a, default_capacity) < _load(*b, default_capacity);
+                });
+            return locations;
+        }
+
+        /**
+         * @brief Fraction of a location's capacity that is allocated.
+         * Locations of unknown capacity are assumed to have the
+         * provided default capacity.
+         */
+        static inline double _load(const location& l, double default_capacity) {
+            double capacity = l.m_capacity ? (double)l.m_capacity : default_capacity;
+            return (double)l.m_allocated / capacity;
+        }
+
+        /**
+         * @brief Lists the replicas stored on a location, using its index
+         * of hosted models. If wait is false, models that are currently
+         * locked (e.g. being written) are skipped.
+         */
+        inline std::vector<move_candidate> _replicas_on(const std::shared_ptr<location>& loc, bool wait) {
+            std::vector<move_candidate> result;
+            for(auto model : loc->hosted()) {
+                std::unique_lock<tl::mutex> lock(model->m_mutex, std::defer_lock);
+                if(wait) lock.lock();
+                else if(!lock.try_lock()) continue;
+                const auto& stripes = model->m_impl.m_stripes;
+                for(std::size_t i = 0; i < stripes.size(); i++) {
+                    for(std::size_t j = 0; j < stripes[i].m_replicas.size(); j++) {
+                        if(stripes[i].m_replicas[j].m_location.lock() != loc) continue;
+                        std::size_t size = 2*stripes[i].m_size;
+                        if(model->m_impl.has_commit(i)) size += commit_record::region_size();
+                        result.push_back({model, i, j, size});
+                    }
+                }
+            }
+            return result;
+        }
+
+        /**
+         * @brief Checks whether a replica can be moved to a location without
+         * putting two replicas of the same stripe on the same storage server.
+         * If strict is true, the fragments of an erasure-coded model must also
+         * remain on distinct storage servers.
+         */
+        static inline bool _can_host(const model_t* model, std::size_t i, std::size_t j,
+                                     const location& dst, bool strict) {
+            const auto& stripes = model->m_impl.m_stripes;
+            bool whole_model = strict && model->m_impl.m_ec_data;
+            for(std::size_t si = 0; si < stripes.size(); si++) {
+                if(si != i && !whole_model) continue;
+                for(std::size_t sj = 0; sj < stripes[si].m_replicas.size(); sj++) {
+                    if(si == i && sj == j) continue;
+                    auto loc = stripes[si].m_replicas[sj].m_location.lock();
+                    if(loc && loc->m_ssg_member_id == dst.m_ssg_member_id) return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Replica from which the regions of a moved replica are
+         * copied (see _move_sources).
+         */
+        struct move_source {
+            std::shared_ptr<location> m_location;
+            std::vector<bake::region> m_regions; // shadow regions, then commit region if any
+            std::size_t               m_offset = 0; // of the extent, packed models only
+        };
+
+        /**
+         * @brief Lists the replicas from which replica j of stripe i can be
+         * copied: the replica itself (on src) if from_src is true, then the
+         * other replicas of the stripe holding the committed version, on
+         * locations that are not being drained. Must be called with the
+         * model locked.
+         */
+        inline std::vector<move_source> _move_sources(const model_t* model,
+                std::size_t i, std::size_t j, bool from_src) {
+            std::vector<move_source> sources;
+            const auto& replicas = model->m_impl.m_stripes[i].m_replicas;
+            for(std::size_t k = 0; k < replicas.size(); k++) {
+                const auto& r = replicas[k];
+                auto loc = r.m_location.lock();
+                if(!loc) continue;
+                if(k == j) {
+                    if(!from_src) continue;
+                } else if(loc->m_draining || r.m_version != model->m_impl.m_version) {
+                    continue;
+                }
+                move_source source;
+                source.m_location = std::move(loc);
+                source.m_regions  = { r.m_regions[0], r.m_regions[1] };
+                if(model->m_impl.has_commit(i))
+                    source.m_regions.push_back(r.m_commit_region);
+                source.m_offset = r.m_offsets[0];
+                if(k == j) sources.insert(sources.begin(), std::move(source));
+                else sources.push_back(std::move(source));
+            }
+            return sources;
+        }
+
+        /**
+         * @brief Copies the regions of a replica to dst with Bake's migrate.
+         * The copies made so far are removed if one of them fails.
+         *
+         * @return the copies, or an empty vector if the copy failed.
+         */
+        inline std::vector<bake::region> _migrate_regions(const model_t* model,
+                const move_source& source, const std::vector<std::size_t>& sizes,
+                const std::shared_ptr<location>& dst, std::size_t bytes) {
+            std::string dst_addr = tl::endpoint(*m_engine, dst->m_phandle.address());
+            std::vector<bake::region> copies;
+            auto& src = *source.m_location;
+            inflight_guard src_inflight(src, bytes);
+            inflight_guard dst_inflight(*dst, bytes);
+            try {
+                for(std::size_t k = 0; k < sizes.size(); k++)
+                    copies.push_back(m_bake_client.migrate(src.m_phandle, src.m_target,
+                            source.m_regions[k], sizes[k], false,
+                            dst_addr, dst->m_phandle.provider_id(), dst->m_target));
+            } catch(const std::exception& ex) {
+                m_logger->warn("Could not copy replica of model \"{}\" from {} to {}: {}",
+                        model->m_name, src.m_key, dst->m_key, ex.what());
+                _remove_regions(*dst, copies);
+                copies.clear();
+            }
+            return copies;
+        }
+
+        /**
+         * @brief Removes regions of a location, ignoring errors.
+         */
+        inline void _remove_regions(location& loc, const std::vector<bake::region>& regions) {
+            for(const auto& region : regions) {
+                try {
+                    m_bake_client.remove(loc.m_phandle, loc.m_target, region);
+                } catch(const std::exception& ex) {
+                    m_logger->warn("Could not remove region from {}: {}", loc.m_key, ex.what());
+                }
+            }
+        }
+
+        /**
+         * @brief Moves a replica from src to dst. The regions are copied
+         * with Bake's migrate without holding the lock of the model, so
+         * that the model can still be read and written meanwhile. The
+         * replica is then switched to the copies, unless the model was
+         * written during the copy, in which case the copy is made again.
+         * The source regions are removed only once the replica points to
+         * the copies, so a failure leaves the replica where it was.
+         *
+         * The regions are copied from the replica itself if from_src is
+         * true and src can be read, otherwise from another up-to-date
+         * replica of the same stripe (see _move_sources).
+         *
+         * @return true if the replica was moved.
+         */
+        inline bool _move_replica(const move_candidate& c,
+                const std::shared_ptr<location>& src,
+                const std::shared_ptr<location>& dst,
+                bool strict, bool from_src = true) {
+            const unsigned max_attempts = 3;
+            auto model = c.m_model;
+            std::unique_lock<tl::mutex> lock(model->m_mutex);
+            for(unsigned attempt = 0; attempt < max_attempts; attempt++) {
+                auto& stripes = model->m_impl.m_stripes;
+                if(c.m_stripe >= stripes.size() || c.m_replica >= stripes[c.m_stripe].m_replicas.size())
+                    return false;
+                _finish_copy(model);
+                _wait_for_copies_out(model);
+                if(stripes[c.m_stripe].m_replicas[c.m_replica].m_location.lock() != src) return false;
+                if(!_can_host(model, c.m_stripe, c.m_replica, *dst, strict)) return false;
+                auto sources = _move_sources(model, c.m_stripe, c.m_replica, from_src);
+                if(sources.empty()) {
+                    m_logger->warn("No replica to copy from to move replica of model \"{}\"",
+                            model->m_name);
+                    return false;
+                }
+                // packed extents are small, they are copied with the model locked
+                if(model->m_impl.m_packed)
+                    return _move_packed_replica(model, sources, src, dst,
+                            stripes[c.m_stripe].m_replicas[c.m_replica]);
+                auto size = stripes[c.m_stripe].m_size;
+                std::vector<std::size_t> sizes = { size, size };
+                if(model->m_impl.has_commit(c.m_stripe))
+                    sizes.push_back(commit_record::region_size());
+                auto version = model->m_impl.m_version;
+                lock.unlock();
+                std::vector<bake::region> copies;
+                bool copied_from_src = false;
+                for(const auto& source : sources) {
+                    copies = _migrate_regions(model, source, sizes, dst, c.m_size);
+                    copied_from_src = source.m_location == src;
+                    if(!copies.empty()) break;
+                }
+                lock.lock();
+                if(copies.empty()) return false;
+                if(c.m_stripe >= stripes.size() || c.m_replica >= stripes[c.m_stripe].m_replicas.size()
+                || stripes[c.m_stripe].m_replicas[c.m_replica].m_location.lock() != src) {
+                    _remove_regions(*dst, copies);
+                    return false;
+                }
+                if(model->m_impl.m_version != version) {
+                    m_logger->debug("Model \"{}\" was written while moving one of its replicas, copying again",
+                            model->m_name);
+                    _remove_regions(*dst, copies);
+                    continue;
+                }
+                // duplicates may have started reading the source meanwhile
+                _wait_for_copies_out(model);
+                auto& r = stripes[c.m_stripe].m_replicas[c.m_replica];
+                std::vector<bake::region> old = { r.m_regions[0], r.m_regions[1] };
+                r.m_regions[0] = copies[0];
+                r.m_regions[1] = copies[1];
+                if(copies.size() > 2) {
+                    old.push_back(r.m_commit_region);
+                    r.m_commit_region = copies[2];
+                }
+                // a replica copied from another one holds the committed version
+                if(!copied_from_src)
+                    r.m_version = version;
+                src->unhost(model);
+                r.bind(dst, model);
+                src->m_allocated -= c.m_size;
+                dst->m_allocated += c.m_size;
+                m_logger->debug("Moved replica of model \"{}\" from {} to {}",
+                        model->m_name, src->m_key, dst->m_key);
+                _record(model);
+                lock.unlock();
+                if(from_src) _remove_regions(*src, old);
+                return true;
+            }
+            m_logger->warn("Could not move replica of model \"{}\" to {}: written during each of {} copies",
+                    model->m_name, dst->m_key, max_attempts);
+            return false;
+        }
+
+        /**
+         * @brief Moves a replica of a packed model, which cannot use Bake's
+         * migrate since it only covers an extent of a slab: the extent is
+         * copied from the first source that can be read into a slab of dst
+         * with the flamestore_copy_chunk RPC. Must be called with the
+         * model locked.
+         *
+         * @return true if the replica was moved.
+         */
+        inline bool _move_packed_replica(model_t* model,
+                const std::vector<move_source>& sources,
+                const std::shared_ptr<location>& src,
+                const std::shared_ptr<location>& dst,
+                replica& r) {
+            auto size = model->m_impl.m_stripes[0].m_size;
+            replica moved_to;
+            try {
+                _allocate_packed(*dst, size, moved_to, model);
+            } catch(const std::exception& ex) {
+                m_logger->warn("Could not move replica of model \"{}\" to {}: {}",
+                        model->m_name, dst->m_key, ex.what());
+                return false;
+            }
+            const move_source* copied_from = nullptr;
+            for(const auto& source : sources) {
+                try {
+                    _copy_extent(*source.m_location, extent{ source.m_regions[0], source.m_offset },
+                                 *dst, extent{ moved_to.m_regions[0], moved_to.m_offsets[0] },
+                                 _packed_extent(size));
+                    copied_from = &source;
+                    break;
+                } catch(const std::exception& ex) {
+                    m_logger->warn("Could not copy replica of model \"{}\" from {} to {}: {}",
+                            model->m_name, source.m_location->m_key, dst->m_key, ex.what());
+                }
+            }
+            if(!copied_from) {
+                _release_packed(dst, size, moved_to);
+                return false;
+            }
+            _release_packed(src, size, r);
+            auto version = copied_from->m_location == src ? r.m_version : model->m_impl.m_version;
+            r = moved_to;
+            r.m_version = version;
+            src->unhost(model);
+            r.bind(dst, model);
+            m_logger->debug("Moved replica of model \"{}\" from {} to {}",
+                    model->m_name, src->m_key, dst->m_key);
+            _record(model);
+            return true;
+        }
+
+        /**
+         * @brief Moves all the replicas off locations being drained,
+         * strictly first, then letting fragments of erasure-coded models
+         * share a storage server if there is no other choice. The moves
+         * are not rate-limited. If from_src is false (the locations are
+         * gone), the replicas are copied from other replicas of their
+         * stripe (see _move_replica).
+         *
+         * @return the number of bytes moved; stuck is set to the number
+         * of replicas that could not be moved.
+         */
+        inline std::size_t _drain_locations(const std::vector<std::shared_ptr<location>>& draining,
+                bool from_src, std::size_t& stuck) {
+            std::size_t moved = 0;
+            stuck = 0;
+            for(const auto& src : draining) {
+                for(const auto& c : _replicas_on(src, true)) {
+                    bool done = false;
+                    for(int strict = 1; strict >= 0 && !done; strict--) {
+                        double default_capacity;
+                        for(const auto& dst : _sorted_locations(default_capacity)) {
+                            if(dst->m_capacity && dst->m_allocated + c.m_size > dst->m_capacity) continue;
+                            if((done = _move_replica(c, src, dst, strict, from_src))) break;
+                        }
+                    }
+                    if(done) moved += c.m_size;
+                    else stuck += 1;
+                }
+            }
+            return moved;
+        }
+
+        /**
+         * @brief Handles a storage server leaving the group: the replicas
+         * it still holds (if it left without a drain_worker request) are
+         * moved to the remaining locations, from the server itself if it
+         * can still be read (reachable is true), otherwise from other
+         * replicas, before its locations are forgotten. The moves run in
+         * a ULT of the I/O pool.
+         */
+        inline void _evacuate(uint64_t member_id, bool reachable) {
+            std::vector<std::shared_ptr<location>> leaving;
+            for(const auto& l : *_locations()) {
+                if(l->m_ssg_member_id != member_id) continue;
+                l->m_draining = true;
+                leaving.push_back(l);
+            }
+            if(leaving.empty()) return;
+            if(m_shutting_down) {
+                _forget_locations(member_id);
+                return;
+            }
+            m_io_pool.make_thread([this, member_id, reachable, leaving]() {
+                std::size_t stuck;
+                auto moved = _drain_locations(leaving, reachable, stuck);
+                if(stuck)
+                    m_logger->error("{} replica(s) could not be moved off storage server {} that left",
+                            stuck, member_id);
+                else if(moved)
+                    m_logger->info("Moved {} bytes off storage server {} that left", moved, member_id);
+                _forget_locations(member_id);
+            }, tl::anonymous());
+        }
+
+        /**
+         * @brief Removes the locations of a storage server from the table.
+         */
+        inline void _forget_locations(uint64_t member_id) {
+            _update_locations([member_id](location_table& table) {
+                table.erase(
+                    std::remove_if( std::begin(table),
+                                    std::end(table),
+                                    [member_id](const std::shared_ptr<location>& l) {
+                                        return l->m_ssg_member_id == member_id;
+                                    }),
+                    std::end(table)
+                );
+            });
+        }
+
+        /**
+         * @brief Performs one rebalancing step: moves one replica from the
+         * most loaded location to the least loaded location that can take
+         * it, provided the difference of load between them exceeds
+         * m_rebalance_threshold times the average load. Only replicas
+         * small enough for the move not to invert the imbalance are
+         * considered, the largest first.
+         *
+         * @return the number of bytes moved (0 if nothing was moved).
+         */
+        inline std::size_t _rebalance_step() {
+            double default_capacity;
+            auto locations = _sorted_locations(default_capacity);
+            if(locations.size() < 2) return 0;
+            double mean = 0.0;
+            for(const auto& l : locations)
+                mean += _load(*l, default_capacity);
+            mean /= locations.size();
+            auto src = locations.back();
+            double src_load = _load(*src, default_capacity);
+            double src_capacity = src->m_capacity ? (double)src->m_capacity : default_capacity;
+            auto candidates = _replicas_on(src, false);
+            std::sort(candidates.begin(), candidates.end(),
+                [](const move_candidate& a, const move_candidate& b) { return a.m_size > b.m_size; });
+            for(std::size_t d = 0; d + 1 < locations.size(); d++) {
+                auto& dst = locations[d];
+                double spread = src_load - _load(*dst, default_capacity);
+                if(spread <= m_rebalance_threshold * mean) break;
+                // rebalancing yields to the foreground traffic
+                if(_busy(*dst)) continue;
+                double dst_capacity = dst->m_capacity ? (double)dst->m_capacity : default_capacity;
+                double max_size = spread / (1.0/src_capacity + 1.0/dst_capacity);
+                for(const auto& c : candidates) {
+                    if((double)c.m_size > max_size) continue;
+                    if(dst->m_capacity && dst->m_allocated + c.m_size > dst->m_capacity) continue;
+                    if(_move_replica(c, src, dst, true)) return c.m_size;
+                }
+            }
+            return 0;
+        }
+
+        /**
+         * @brief Wakes up the rebalancer.
+         */
+        inline void _request_rebalance() {
+            if(!m_rebalance) return;
+            std::unique_lock<tl::mutex> lock(m_rebalance_mutex);
+            m_rebalance_requested = true;
+            m_rebalance_cv.notify_one();
+        }
+
+        /**
+         * @brief Body of the rebalancer ULT. Each time it is woken up
+         * (when a storage server joins or the capacity of a target
+         * changes), it moves replicas one at a time
+         * until the load is even, pausing after each move so as not to
+         * exceed m_rebalance_rate bytes per second.
+         */
+        inline void _rebalancer_loop() {
+            std::unique_lock<tl::mutex> lock(m_rebalance_mutex);
+            while(!m_shutting_down) {
+                if(!m_rebalance_requested) {
+                    m_rebalance_cv.wait(lock);
+                    continue;
+                }
+                m_rebalance_requested = false;
+                m_logger->info("Rebalancing models across storage targets");
+                std::size_t total = 0;
+                while(!m_shutting_down) {
+                    lock.unlock();
+                    std::size_t moved = _rebalance_step();
+                    lock.lock();
+                    if(moved == 0) break;
+                    total += moved;
+                    if(m_rebalance_rate == 0) continue;
+                    auto deadline = _deadline_after((uint64_t)((double)moved / m_rebalance_rate * 1e9));
+                    while(!m_shutting_down && m_rebalance_cv.wait_until(lock, &deadline));
+                }
+                m_logger->info("Rebalancing done ({} bytes moved)", total);
+            }
+        }
+
+        /**
+         * @brief Records the metadata of a model (configuration, tags, layout,
+         * Bake regions and versions) in the catalog, if any. Must be called
+         * with the model locked, every time this metadata changes.
+         */
+        inline void _record(const model_t* model) {
+            if(!m_catalog) return;
+            const auto& impl = model->m_impl;
+            Json::Value entry;
+            // configs are opaque bytes (compressed by the client)
+            entry["config64"]  = Catalog::encode_bytes(model->m_model_config);
+            entry["signature"] = model->m_model_signature.str();
+            entry["size"]      = (Json::UInt64)impl.m_size;
+            entry["version"]   = (Json::UInt64)impl.m_version;
+            entry["writes"]    = (Json::UInt64)impl.m_writes;
+            entry["ec_data"]   = impl.m_ec_data;
+            entry["ec_parity"] = impl.m_ec_parity;
+            entry["commit_stripes"] = (Json::UInt64)impl.m_commit_stripes;
+            for(const auto& t : model->m_tags)
+                entry["tags"][t.first] = t.second;
+            if(impl.m_packed)
+                entry["packed"] = true;
+            Json::Value stripes(Json::arrayValue);
+            for(std::size_t i = 0; i < impl.m_stripes.size(); i++) {
+                const auto& s = impl.m_stripes[i];
+                Json::Value js;
+                js["offset"] = (Json::UInt64)s.m_offset;
+                js["size"]   = (Json::UInt64)s.m_size;
+                Json::Value replicas(Json::arrayValue);
+                for(const auto& r : s.m_replicas) {
+                    Json::Value jr;
+                    jr["target"]  = r.m_target_id;
+                    jr["version"] = (Json::UInt64)r.m_version;
+                    jr["regions"].append(Catalog::encode_raw(r.m_regions[0]));
+                    jr["regions"].append(Catalog::encode_raw(r.m_regions[1]));
+                    if(impl.has_commit(i))
+                        jr["commit"] = Catalog::encode_raw(r.m_commit_region);
+                    if(impl.m_packed) {
+                        jr["offsets"].append((Json::UInt64)r.m_offsets[0]);
+                        jr["offsets"].append((Json::UInt64)r.m_offsets[1]);
+                        jr["commit_offset"] = (Json::UInt64)r.m_commit_offset;
+                        jr["slab_size"] = (Json::UInt64)r.m_slab_size;
+                    }
+                    replicas.append(jr);
+                }
+                js["replicas"] = replicas;
+                stripes.append(js);
+            }
+            entry["stripes"] = stripes;
+            Json::StreamWriterBuilder builder;
+            builder["indentation"] = "";
+            m_catalog->put(model->m_name, Json::writeString(builder, entry));
+        }
+
+        /**
+         * @brief Rebuilds a model from its catalog entry. Its replicas are
+         * not bound to any location until the storage servers holding
+         * their targets join (see _bind_replicas).
+         *
+         * @return nullptr if the entry is invalid.
+         */
+        inline std::unique_ptr<model_t> _parse_entry(const std::string& name, const std::string& value) const {
+            Json::CharReaderBuilder builder;
+            std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+            Json::Value entry;
+            std::string errors;
+            if(!reader->parse(value.data(), value.data() + value.size(), &entry, &errors)) {
+                m_logger->warn("Invalid catalog entry for model \"{}\": {}", name, errors);
+                return nullptr;
+            }
+            auto model = std::make_unique<model_t>();
+            model->m_name            = name;
+            std::string config;
+            if(entry.isMember("config64")) {
+                if(!Catalog::decode_bytes(entry["config64"].asString(), config)) {
+                    m_logger->warn("Invalid config in catalog entry for model \"{}\"", name);
+                    return nullptr;
+                }
+            } else {
+                config = entry["config"].asString();
+            }
+            model->m_model_config    = m_strings->intern(config);
+            model->m_model_signature = m_strings->intern(entry["signature"].asString());
+            const auto& tags = entry["tags"];
+            for(const auto& key : tags.getMemberNames())
+                model->m_tags[key] = tags[key].asString();
+            auto& impl = model->m_impl;
+            impl.m_size      = entry["size"].asUInt64();
+            impl.m_version   = entry["version"].asUInt64();
+            impl.m_writes    = std::max(entry.get("writes", 0).asUInt64(), impl.m_version);
+            impl.m_ec_data   = entry["ec_data"].asUInt();
+            impl.m_ec_parity = entry["ec_parity"].asUInt();
+            impl.m_packed    = entry["packed"].asBool();
+            // entries written before the records were replicated on the
+            // parity fragments only have them on the first stripe
+            impl.m_commit_stripes = entry.isMember("commit_stripes")
+                                  ? entry["commit_stripes"].asUInt64() : 1;
+            const auto& stripes = entry["stripes"];
+            impl.m_stripes.resize(stripes.size());
+            for(Json::ArrayIndex i = 0; i < stripes.size(); i++) {
+                auto& s = impl.m_stripes[i];
+                s.m_offset = stripes[i]["offset"].asUInt64();
+                s.m_size   = stripes[i]["size"].asUInt64();
+                const auto& replicas = stripes[i]["replicas"];
+                s.m_replicas.resize(replicas.size());
+                for(Json::ArrayIndex j = 0; j < replicas.size(); j++) {
+                    auto& r = s.m_replicas[j];
+                    const auto& jr = replicas[j];
+                    r.m_target_id = jr["target"].asString();
+                    r.m_version   = jr["version"].asUInt64();
+                    bool ok = jr["regions"].size() == 2
+                        && Catalog::decode_raw(jr["regions"][0].asString(), r.m_regions[0])
+                        && Catalog::decode_raw(jr["regions"][1].asString(), r.m_regions[1]);
+                    if(ok && impl.has_commit(i))
+                        ok = Catalog::decode_raw(jr["commit"].asString(), r.m_commit_region);
+                    if(ok && impl.m_packed) {
+                        ok = jr["offsets"].size() == 2 && jr["slab_size"].asUInt64() != 0;
+                        if(ok) {
+                            r.m_offsets[0]    = jr["offsets"][0].asUInt64();
+                            r.m_offsets[1]    = jr["offsets"][1].asUInt64();
+                            r.m_commit_offset = jr["commit_offset"].asUInt64();
+                            r.m_slab_size     = jr["slab_size"].asUInt64();
+                        }
+                    }
+                    if(!ok) {
+                        m_logger->warn("Invalid region ids in catalog entry for model \"{}\"", name);
+                        return nullptr;
+                    }
+                }
+            }
+            if(impl.m_stripes.empty() || impl.m_commit_stripes == 0
+            || impl.m_commit_stripes > impl.m_stripes.size()) {
+                m_logger->warn("Catalog entry for model \"{}\" has an invalid layout", name);
+                return nullptr;
+            }
+            return model;
+        }
+
+        /**
+         * @brief Rebuilds the in-memory index of models from the catalog.
+         */
+        inline void _load_catalog() {
+            auto start = std::chrono::steady_clock::now();
+            std::size_t invalid = 0;
+            m_models_rwlock.wrlock();
+            try {
+                m_catalog->load([this, &invalid](const std::string& name, const std::string& value) {
+                    auto model = _parse_entry(name, value);
+                    if(model) m_models[name] = std::move(model);
+                    else invalid += 1;
+                });
+            } catch(...) {
+                m_models_rwlock.unlock();
+                throw;
+            }
+            auto count = m_models.size();
+            m_models_rwlock.unlock();
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+            m_logger->info("Loaded {} model(s) from catalog in {} ms ({} invalid entries ignored)",
+                    count, elapsed, invalid);
+        }
+
+        /**
+         * @brief Reads the commit records of a replica holding a copy
+         * of them (see model_impl::has_commit). If the last valid record is more recent than the
+         * model's version (the catalog entry had not been flushed yet when
+         * the master stopped), the replicas that were up to date according
+         * to the catalog are assumed to hold this version, since writes go
+         * to all the available replicas. Must be called with the model locked.
+         */
+        inline void _recover_version(model_t* model, const replica& r, location& loc) {
+            commit_record records[2];
+            try {
+                m_bake_client.read(loc.m_phandle, loc.m_target, r.m_commit_region, r.m_commit_offset,
+                                   records, sizeof(records));
+            } catch(const std::exception& ex) {
+                m_logger->warn("Could not read commit records of model \"{}\": {}", model->m_name, ex.what());
+                return;
+            }
+            auto& impl = model->m_impl;
+            uint64_t latest = impl.m_version;
+            for(const auto& record : records)
+                if(record.is_valid() && record.m_version > latest)
+                    latest = record.m_version;
+            if(latest == impl.m_version) return;
+            m_logger->warn("Catalog entry of model \"{}\" was behind its commit records (version {} instead of {})",
+                    model->m_name, impl.m_version, latest);
+            for(auto& s : impl.m_stripes)
+                for(auto& other : s.m_replicas)
+                    if(other.m_version == impl.m_version) other.m_version = latest;
+            impl.m_version = latest;
+            impl.m_writes  = std::max(impl.m_writes, latest);
+            _record(model);
+        }
+
+        /**
+         * @brief Binds the replicas that are not attached to any location
+         * (models loaded from the catalog, or replicas of a storage server
+         * that left) to the given locations, matching Bake target ids.
+         */
+        inline void _bind_replicas(const std::vector<std::shared_ptr<location>>& locations) {
+            if(!m_catalog) return;
+            std::unordered_map<std::string, std::shared_ptr<location>> by_id;
+            for(const auto& l : locations)
+                by_id[l->m_target_id] = l;
+            std::vector<model_t*> models;
+            m_models_rwlock.rdlock();
+            for(const auto& p : m_models)
+                models.push_back(p.second.get());
+            m_models_rwlock.unlock();
+            std::size_t bound = 0;
+            for(auto model : models) {
+                lock_guard_t guard(model->m_mutex);
+                auto& stripes = model->m_impl.m_stripes;
+                for(std::size_t i = 0; i < stripes.size(); i++) {
+                    for(auto& r : stripes[i].m_replicas) {
+                        if(!r.m_location.expired()) continue;
+                        auto it = by_id.find(r.m_target_id);
+                        if(it == by_id.end()) continue;
+                        auto& loc = it->second;
+                        if(model->m_impl.m_packed && !_reserve_packed(*loc, stripes[i].m_size, r, model)) {
+                            m_logger->warn("Extent of model \"{}\" overlaps another extent of its slab",
+                                    model->m_name);
+                            continue;
+                        }
+                        r.m_location = loc;
+                        loc->host(model);
+                        if(!model->m_impl.m_packed)
+                            loc->m_allocated += 2*stripes[i].m_size;
+                        if(model->m_impl.has_commit(i)) {
+                            if(!model->m_impl.m_packed)
+                                loc->m_allocated += commit_record::region_size();
+                            _recover_version(model, r, *loc);
+                        }
+                        bound += 1;
+                    }
+                }
+            }
+            if(bound)
+                m_logger->info("Attached {} replica(s) from the catalog to new storage targets", bound);
+        }
+
+        /**
+         * @brief If the model is being filled by a duplicate, waits until
+         * the provided stripe is settled (see copy_state::settled).
+         *
+         * @return a flag per replica of the stripe telling whether it
+         * has been copied, or an empty vector if there is no copy.
+         */
+        inline std::vector<char> _wait_for_stripe_copy(const model_t* model, std::size_t index) {
+            auto state = model->m_impl.m_copy;
+            if(!state) return {};
+            std::unique_lock<tl::mutex> lock(state->m_mutex);
+            while(!state->settled(index))
+                state->m_cv.wait(lock);
+            std::vector<char> result(state->m_left[index].size());
+            for(std::size_t j = 0; j < result.size(); j++)
+                result[j] = state->ready(index, j);
+            return result;
+        }
+
+        /**
+         * @brief Waits until the duplicates of a model no longer read
+         * its regions. Must be called with the model locked, before
+         * overwriting or moving its regions.
+         */
+        inline void _wait_for_copies_out(model_t* model) {
+            for(auto& state : model->m_impl.m_copies_out) {
+                std::unique_lock<tl::mutex> lock(state->m_mutex);
+                while(state->m_total_left != 0)
+                    state->m_cv.wait(lock);
+            }
+            model->m_impl.m_copies_out.clear();
+        }
+
+        /**
+         * @brief If the model is being filled by a duplicate, waits for
+         * the copy to complete, then commits version 1 of the model (or
+         * leaves it unreadable if a stripe could not be copied). Must be
+         * called with the model locked, before writing or moving it.
+         */
+        inline void _finish_copy(model_t* model) {
+            auto state = model->m_impl.m_copy;
+            if(!state) return;
+            {
+                std::unique_lock<tl::mutex> lock(state->m_mutex);
+                while(state->m_total_left != 0)
+                    state->m_cv.wait(lock);
+            }
+            model->m_impl.m_copy.reset();
+            auto& stripes = model->m_impl.m_stripes;
+            std::size_t complete_stripes = 0;
+            for(std::size_t i = 0; i < stripes.size(); i++) {
+                bool complete = false;
+                for(std::size_t j = 0; j < stripes[i].m_replicas.size(); j++) {
+                    bool ready = state->ready(i, j);
+                    stripes[i].m_replicas[j].m_version = ready ? 1 : 0;
+                    complete = complete || ready;
+                }
+                if(complete) complete_stripes += 1;
+            }
+            bool complete = model->m_impl.m_ec_data
+                ? complete_stripes >= model->m_impl.m_ec_data
+                : complete_stripes == stripes.size();
+            if(!complete) {
+                m_logger->error("Failed to copy model \"{}\": {}", model->m_name, state->m_error);
+                model->m_impl.m_copy_error = state->m_error.empty() ? "copy failed" : state->m_error;
+                return;
+            }
+            if(!state->m_error.empty())
+                m_logger->warn("Some replicas of model \"{}\" could not be copied: {}",
+                        model->m_name, state->m_error);
+            std::string error;
+            if(!_commit(model, 1, error)) {
+                m_logger->error("Failed to commit copy of model \"{}\": {}", model->m_name, error);
+                model->m_impl.m_copy_error = error;
+                return;
+            }
+            m_logger->debug("Copy of model \"{}\" complete", model->m_name);
+            _record(model);
+        }
+
+        /**
+         * @brief Replica of a model being duplicated that a copy_task fills.
+         */
+        struct copy_target {
+            model_t*                    m_model;
+            std::shared_ptr<copy_state> m_state;
+            std::size_t                 m_stripe;
+            std::size_t                 m_replica;
+            std::shared_ptr<location>   m_dst;
+            bake::region                m_dst_region; // unused for clones
+            std::size_t                 m_dst_base = 0; // offset of the extent in m_dst_region
+        };
+
+        /**
+         * @brief Piece of the copy of a model being duplicated: either the
+         * clone of a whole replica on its own target (m_clone), or a chunk
+         * of a source replica copied to one or more replicas on other
+         * targets (the chunk is then read once for all of them).
+         */
+        struct copy_task {
+            std::size_t               m_stripe;
+            std::size_t               m_src_replica;
+            std::shared_ptr<location> m_src;
+            bake::region              m_src_region;
+            std::size_t               m_src_base = 0; // offset of the extent in m_src_region
+            std::size_t               m_offset = 0;
+            std::size_t               m_size = 0;
+            bool                      m_clone = false;
+            std::vector<copy_target>  m_targets;
+        };
+
+        /**
+         * @brief Sets up the duplication of a model into a new model:
+         * selects the locations of the new model's replicas, creates their
+         * regions, and appends the tasks copying the last committed version
+         * of the source to the provided vector. The new model is readable
+         * right away, reads wait for the stripes they need. Both models
+         * must be locked.
+         *
+         * @param locality Whether targets that already hold an up-to-date
+         * replica of a stripe should be preferred, so the stripe can be
+         * cloned without moving data across the network.
+         */
+        inline Status _prepare_copy(model_t* model, model_t* new_model, bool locality,
+                std::vector<copy_task>& tasks) {
+            new_model->m_model_config    = model->m_model_config;
+            new_model->m_model_signature = model->m_model_signature;
+            new_model->m_tags            = model->m_tags;
+            new_model->m_impl.m_size     = model->m_impl.m_size;
+
+            auto& stripes = model->m_impl.m_stripes;
+            auto& new_stripes = new_model->m_impl.m_stripes;
+            new_model->m_impl.m_ec_data   = model->m_impl.m_ec_data;
+            new_model->m_impl.m_ec_parity = model->m_impl.m_ec_parity;
+            new_model->m_impl.m_packed    = model->m_impl.m_packed;
+            new_model->m_impl.m_commit_stripes = model->m_impl.m_commit_stripes;
+            auto replication = model->m_impl.m_ec_data ? 1 : m_replication;
+            auto footprint = 2*stripes[0].m_size + commit_record::region_size();
+            std::vector<std::vector<std::shared_ptr<location>>> new_locs(stripes.size());
+            bool need_placement = !locality;
+            for(std::size_t i = 0; i < stripes.size() && locality; i++) {
+                for(const auto& r : stripes[i].m_replicas) {
+                    if(new_locs[i].size() == replication) break;
+                    if(r.m_version != model->m_impl.m_version) continue;
+                    auto loc = r.m_location.lock();
+                    if(!loc || loc->m_draining) continue;
+                    if(loc->m_capacity && loc->m_allocated + footprint > loc->m_capacity) continue;
+                    new_locs[i].push_back(std::move(loc));
+                }
+                if(new_locs[i].size() < replication) need_placement = true;
+            }
+            if(need_placement) {
+                auto placed = _select_locations(new_model->m_name, footprint, stripes.size(),
+                        replication, model->m_impl.m_ec_data != 0);
+                if(placed.empty()) {
+                    m_logger->error("Not enough storage targets to hold model \"{}\"", new_model->m_name);
+                    return Status(FLAMESTORE_ENOSPACE, "No storage target available");
+                }
+                // fragments of an erasure-coded model must stay on distinct
+                // servers, so they are either all local or all placed; stripes
+                // with too few local replicas are topped up with placed ones
+                // on other servers
+                for(std::size_t i = 0; i < stripes.size(); i++) {
+                    if(new_locs[i].empty() || model->m_impl.m_ec_data) {
+                        new_locs[i] = std::move(placed[i]);
+                        continue;
+                    }
+                    for(auto& loc : placed[i]) {
+                        if(new_locs[i].size() == replication) break;
+                        bool used = std::any_of(new_locs[i].begin(), new_locs[i].end(),
+                            [&loc](const std::shared_ptr<location>& l) {
+                                return l->m_ssg_member_id == loc->m_ssg_member_id;
+                            });
+                        if(!used) new_locs[i].push_back(std::move(loc));
+                    }
+                }
+            }
+            new_stripes.resize(stripes.size());
+            for(std::size_t i = 0; i < stripes.size(); i++) {
+                new_stripes[i].m_offset = stripes[i].m_offset;
+                new_stripes[i].m_size   = stripes[i].m_size;
+                new_stripes[i].m_replicas.resize(new_locs[i].size());
+                for(std::size_t j = 0; j < new_locs[i].size(); j++)
+                    new_stripes[i].m_replicas[j].bind(new_locs[i][j], new_model);
+            }
+
+            // the last committed regions of the source model become version 1
+            // of the new model; each replica is cloned from a source replica on
+            // the same target if there is one, otherwise it is copied in chunks
+            // from a source replica chosen per stripe, so that the reads are
+            // spread over the up-to-date replicas like hedged reads are
+            auto src_slot = model->m_impl.committed_slot();
+            auto dst_slot = commit_record::slot_of(1);
+            auto replicas = _list_replicas(new_model);
+            auto state = std::make_shared<copy_state>();
+            state->m_left.resize(new_stripes.size());
+            state->m_failed.resize(new_stripes.size());
+            for(std::size_t i = 0; i < new_stripes.size(); i++) {
+                state->m_left[i].resize(new_stripes[i].m_replicas.size(), 0);
+                state->m_failed[i].resize(new_stripes[i].m_replicas.size(), 0);
+            }
+            // the source of a stripe is the least loaded up-to-date replica,
+            // counting the chunks already assigned to it by this copy; equally
+            // loaded replicas take turns from one stripe to the next. The choice
+            // only depends on the state of the source model, so duplicates
+            // prepared together read each stripe from the same replica and
+            // their tasks can be merged by _start_copy
+            std::vector<std::size_t> stripe_source(stripes.size(), 0);
+            std::map<const location*, std::size_t> planned;
+            for(std::size_t i = 0; i < stripes.size(); i++) {
+                const auto& src = stripes[i];
+                stripe_source[i] = src.m_replicas.size();
+                std::size_t best_load = 0;
+                for(std::size_t n = 0; n < src.m_replicas.size(); n++) {
+                    auto sj = (i + n) % src.m_replicas.size();
+                    const auto& r = src.m_replicas[sj];
+                    if(r.m_version != model->m_impl.m_version) continue;
+                    auto loc = r.m_location.lock();
+                    if(!loc) continue;
+                    auto load = loc->m_inflight + planned[loc.get()];
+                    if(stripe_source[i] == src.m_replicas.size() || load < best_load) {
+                        stripe_source[i] = sj;
+                        best_load = load;
+                    }
+                }
+                if(stripe_source[i] != src.m_replicas.size())
+                    planned[src.m_replicas[stripe_source[i]].m_location.lock().get()] += src.m_size;
+            }
+            std::vector<copy_task> new_tasks;
+            for(std::size_t k = 0; k < replicas.size(); k++) {
+                auto i = replicas[k].first, j = replicas[k].second;
+                auto& src = stripes[i];
+                auto dst_loc = new_locs[i][j];
+                std::size_t src_replica = stripe_source[i];
+                // a replica on the destination's own target is cloned instead
+                for(std::size_t sj = 0; sj < src.m_replicas.size(); sj++) {
+                    const auto& r = src.m_replicas[sj];
+                    if(r.m_version != model->m_impl.m_version) continue;
+                    if(r.m_location.lock() == dst_loc) {
+                        src_replica = sj;
+                        break;
+                    }
+                }
+                std::shared_ptr<location> src_loc;
+                if(src_replica != src.m_replicas.size())
+                    src_loc = src.m_replicas[src_replica].m_location.lock();
+                if(!src_loc) {
+                    m_logger->error("No replica of stripe {} of model \"{}\" available", i, model->m_name);
+                    return Status(FLAMESTORE_EBAKE, "Bake region migration failed");
+                }
+                if(src.m_size == 0) continue;
+                copy_task task;
+                task.m_stripe      = i;
+                task.m_src_replica = src_replica;
+                task.m_src         = src_loc;
+                task.m_src_region  = src.m_replicas[src_replica].m_regions[src_slot];
+                task.m_src_base    = src.m_replicas[src_replica].m_offsets[src_slot];
+                task.m_targets.push_back({ new_model, state, i, j, dst_loc, bake::region() });
+                // extents of packed models cannot be cloned with migrate
+                if(src_loc == dst_loc && !model->m_impl.m_packed) {
+                    task.m_clone = true;
+                    task.m_size  = src.m_size;
+                    new_tasks.push_back(task);
+                    state->m_left[i][j] = 1;
+                    continue;
+                }
+                for(std::size_t offset = 0; offset < src.m_size; offset += m_copy_chunk_size) {
+                    task.m_offset = offset;
+                    task.m_size   = std::min(m_copy_chunk_size, src.m_size - offset);
+                    new_tasks.push_back(task);
+                    state->m_left[i][j] += 1;
+                }
+            }
+            state->m_total_left = new_tasks.size();
+
+            std::string error;
+            bool ok = _create_regions(new_model, dst_slot, error);
+            // chunked copies need their destination region up front
+            // (packed models already got their extent in a slab)
+            ok = ok && (new_model->m_impl.m_packed || _parallel_for(replicas.size(), [&](std::size_t k) {
+                auto i = replicas[k].first, j = replicas[k].second;
+                auto& r = new_stripes[i].m_replicas[j];
+                auto& loc = new_locs[i][j];
+                bool cloned = std::any_of(new_tasks.begin(), new_tasks.end(),
+                    [i, j](const copy_task& t) {
+                        return t.m_clone && t.m_stripe == i && t.m_targets[0].m_replica == j;
+                    });
+                if(cloned) return;
+                r.m_regions[dst_slot] = m_bake_client.create(
+                        loc->m_phandle, loc->m_target, new_stripes[i].m_size);
+            }, error));
+            if(!ok) {
+                // TODO remove the model from the database since it wasn't properly created
+                m_logger->error("Bake region creation failed: {}", error);
+                return Status(FLAMESTORE_EBAKE, "Bake region migration failed");
+            }
+            for(auto& t : new_tasks) {
+                auto& target = t.m_targets[0];
+                if(t.m_clone) continue;
+                const auto& r = new_stripes[t.m_stripe].m_replicas[target.m_replica];
+                target.m_dst_region = r.m_regions[dst_slot];
+                target.m_dst_base   = r.m_offsets[dst_slot];
+            }
+
+            new_model->m_impl.m_version = 1;
+            new_model->m_impl.m_writes  = 1;
+            for(auto& s : new_stripes)
+                for(auto& r : s.m_replicas)
+                    r.m_version = 1;
+            new_model->m_impl.m_copy = state;
+            if(new_tasks.empty()) {
+                _finish_copy(new_model);
+                return Status::OK();
+            }
+            auto& copies_out = model->m_impl.m_copies_out;
+            copies_out.erase(std::remove_if(copies_out.begin(), copies_out.end(),
+                [](const std::shared_ptr<copy_state>& c) {
+                    std::lock_guard<tl::mutex> lock(c->m_mutex);
+                    return c->m_total_left == 0;
+                }), copies_out.end());
+            copies_out.push_back(state);
+            m_logger->debug("Copying model \"{}\" into \"{}\" in {} task(s)",
+                    model->m_name, new_model->m_name, new_tasks.size());
+            std::move(new_tasks.begin(), new_tasks.end(), std::back_inserter(tasks));
+            return Status::OK();
+        }
+
+        /**
+         * @brief Starts a ULT running the provided copy tasks. Chunk tasks
+         * reading the same range of the same source replica (e.g. for
+         * several duplicates of a model) are merged so that the range is
+         * read only once.
+         */
+        inline void _start_copy(std::vector<copy_task> tasks) {
+            if(tasks.empty()) return;
+            auto merged = std::make_shared<std::vector<copy_task>>();
+            std::map<std::tuple<std::size_t, std::size_t, std::size_t>, std::size_t> index;
+            for(auto& t : tasks) {
+                if(!t.m_clone) {
+                    auto key = std::make_tuple(t.m_stripe, t.m_src_replica, t.m_offset);
+                    auto it = index.find(key);
+                    if(it != index.end()) {
+                        auto& m = (*merged)[it->second];
+                        m.m_targets.insert(m.m_targets.end(), t.m_targets.begin(), t.m_targets.end());
+                        continue;
+                    }
+                    index[key] = merged->size();
+                }
+                merged->push_back(std::move(t));
+            }
+            // stripes are copied in order so that reads of the
+            // first stripes are unblocked first
+            std::stable_sort(merged->begin(), merged->end(),
+                [](const copy_task& a, const copy_task& b) { return a.m_stripe < b.m_stripe; });
+            auto slot = commit_record::slot_of(1);
+            m_io_pool.make_thread([this, merged, slot]() {
+                _run_copy(*merged, slot);
+            }, tl::anonymous());
+        }
+
+        /**
+         * @brief Body of the ULT copying duplicated models. At most
+         * m_copy_parallelism tasks run at once. Clones are done with Bake's
+         * migrate to the same target, chunks are copied by the storage server
+         * holding the source with the flamestore_copy_chunk RPC. Once all the
+         * tasks are done, the copies are committed.
+         */
+        inline void _run_copy(std::vector<copy_task>& tasks, uint32_t slot) {
+            std::atomic<std::size_t> next{0};
+            std::string error;
+            _parallel_for(std::min(m_copy_parallelism, tasks.size()), [&](std::size_t) {
+                for(auto t = next++; t < tasks.size(); t = next++) {
+                    auto& task = tasks[t];
+                    // replicas for which a previous chunk failed are skipped
+                    std::vector<std::size_t> active;
+                    for(std::size_t d = 0; d < task.m_targets.size(); d++) {
+                        auto& target = task.m_targets[d];
+                        std::lock_guard<tl::mutex> lock(target.m_state->m_mutex);
+                        if(!target.m_state->m_failed[target.m_stripe][target.m_replica])
+                            active.push_back(d);
+                    }
+                    std::vector<std::string> errors(task.m_targets.size());
+                    try {
+                        inflight_guard src_inflight(*task.m_src, task.m_size);
+                        if(active.empty()) {
+                            // nothing to do
+                        } else if(task.m_clone) {
+                            auto& target = task.m_targets[0];
+                            auto region = m_bake_client.migrate(task.m_src->m_phandle,
+                                    task.m_src->m_target, task.m_src_region, task.m_size, false,
+                                    tl::endpoint(*m_engine, task.m_src->m_phandle.address()),
+                                    task.m_src->m_phandle.provider_id(), task.m_src->m_target);
+                            // readers only access this region once the task is marked done
+                            target.m_model->m_impl.m_stripes[target.m_stripe]
+                                .m_replicas[target.m_replica].m_regions[slot] = region;
+                        } else {
+                            copy_request c;
+                            c.m_src_target = task.m_src->m_target;
+                            c.m_src_region = task.m_src_region;
+                            c.m_offset     = task.m_src_base + task.m_offset;
+                            c.m_size       = task.m_size;
+                            for(auto d : active) {
+                                auto& target = task.m_targets[d];
+                                copy_destination dst;
+                                dst.m_addr        = tl::endpoint(*m_engine, target.m_dst->m_phandle.address());
+                                dst.m_provider_id = target.m_dst->m_phandle.provider_id();
+                                dst.m_target      = target.m_dst->m_target;
+                                dst.m_region      = target.m_dst_region;
+                                dst.m_offset      = target.m_dst_base + task.m_offset;
+                                c.m_destinations.push_back(std::move(dst));
+                            }
+                            std::vector<int32_t> result = m_rpc_copy_chunk.on(task.m_src->m_endpoint)(c);
+                            for(std::size_t a = 0; a < active.size(); a++) {
+                                int32_t ret = a < result.size() ? result[a] : -1;
+                                if(ret != 0)
+                                    errors[active[a]] = "Could not copy chunk (error "
+                                        + std::to_string(ret) + ")";
+                            }
+                        }
+                    } catch(const std::exception& ex) {
+                        std::string what = ex.what();
+                        for(auto d : active)
+                            errors[d] = what.empty() ? "Bake error" : what;
+                    }
+                    for(std::size_t d = 0; d < task.m_targets.size(); d++) {
+                        auto& target = task.m_targets[d];
+                        auto& state = *target.m_state;
+                        std::lock_guard<tl::mutex> lock(state.m_mutex);
+                        if(!errors[d].empty()) {
+                            state.m_failed[target.m_stripe][target.m_replica] = 1;
+                            state.m_error = errors[d];
+                        }
+                        state.m_left[target.m_stripe][target.m_replica] -= 1;
+                        state.m_total_left -= 1;
+                        state.m_cv.notify_all();
+                    }
+                }
+            }, error);
+            std::vector<std::pair<model_t*, std::shared_ptr<copy_state>>> copies;
+            for(const auto& task : tasks)
+                for(const auto& target : task.m_targets)
+                    copies.emplace_back(target.m_model, target.m_state);
+            std::sort(copies.begin(), copies.end());
+            copies.erase(std::unique(copies.begin(), copies.end()), copies.end());
+            for(auto& c : copies) {
+                lock_guard_t guard(c.first->m_mutex);
+                if(c.first->m_impl.m_copy == c.second)
+                    _finish_copy(c.first);
+            }
+        }
+
+        /**
+         * @brief Writes a new version of a model from the provided source
+         * (the client's memory, or a burst buffer entry) to all its
+         * replicas, then commits it. The data starts at offset base of the
+         * source's bulk handle (e.g. in a batch). Must be called with the
+         * model locked.
+         */
+        inline Status _write_version(model_t* model, const tl::bulk& source_bulk,
+                const std::string& source_addr, const tl::endpoint& source_ep,
+                std::size_t size, std::size_t base = 0) {
+            std::vector<char> written;
+            auto status = _write_shadow(model, source_bulk, source_addr, source_ep, size, written, base);
+            if(status.m_code != FLAMESTORE_OK)
+                return status;
+            return _commit_shadow(model, written);
+        }
+
+        /**
+         * @brief First half of _write_version: writes a new version of a
+         * model to the shadow regions of its replicas, without committing
+         * it. Must be called with the model locked.
+         *
+         * @param written Set to 1 for each replica (or fragment) written,
+         * in the order of _list_replicas.
+         * @param base Offset of the data in the source's bulk handle.
+         */
+        inline Status _write_shadow(model_t* model, const tl::bulk& source_bulk,
+                const std::string& source_addr, const tl::endpoint& source_ep,
+                std::size_t size, std::vector<char>& written, std::size_t base = 0) {
+            if(size != model->m_impl.m_size) {
+                m_logger->error("Size {} does not match the size {} of model \"{}\"",
+                        size, model->m_impl.m_size, model->m_name);
+                return Status(FLAMESTORE_EINVAL, "Data size does not match the model's size");
+            }
+            _finish_copy(model);
+            _wait_for_copies_out(model);
+            // the new version goes into the shadow regions that do not hold
+            // the last committed version, so a failure at any point below
+            // leaves the previous checkpoint intact and readable
+            auto version = model->m_impl.m_version + 1;
+            auto slot = commit_record::slot_of(version);
+            auto& stripes = model->m_impl.m_stripes;
+            auto replicas = _list_replicas(model);
+            written.assign(replicas.size(), 0);
+            std::string error;
+            if(model->m_impl.m_ec_data) {
+                _write_fragments(model, slot, source_ep, source_bulk, size, written, error, base);
+            } else {
+                _parallel_for(replicas.size(), [&](std::size_t k) {
+                    auto& s = stripes[replicas[k].first];
+                    auto& r = s.m_replicas[replicas[k].second];
+                    auto loc = r.m_location.lock();
+                    if(!loc) return; // storage server is gone, replica stays stale
+                    if(s.m_size != 0) {
+                        inflight_guard inflight(*loc, s.m_size);
+                        m_bake_client.write(loc->m_phandle,
+                                        loc->m_target,
+                                        r.m_regions[slot],
+                                        r.m_offsets[slot],
+                                        source_bulk.get_bulk(),
+                                        base + s.m_offset,
+                                        source_addr,
+                                        s.m_size);
+                        _persist(*loc, r.m_regions[slot], r.m_offsets[slot], s.m_size);
+                    }
+                    written[k] = 1;
+                }, error);
+            }
+            if(!error.empty()) {
+                m_logger->warn("Some replicas of model \"{}\" could not be written: {}", model->m_name, error);
+            }
+            // every stripe needs at least one replica holding the new version,
+            // erasure-coded models need at least k fragments
+            std::vector<bool> stripe_written(stripes.size(), false);
+            for(std::size_t k = 0; k < replicas.size(); k++)
+                if(written[k]) stripe_written[replicas[k].first] = true;
+            bool complete = model->m_impl.m_ec_data
+                ? (std::size_t)std::count(stripe_written.begin(), stripe_written.end(), true) >= model->m_impl.m_ec_data
+                : std::find(stripe_written.begin(), stripe_written.end(), false) == stripe_written.end();
+            if(!complete) {
+                m_logger->error("Failed to write in Bake: {}", error.empty() ? "no replica available" : error);
+                return Status(FLAMESTORE_EBAKE, "Failed to write in Bake");
+            }
+            return Status::OK();
+        }
+
+        /**
+         * @brief Second half of _write_version: flips the commit record
+         * of a model written by _write_shadow. Must be called with the
+         * model locked since _write_shadow.
+         */
+        inline Status _commit_shadow(model_t* model, const std::vector<char>& written) {
+            auto version = model->m_impl.m_version + 1;
+            auto& stripes = model->m_impl.m_stripes;
+            auto replicas = _list_replicas(model);
+            std::string error;
+            // flipping the commit record
+            if(!_commit(model, version, error)) {
+                m_logger->error("Failed to commit version {} of model \"{}\": {}",
+                                version, model->m_name, error);
+                return Status(FLAMESTORE_EBAKE, "Failed to persist in Bake");
+            }
+            for(std::size_t k = 0; k < replicas.size(); k++)
+                if(written[k]) stripes[replicas[k].first].m_replicas[replicas[k].second].m_version = version;
+            // a version that failed to drain is older than this one, and
+            // a duplicate that could not be copied is now fully written
+            _drop_failed_write(model);
+            model->m_impl.m_copy_error.clear();
+            if(m_read_cache)
+                m_read_cache->invalidate(model->m_name);
+            m_logger->debug("Committed version {} of model {}", version, model->m_name);
+            _record(model);
+            return Status::OK();
+        }
+
+        /**
+         * @brief Reads the committed version of a model from Bake into
+         * the provided bulk handle (the client's memory, or a read cache
+         * entry), at offset base. Must be called with the model locked.
+         *
+         * @return false if the model could not be read, with error set.
+         */
+        inline bool _read_version(const model_t* model, const std::string& dest_addr,
+                const tl::endpoint& dest_ep, const tl::bulk& dest_bulk,
+                std::size_t size, std::string& error, std::size_t base = 0) {
+            if(model->m_impl.m_ec_data) {
+                try {
+                    _read_fragments(model, dest_addr, dest_ep, dest_bulk, size, base);
+                } catch(const std::exception& ex) {
+                    error = ex.what();
+                    return false;
+                }
+                return true;
+            }
+            return _parallel_for(model->m_impl.m_stripes.size(), [&](std::size_t i) {
+                _read_stripe(model, i, dest_addr, dest_ep, dest_bulk, base);
+            }, error);
+        }
+
+        /**
+         * @brief Reads a model that missed in the read cache into a new
+         * cache entry exposed for RDMA. Must be called with the model locked.
+         *
+         * @return the entry (not yet inserted), nullptr if it could not be read.
+         */
+        inline std::shared_ptr<ReadCache::entry> _fill_cache_entry(
+                const model_t* model, std::string& error) {
+            auto e = std::make_shared<ReadCache::entry>();
+            e->m_key     = model->m_name;
+            e->m_version = model->m_impl.m_version;
+            auto size    = model->m_impl.m_size;
+            try {
+                e->m_bulk = _expose_staging(e->m_data, size);
+            } catch(const tl::exception& ex) {
+                error = ex.what();
+                return nullptr;
+            }
+            if(!_read_version(model, m_self_addr, m_self_ep, e->m_bulk, size, error))
+                return nullptr;
+            return e;
+        }
+
+        /**
+         * @brief Looks up the committed version of a model in the read
+         * cache. On a miss, if the model is read often enough to be worth
+         * the extra copy, a background ULT reads it into a new entry, so
+         * that the read that missed is not delayed. Must be called with
+         * the model locked.
+         *
+         * @return the entry, nullptr if there is no cache or the model
+         * should be read from Bake.
+         */
+        inline std::shared_ptr<ReadCache::entry> _cached_entry(const model_t* model) {
+            if(!m_read_cache) return nullptr;
+            auto entry = m_read_cache->get(model->m_name, model->m_impl.m_version);
+            if(!entry && m_read_cache->admit(model->m_name, model->m_impl.m_size)) {
+                auto name = model->m_name;
+                m_io_pool.make_thread([this, name]() {
+                    _fill_cache(name);
+                }, tl::anonymous());
+            }
+            return entry;
+        }
+
+        /**
+         * @brief Body of the ULT filling the read cache entry of a model
+         * admitted by _cached_entry.
+         */
+        inline void _fill_cache(const std::string& model_name) {
+            auto model = _find_model(model_name);
+            if(!model) {
+                m_read_cache->abandon(model_name);
+                return;
+            }
+            lock_guard_t guard(model->m_mutex);
+            std::string error;
+            auto entry = model->m_impl.m_version ? _fill_cache_entry(model, error) : nullptr;
+            if(entry) {
+                m_read_cache->put(std::move(entry));
+                return;
+            }
+            m_read_cache->abandon(model->m_name);
+            if(!error.empty())
+                m_logger->warn("Failed to read model \"{}\" into the read cache: {}", model->m_name, error);
+        }
+
+        /**
+         * @brief Reserves space in the burst buffer, waiting for staged
+         * writes to drain if there is not enough (backpressure).
+         *
+         * @return the sequence number of the staged write, which a flush
+         * uses to wait only for the writes staged before it.
+         */
+        inline uint64_t _reserve_burst_buffer(std::size_t size) {
+            std::unique_lock<tl::mutex> lock(m_burst_mutex);
+            while(m_burst_used + size > m_burst_buffer_size)
+                m_burst_cv.wait(lock);
+            m_burst_used += size;
+            auto seq = m_burst_next_seq++;
+            m_burst_pending.insert(seq);
+            return seq;
+        }
+
+        /**
+         * @brief Releases the space of a staged write that was
+         * drained or not staged after all.
+         */
+        inline void _release_burst_buffer(std::size_t size, uint64_t seq) {
+            std::unique_lock<tl::mutex> lock(m_burst_mutex);
+            m_burst_used -= size;
+            m_burst_pending.erase(seq);
+            m_burst_cv.notify_all();
+        }
+
+        /**
+         * @brief Records the failure of a staged write (reported by the
+         * next flush). The version remains the one returned by reads of
+         * the model until it is superseded by a successful write or the
+         * failure is reported. Its space in the burst buffer is released
+         * so that the buffer cannot fill up with failed versions (there
+         * is at most one per model). Must be called with the model locked.
+         */
+        inline void _fail_burst_write(model_t* model, std::shared_ptr<staged_write> staged,
+                const Status& status) {
+            _drop_failed_write(model);
+            std::unique_lock<tl::mutex> lock(m_burst_mutex);
+            m_burst_used -= staged->m_data.size();
+            m_burst_pending.erase(staged->m_burst_seq);
+            m_burst_failures += 1;
+            m_burst_error = status.m_message;
+            m_burst_failed.insert(model);
+            model->m_impl.m_failed = std::move(staged);
+            m_burst_cv.notify_all();
+        }
+
+        /**
+         * @brief Forgets the version of a model that failed to drain,
+         * if any. Must be called with the model locked.
+         */
+        inline void _drop_failed_write(model_t* model) {
+            auto& failed = model->m_impl.m_failed;
+            if(!failed) return;
+            std::unique_lock<tl::mutex> lock(m_burst_mutex);
+            m_burst_failed.erase(model);
+            failed.reset();
+        }
+
+        /**
+         * @brief Responds to a write that was superseded by a newer
+         * write of the same model (see pending_writes).
+         */
+        inline void _respond_superseded(const tl::request& req, const std::string& model_name) {
+            m_logger->debug("Write of model \"{}\" superseded by a newer one", model_name);
+            m_superseded_writes += 1;
+            req.respond(Status(FLAMESTORE_ESUPERSEDED, "Superseded by a newer write"));
+        }
+
+        /**
+         * @brief Size of a model, read with the model locked: _register
+         * sets it after the model is published, so a request finding the
+         * model must wait for the registration to complete.
+         */
+        inline std::size_t _size_of(model_t* model) {
+            lock_guard_t guard(model->m_mutex);
+            return model->m_impl.m_size;
+        }
+
+        /**
+         * @brief Counts a write acknowledged to a client: get_model_info
+         * reports this count as the version of the model. Versions
+         * staged in the burst buffer are counted when staged, not when
+         * drained. Must be called with the model locked.
+         */
+        inline Status _acknowledge(model_t* model, Status status) {
+            if(status.m_code == FLAMESTORE_OK)
+                model->m_impl.m_writes += 1;
+            return status;
+        }
+
+        /**
+         * @brief Handles a write that may not proceed (see pending_writes):
+         * waits for the outcome of the newer write it is parked behind,
+         * and responds if it is superseded. Must be called with no lock
+         * held and no burst-buffer space reserved.
+         *
+         * @return true if the write must be retried.
+         */
+        inline bool _hold_write(pending_writes::guard& pending, pending_writes::decision decision,
+                const tl::request& req, const std::string& model_name) {
+            if(decision == pending_writes::PARK) {
+                m_logger->debug("Write of model \"{}\" parked behind a newer one", model_name);
+                decision = pending.wait();
+            }
+            if(decision == pending_writes::RETRY) {
+                m_logger->debug("Retrying write of model \"{}\" after a newer one failed", model_name);
+                return true;
+            }
+            _respond_superseded(req, model_name);
+            return false;
+        }
+
+        /**
+         * @brief Writes the oldest staged version of a model to Bake.
+         * Must be called with the model locked.
+         */
+        inline void _drain_one(model_t* model) {
+            auto staged = model->m_impl.m_staged.front();
+            auto size = staged->m_data.size();
+            auto status = _write_version(model, staged->m_bulk, m_self_addr, m_self_ep, size);
+            model->m_impl.m_staged.pop_front();
+            if(status.m_code != FLAMESTORE_OK) {
+                m_logger->error("Failed to write staged version of model \"{}\": {}",
+                        model->m_name, status.m_message);
+                _fail_burst_write(model, std::move(staged), status);
+            } else {
+                _release_burst_buffer(size, staged->m_burst_seq);
+            }
+        }
+
+        /**
+         * @brief Body of the ULT draining the staged versions of a model.
+         * The model is locked for each version written, so reads and new
+         * writes can get in between.
+         */
+        inline void _drain_staged(model_t* model) {
+            while(true) {
+                lock_guard_t guard(model->m_mutex);
+                if(model->m_impl.m_staged.empty()) return;
+                _drain_one(model);
+            }
+        }
+
+        /**
+         * @brief Waits for the writes staged before the call to be drained.
+         * Writes staged afterwards are not waited for, so that a flush
+         * completes even if clients keep the burst buffer busy. The
+         * versions that failed to drain are then released.
+         *
+         * @return the number of staged writes that failed since the
+         * last call, and the error message of the last one.
+         */
+        inline std::size_t _wait_for_drain(std::string& error) {
+            std::set<model_t*> failed;
+            std::size_t failures;
+            uint64_t horizon;
+            {
+                std::unique_lock<tl::mutex> lock(m_burst_mutex);
+                horizon = m_burst_next_seq;
+                while(!m_burst_pending.empty() && *m_burst_pending.begin() < horizon)
+                    m_burst_cv.wait(lock);
+                failures = m_burst_failures;
+                error = std::move(m_burst_error);
+                m_burst_failures = 0;
+                m_burst_error.clear();
+                failed.swap(m_burst_failed);
+            }
+            for(auto model : failed) {
+                lock_guard_t guard(model->m_mutex);
+                // unless it was replaced by a write staged after the flush
+                // started, the failed version is no longer readable
+                auto& version = model->m_impl.m_failed;
+                if(!version || version->m_burst_seq >= horizon) continue;
+                version.reset();
+            }
+            return failures;
+        }
+
+        /**
+         * @brief Pulls size bytes at the provided offset of a client's bulk
+         * handle into a new buffer of model_size bytes, exposed so that
+         * Bake can pull from it.
+         */
+        inline Status _pull_staged(const tl::endpoint& ep, const tl::bulk& remote_bulk,
+                std::size_t offset, std::size_t size, std::size_t model_size,
+                std::shared_ptr<staged_write>& staged) {
+            staged = std::make_shared<staged_write>();
+            try {
+                staged->m_bulk = _expose_staging(staged->m_data, model_size);
+                size = std::min(size, model_size);
+                if(size != 0)
+                    staged->m_bulk(0, size) << remote_bulk.on(ep).select(offset, size);
+            } catch(const tl::exception& ex) {
+                m_logger->error("Failed to pull model data: {}", ex.what());
+                return Status(FLAMESTORE_EIO, "Failed to pull model data");
+            }
+            return Status::OK();
+        }
+
+        /**
+         * @brief Writes a version of a model held in the master's memory:
+         * queues it in the burst buffer (for which space must have been
+         * reserved) if buffered, writes it to Bake otherwise. Must be
+         * called with the model locked.
+         */
+        inline Status _write_local(model_t* model,
+                std::shared_ptr<staged_write> staged, bool buffered) {
+            if(buffered) {
+                auto& queue = model->m_impl.m_staged;
+                queue.push_back(std::move(staged));
+                if(queue.size() == 1) {
+                    m_io_pool.make_thread([this, model]() {
+                        _drain_staged(model);
+                    }, tl::anonymous());
+                }
+                return Status::OK();
+            }
+            // versions staged earlier must reach Bake first
+            while(!model->m_impl.m_staged.empty())
+                _drain_one(model);
+            return _write_version(model, staged->m_bulk, m_self_addr, m_self_ep, staged->m_data.size());
+        }
+
+        /**
+         * @brief Creates a model, selects the locations of its replicas
+         * and creates its regions in Bake.
+         */
+        inline Status _register(const std::string& model_name,
+                const std::string& model_config,
+                std::size_t model_size,
+                const std::string& model_signature) {
+            auto status = _check_name(model_name);
+            if(status.m_code != FLAMESTORE_OK)
+                return status;
+            bool created = false;
+            auto model = _find_or_create_model(model_name, created);
+            if(not created) {
+                m_logger->error("Model \"{}\" already exists", model_name);
+                return Status(
+                            FLAMESTORE_EEXISTS,
+                            "A model with the same name is already registered");
+            }
+            m_logger->info("Model \"{}\" created", model_name);
+
+            lock_guard_t guard(model->m_mutex);
+
+            m_logger->info("Registering model \"{}\"", model_name);
+
+            model->m_model_config    = m_strings->intern(model_config);
+            model->m_model_signature = m_strings->intern(model_signature);
+            model->m_impl.m_size     = model_size;
+
+            // split the model into stripes (or erasure-coded fragments)
+            // and select locations for their replicas; small models are
+            // kept in a single stripe packed into shared slabs
+            auto& stripes = model->m_impl.m_stripes;
+            if(m_erasure_code)
+                _compute_ec_layout(model_size, model->m_impl);
+            else if(m_packed_threshold != 0 && model_size <= m_packed_threshold) {
+                model->m_impl.m_packed = true;
+                stripes.resize(1);
+                stripes[0].m_offset = 0;
+                stripes[0].m_size   = model_size;
+            } else
+                _compute_layout(model_size, stripes);
+            auto locs = _select_locations(model_name,
+                    2*stripes[0].m_size + commit_record::region_size(),
+                    stripes.size(), m_erasure_code ? 1 : m_replication,
+                    (bool)m_erasure_code);
+            if(locs.empty()) {
+                m_logger->error("Not enough storage targets to hold model \"{}\"", model_name);
+                return Status(FLAMESTORE_ENOSPACE, "No storage target available");
+            }
+            for(std::size_t i = 0; i < stripes.size(); i++) {
+                stripes[i].m_replicas.resize(locs[i].size());
+                for(std::size_t j = 0; j < locs[i].size(); j++)
+                    stripes[i].m_replicas[j].bind(locs[i][j], model);
+            }
+
+            // allocate the shadow regions and the commit regions in Bake
+            m_logger->debug("Creating bake regions for {} stripe(s) of {}model of size {}",
+                    stripes.size(), model->m_impl.m_packed ? "packed " : "", model_size);
+            std::string error;
+            if(!_create_regions(model, -1, error)) {
+                // TODO remove the model from the database since it wasn't properly created
+                m_logger->error("Bake region creation failed: {}", error);
+                return Status(FLAMESTORE_EBAKE, "Bake region creation failed");
+            }
+            m_logger->debug("Regions successfuly created");
+            _record(model);
+
+            return _sync_catalog();
+        }
+
+        /**
+         * @brief Returns the status of a read of a model that is a duplicate
+         * whose copy failed, or is failing (the status returned by reads
+         * otherwise, e.g. when the Bake read failed).
+         */
+        inline Status _copy_failure(const model_t* model, Status otherwise) const {
+            std::string error = model->m_impl.m_copy_error;
+            if(error.empty() && model->m_impl.m_copy) {
+                std::lock_guard<tl::mutex> lock(model->m_impl.m_copy->m_mutex);
+                error = model->m_impl.m_copy->m_error;
+            }
+            if(error.empty()) return otherwise;
+            m_logger->error("Model \"{}\" could not be copied from its source: {}", model->m_name, error);
+            return Status(FLAMESTORE_ECOPY, "Model could not be duplicated: " + error);
+        }
+
+        /**
+         * @brief Pushes the latest version of a model into a client's
+         * bulk handle, at offset base, from the burst buffer, the read
+         * cache, or Bake. Reads of a duplicate whose copy failed return
+         * FLAMESTORE_ECOPY. Must be called with the model locked.
+         */
+        inline Status _push_to(const model_t* model,
+                const std::string& client_addr,
+                const tl::endpoint& client_ep,
+                const tl::bulk& remote_bulk,
+                std::size_t size,
+                std::size_t base = 0) {
+            // the latest version may still be in the burst buffer
+            if(auto staged = model->m_impl.latest_staged()) {
+                auto n = std::min(size, staged->m_data.size());
+                try {
+                    if(n != 0)
+                        staged->m_bulk(0, n) >> remote_bulk.on(client_ep).select(base, n);
+                } catch(const tl::exception& ex) {
+                    m_logger->error("Failed to push staged data of model \"{}\": {}", model->m_name, ex.what());
+                    return Status(FLAMESTORE_EIO, "Failed to push model data");
+                }
+                return Status::OK();
+            }
+            if(!model->m_impl.m_copy_error.empty())
+                return _copy_failure(model, Status::OK());
+            // hot models are served from the master's memory
+            auto entry = _cached_entry(model);
+            if(entry) {
+                auto n = std::min(size, entry->m_data.size());
+                try {
+                    if(n != 0)
+                        entry->m_bulk(0, n) >> remote_bulk.on(client_ep).select(base, n);
+                } catch(const tl::exception& ex) {
+                    m_logger->error("Failed to push cached data of model \"{}\": {}", model->m_name, ex.what());
+                    return Status(FLAMESTORE_EIO, "Failed to push model data");
+                }
+                return Status::OK();
+            }
+            std::string error;
+            if(!_read_version(model, client_addr, client_ep, remote_bulk, size, error, base)) {
+                m_logger->error("Failed to read from Bake: {}", error);
+                return _copy_failure(model, Status(FLAMESTORE_EBAKE, "Failed to read from Bake"));
+            }
+            return Status::OK();
+        }
+
+        /**
+         * @brief Same as _push_to, but copies the data into a vector
+         * to be sent inline. Must be called with the model locked.
+         */
+        inline Status _read_inline(const model_t* model,
+                std::size_t size,
+                std::vector<char>& data) {
+            auto n = std::min(size, model->m_impl.m_size);
+            // same sources as read_model: the burst buffer, the read cache, Bake
+            const std::vector<char>* source = nullptr;
+            if(auto staged = model->m_impl.latest_staged())
+                source = &staged->m_data;
+            else if(!model->m_impl.m_copy_error.empty())
+                return _copy_failure(model, Status::OK());
+            auto entry = source ? nullptr : _cached_entry(model);
+            if(entry)
+                source = &entry->m_data;
+            if(source) {
+                n = std::min(n, source->size());
+                data.assign(source->begin(), source->begin() + n);
+                return Status::OK();
+            }
+            std::string error;
+            try {
+                auto local_bulk = _expose_staging(data, model->m_impl.m_size);
+                if(!_read_version(model, m_self_addr, m_self_ep, local_bulk, model->m_impl.m_size, error)) {
+                    m_logger->error("Failed to read from Bake: {}", error);
+                    return _copy_failure(model, Status(FLAMESTORE_EBAKE, "Failed to read from Bake"));
+                }
+            } catch(const tl::exception& ex) {
+                m_logger->error("Failed to expose buffer for model \"{}\": {}", model->m_name, ex.what());
+                return Status(FLAMESTORE_EIO, "Failed to read model data");
+            }
+            data.resize(n);
+            return Status::OK();
+        }
+
+    public:
+
+        MochiBackend(const ServerContext& ctx, const AbstractServerBackend::config_type& config)
+        : m_engine(ctx.m_engine)
+        , m_logger(ctx.m_logger)
+        , m_strings(ctx.m_strings)
+        , m_scheduler(ctx.m_scheduler)
+        , m_io_pool(ctx.m_io_pool ? *ctx.m_io_pool : ctx.m_engine->get_handler_pool())
+        , m_bake_client(m_engine->get_margo_instance())
+        , m_rpc_storage_stats(m_engine->define("flamestore_storage_stats"))
+        , m_rpc_persist_batch(m_engine->define("flamestore_persist_batch"))
+        , m_rpc_copy_chunk(m_engine->define("flamestore_copy_chunk")) {
+            m_logger->debug("Initializing mochi backend");
+            std::string placement = "random";
+            auto it = config.find("placement");
+            if(it != config.end())
+                placement = it->second;
+            m_placement = AbstractPlacementPolicy::create(placement);
+            if(!m_placement) {
+                m_logger->critical("Unknown placement policy \"{}\"", placement);
+                throw std::runtime_error("Unknown placement policy "+placement);
+            }
+            m_logger->info("Using placement policy \"{}\"", placement);
+            it = config.find("stripe_size");
+            if(it != config.end())
+                m_stripe_size = _parse_size(it->second);
+            it = config.find("stripe_count");
+            if(it != config.end()) {
+                if(it->second == "auto")
+                    m_stripe_count = 0;
+                else
+                    m_stripe_count = std::max<std::size_t>(1, std::stoul(it->second));
+            }
+            if(m_stripe_size != 0 && m_stripe_count == 0)
+                m_logger->info("Striping models across all storage targets in stripes of at least {} bytes",
+                        m_stripe_size);
+            else if(m_stripe_size != 0 && m_stripe_count > 1)
+                m_logger->info("Striping models in up to {} stripes of at least {} bytes",
+                        m_stripe_count, m_stripe_size);
+            it = config.find("replication");
+            if(it != config.end())
+                m_replication = std::max<std::size_t>(1, std::stoul(it->second));
+            it = config.find("hedge_delay_ms");
+            if(it != config.end())
+                m_hedge_delay_ms = std::stoul(it->second);
+            if(m_replication > 1)
+                m_logger->info("Replicating models {} times (hedge delay: {} ms)",
+                        m_replication, m_hedge_delay_ms);
+            unsigned ec_data = 0, ec_parity = 0;
+            it = config.find("ec_data");
+            if(it != config.end())
+                ec_data = std::stoul(it->second);
+            it = config.find("ec_parity");
+            if(it != config.end())
+                ec_parity = std::stoul(it->second);
+            if(ec_data != 0) {
+                m_erasure_code = std::make_unique<ErasureCode>(ec_data, ec_parity);
+                m_logger->info("Erasure coding models with {} data + {} parity fragments ({} kernel)",
+                        ec_data, ec_parity, ErasureCode::kernel_name());
+                if(m_replication > 1 || m_stripe_count > 1)
+                    m_logger->warn("Erasure coding replaces striping and replication");
+            }
+            it = config.find("rebalance");
+            if(it != config.end())
+                m_rebalance = (it->second != "off" && it->second != "false" && it->second != "0");
+            it = config.find("rebalance_threshold");
+            if(it != config.end())
+                m_rebalance_threshold = std::stod(it->second);
+            it = config.find("rebalance_rate");
+            if(it != config.end())
+                m_rebalance_rate = _parse_size(it->second);
+            if(m_rebalance) {
+                m_logger->info("Rebalancing enabled (threshold: {}, rate: {} bytes/sec)",
+                        m_rebalance_threshold, m_rebalance_rate);
+                m_rebalancer = m_io_pool.make_thread([this]() {
+                    _rebalancer_loop();
+                });
+            }
+            it = config.find("report_ttl_ms");
+            if(it != config.end())
+                m_report_ttl_ms = std::stoul(it->second);
+            it = config.find("busy_queue_depth");
+            if(it != config.end())
+                m_busy_queue_depth = std::stoul(it->second);
+            it = config.find("group_commit_us");
+            if(it != config.end())
+                m_group_commit_us = std::stoul(it->second);
+            it = config.find("group_commit_bytes");
+            if(it != config.end())
+                m_group_commit_bytes = _parse_size(it->second);
+            if(m_group_commit_us != 0)
+                m_logger->info("Group commit of persist requests enabled (window: {} us, threshold: {} bytes)",
+                        m_group_commit_us, m_group_commit_bytes);
+            it = config.find("catalog");
+            if(it != config.end()) {
+                std::string catalog_type = "leveldb";
+                unsigned flush_interval_ms = 100;
+                auto it2 = config.find("catalog_type");
+                if(it2 != config.end())
+                    catalog_type = it2->second;
+                it2 = config.find("catalog_flush_ms");
+                if(it2 != config.end())
+                    flush_interval_ms = std::stoul(it2->second);
+                // by default new models are acknowledged before their entry is
+                // flushed, and are lost if the master crashes within a flush
+                // interval; writes are not affected since their version is
+                // recovered from the commit records (see _recover_version)
+                it2 = config.find("catalog_sync");
+                if(it2 != config.end())
+                    m_catalog_sync = (it2->second != "off" && it2->second != "false" && it2->second != "0");
+                m_catalog = std::make_unique<Catalog>(*m_engine, m_logger,
+                        it->second, catalog_type, flush_interval_ms);
+                if(!m_catalog_sync)
+                    m_logger->info("New models may be lost if the master stops within {} ms of their creation",
+                            flush_interval_ms);
+                _load_catalog();
+            }
+            it = config.find("burst_buffer");
+            if(it != config.end())
+                m_burst_buffer_size = _parse_size(it->second);
+            if(m_burst_buffer_size != 0)
+                m_logger->info("Staging writes in a burst buffer of {} bytes", m_burst_buffer_size);
+            it = config.find("copy_chunk_size");
+            if(it != config.end())
+                m_copy_chunk_size = std::max<std::size_t>(1, _parse_size(it->second));
+            it = config.find("copy_parallelism");
+            if(it != config.end())
+                m_copy_parallelism = std::max<std::size_t>(1, std::stoul(it->second));
+            it = config.find("duplicate_locality");
+            if(it != config.end())
+                m_duplicate_locality = (it->second != "off" && it->second != "false" && it->second != "0");
+            it = config.find("packed_threshold");
+            if(it != config.end())
+                m_packed_threshold = _parse_size(it->second);
+            it = config.find("slab_size");
+            if(it != config.end())
+                m_slab_size = _parse_size(it->second);
+            it = config.find("slab_compaction");
+            if(it != config.end())
+                m_slab_compaction = std::stod(it->second);
+            if(m_packed_threshold != 0)
+                m_logger->info("Packing models of up to {} bytes in slabs of {} bytes",
+                        m_packed_threshold, m_slab_size);
+            it = config.find("read_cache");
+            if(it != config.end()) {
+                auto read_cache_size = _parse_size(it->second);
+                if(read_cache_size != 0) {
+                    m_read_cache = std::make_unique<ReadCache>(read_cache_size);
+                    m_logger->info("Caching frequently read models in {} bytes of memory", read_cache_size);
+                }
+            }
+            m_self_ep   = m_engine->self();
+            m_self_addr = m_self_ep;
+        }
+
+        MochiBackend(const AbstractServerBackend&)            = delete;
+        MochiBackend(AbstractServerBackend&&)                 = delete;
+        MochiBackend& operator=(const AbstractServerBackend&) = delete;
+        MochiBackend& operator=(AbstractServerBackend&&)      = delete;
+        ~MochiBackend()                              = default;
+
+        virtual void register_model(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const std::string& model_config,
+                std::size_t& model_size,
+                const std::string& model_signature) override;
+
+        virtual void reload_model(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name) override;
+
+        virtual void write_model(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const std::string& model_signature,
+                const tl::bulk& remote_bulk,
+                const std::size_t& size) override;
+
+        virtual void register_and_write_model(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const std::string& model_config,
+                std::size_t& model_size,
+                const std::string& model_signature,
+                const tl::bulk& remote_bulk,
+                const std::vector<char>& data) override;
+
+        virtual void reload_model_data(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const tl::bulk& remote_bulk,
+                const std::size_t& capacity,
+                const tl::bulk& config_bulk,
+                const std::size_t& config_capacity,
+                const std::size_t& max_inline) override;
+
+        virtual void get_model_info(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const tl::bulk& remote_bulk,
+                const std::size_t& capacity,
+                const std::size_t& max_inline) override;
+
+        virtual void read_model(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const std::string& model_signature,
+                const tl::bulk& remote_bulk,
+                const std::size_t& size) override;
+
+        virtual void write_model_inline(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::string& model_name,
+                const std::string& model_signature,
+                const std::vector<char>& data) override;
 
-        virtual void write_model(
+        virtual void read_model_inline(
                 const tl::request& req,
                 const std::string& client_addr,
                 const std::string& model_name,
                 const std::string& model_signature,
-                const tl::bulk& remote_bulk,
                 const std::size_t& size) override;
 
-        virtual void read_model(
+        virtual void write_model_batch(
                 const tl::request& req,
                 const std::string& client_addr,
-                const std::string& model_name,
-                const std::string& model_signature,
+                const std::vector<batch_entry>& entries,
                 const tl::bulk& remote_bulk,
-                const std::size_t& size) override;
+                bool atomic) override;
+
+        virtual void read_model_batch(
+                const tl::request& req,
+                const std::string& client_addr,
+                const std::vector<batch_entry>& entries,
+                const tl::bulk& remote_bulk) override;
+
+        virtual void list_models(
+                const tl::request& req,
+                const list_query& query) override;
+
+        virtual void set_model_tags(
+                const tl::request& req,
+                const std::string& model_name,
+                const std::map<std::string, std::string>& tags) override;
 
         virtual void duplicate_model(
                 const tl::request& req,
                 const std::string& model_name,
                 const std::string& new_model_name) override;
 
+        virtual void duplicate_many(
+                const tl::request& req,
+                const std::string& model_name,
+                const std::vector<std::string>& new_model_names) override;
+
+        virtual void flush(
+                const tl::request& req) override;
+
+        virtual void drain_worker(
+                const tl::request& req,
+                const std::string& worker_addr) override;
+
+        virtual void get_stats(
+                const tl::request& req) override;
+
+        virtual void on_storage_report(
+                const storage_report& report) override;
+
         virtual void on_shutdown() override;
 
         virtual void on_worker_joined(
                 uint64_t member_id,
                 hg_addr_t addr) override;
 
+        virtual void on_workers_joined(
+                const std::vector<std::pair<uint64_t, hg_addr_t>>& workers) override;
+
         virtual void on_worker_left(
                 uint64_t member_id) override;
 
@@ -158,19 +3399,112 @@ class MochiBackend : public AbstractServerBackend {
 
 REGISTER_FLAMESTORE_BACKEND("mochi",MochiBackend);
 
+void MochiBackend::get_stats(const tl::request& req)
+{
+    std::map<std::string, uint64_t> stats;
+    if(m_read_cache) {
+        auto c = m_read_cache->get_stats();
+        stats["read_cache.hits"]       = c.m_hits;
+        stats["read_cache.misses"]     = c.m_misses;
+        stats["read_cache.admissions"] = c.m_admissions;
+        stats["read_cache.rejections"] = c.m_rejections;
+        stats["read_cache.evictions"]  = c.m_evictions;
+        stats["read_cache.entries"]    = c.m_entries;
+        stats["read_cache.bytes"]      = c.m_bytes;
+    }
+    std::size_t strings = 0, string_bytes = 0;
+    m_strings->stats(strings, string_bytes);
+    stats["strings.entries"] = strings;
+    stats["strings.bytes"]   = string_bytes;
+    stats["writes.superseded"] = m_superseded_writes;
+    for(const auto& l : *_locations()) {
+        auto prefix = "storage." + l->m_key + ".";
+        stats[prefix + "allocated"] = l->m_allocated;
+        stats[prefix + "inflight"]  = l->m_inflight;
+        stats[prefix + "master.operations"] = l->m_operations;
+        stats[prefix + "master.latency_us"] = l->m_latency_us;
+        stats[prefix + "master.completed"]  = l->m_completed;
+        if(auto report = _report_of(*l)) {
+            stats[prefix + "device_free"] = report->m_stats.m_device_free;
+            stats[prefix + "queue_depth"] = report->m_stats.m_queue_depth;
+            stats[prefix + "latency_us"]  = report->m_stats.m_latency_us;
+            stats[prefix + "operations"]  = report->m_stats.m_operations;
+            stats[prefix + "pending"]     = report->m_pending;
+        }
+    }
+    req.respond(stats);
+}
+
+void MochiBackend::on_storage_report(const storage_report& report)
+{
+    auto now = std::chrono::steady_clock::now();
+    bool resized = false;
+    for(const auto& l : *_locations()) {
+        if((std::string)l->m_endpoint != report.m_addr) continue;
+        if(l->m_target_index >= report.m_targets.size()) continue;
+        auto r = std::make_shared<location_report>();
+        r->m_stats   = report.m_targets[l->m_target_index];
+        r->m_pending = report.m_pending;
+        r->m_time    = now;
+        // the capacity changes if the target is resized or was unknown at join
+        if(r->m_stats.m_capacity != 0 && r->m_stats.m_capacity != l->m_capacity) {
+            l->m_capacity = r->m_stats.m_capacity;
+            resized = true;
+        }
+        std::atomic_store(&l->m_report, std::shared_ptr<const location_report>(std::move(r)));
+    }
+    // the load of the targets is relative to their capacity
+    if(resized)
+        _request_rebalance();
+}
+
 void MochiBackend::on_shutdown()
 {
+    {
+        std::unique_lock<tl::mutex> lock(m_rebalance_mutex);
+        m_shutting_down = true;
+        m_rebalance_cv.notify_one();
+    }
+    if(m_rebalance) {
+        m_logger->debug("Waiting for the rebalancer to stop");
+        m_rebalancer->join();
+    }
+    if(m_burst_buffer_size != 0) {
+        m_logger->debug("Waiting for staged writes to drain");
+        std::string error;
+        if(_wait_for_drain(error))
+            m_logger->error("Some staged writes failed, last error: {}", error);
+    }
+    {
+        m_logger->debug("Waiting for model copies to complete");
+        std::vector<model_t*> models;
+        m_models_rwlock.rdlock();
+        for(const auto& p : m_models)
+            models.push_back(p.second.get());
+        m_models_rwlock.unlock();
+        for(auto model : models) {
+            lock_guard_t guard(model->m_mutex);
+            _finish_copy(model);
+        }
+    }
+    if(m_read_cache) {
+        auto c = m_read_cache->get_stats();
+        auto lookups = c.m_hits + c.m_misses;
+        m_logger->info("Read cache: {} hits out of {} lookups ({:.1f}%), {} admissions, {} evictions",
+                c.m_hits, lookups, lookups ? 100.0*c.m_hits/lookups : 0.0,
+                c.m_admissions, c.m_evictions);
+    }
+    if(m_catalog) {
+        m_logger->debug("Flushing the catalog");
+        m_catalog->stop();
+    }
     m_logger->debug("Asking all storage servers to shut down");
-    m_storage_locations_lock.wrlock();
-    for(auto& l : m_storage_locations) {
+    for(auto& l : *_locations()) {
         auto& ep = l->m_endpoint;
         m_engine->shutdown_remote_engine(ep);
     }
-    m_storage_locations_lock.unlock();
     while(true){
-        m_storage_locations_lock.rdlock();
-        auto x = m_storage_locations.size();
-        m_storage_locations_lock.unlock();
+        auto x = _locations()->size();
         if(x == 0)
             break;
         else
@@ -185,47 +3519,118 @@ void MochiBackend::on_shutdown()
 
 void MochiBackend::on_worker_joined(uint64_t member_id, hg_addr_t addr)
 {
-    tl::endpoint worker_ep(*m_engine, addr, false);
-    m_logger->info("Mochi backend received new worker at address {}", (std::string)worker_ep);
-
-    // query the new storage server for its Bake target(s)
-    m_logger->debug("Querying new storage server for storage targets...");
-    bake::provider_handle ph(m_bake_client, addr);
-    std::vector<bake::target> targets = m_bake_client.probe(ph);
-    m_logger->info("New storage server has {} target(s)", targets.size());
-
-    for(auto& tgt : targets) {
-        auto l = std::make_shared<location>();
-        l->m_endpoint = worker_ep;
-        l->m_ssg_member_id = member_id;
-        l->m_phandle = bake::provider_handle(m_bake_client, addr);
-        l->m_target = tgt;
-        m_storage_locations.push_back(std::move(l));
-    }
+    on_workers_joined({ { member_id, addr } });
+}
+
+void MochiBackend::on_workers_joined(const std::vector<std::pair<uint64_t, hg_addr_t>>& workers)
+{
+    m_logger->info("Mochi backend received {} new worker(s)", workers.size());
+
+    // query the new storage servers for their Bake target(s) and
+    // the capacity of these targets, all the servers in parallel
+    std::vector<std::vector<std::shared_ptr<location>>> per_worker(workers.size());
+    std::string error;
+    _parallel_for(workers.size(), [&](std::size_t w) {
+        auto member_id = workers[w].first;
+        auto addr      = workers[w].second;
+        tl::endpoint worker_ep(*m_engine, addr, false);
+        std::vector<bake::target> targets;
+        try {
+            bake::provider_handle ph(m_bake_client, addr);
+            targets = m_bake_client.probe(ph);
+        } catch(const std::exception& ex) {
+            m_logger->error("Could not probe storage server {}: {}", (std::string)worker_ep, ex.what());
+            return;
+        }
+        m_logger->info("Storage server {} has {} target(s)", (std::string)worker_ep, targets.size());
+
+        std::vector<target_stats> stats;
+        try {
+            stats = m_rpc_storage_stats.on(worker_ep)().as<std::vector<target_stats>>();
+        } catch(const tl::exception& ex) {
+            m_logger->warn("Could not get statistics from storage server: {}", ex.what());
+        }
+
+        for(std::size_t i = 0; i < targets.size(); i++) {
+            auto l = std::make_shared<location>();
+            l->m_endpoint = worker_ep;
+            l->m_ssg_member_id = member_id;
+            l->m_phandle = bake::provider_handle(m_bake_client, addr);
+            l->m_target = targets[i];
+            l->m_key = (std::string)worker_ep + "/" + std::to_string(i);
+            l->m_target_id = Catalog::encode_raw(targets[i]);
+            l->m_target_index = i;
+            if(i < stats.size())
+                l->m_capacity = stats[i].m_capacity;
+            per_worker[w].push_back(std::move(l));
+        }
+    }, error);
+
+    // all the new locations are published at once
+    std::vector<std::shared_ptr<location>> new_locations;
+    for(auto& locs : per_worker)
+        std::move(locs.begin(), locs.end(), std::back_inserter(new_locations));
+    if(new_locations.empty()) return;
+    _update_locations([&new_locations](location_table& table) {
+        table.insert(table.end(), new_locations.begin(), new_locations.end());
+    });
+    _bind_replicas(new_locations);
+    _request_rebalance();
 }
 
 void MochiBackend::on_worker_left(uint64_t member_id)
 {
-    m_storage_locations.erase(
-        std::remove_if( std::begin(m_storage_locations),
-                        std::end(m_storage_locations),
-                        [member_id](const std::shared_ptr<location>& l) {
-                            return l->m_ssg_member_id == member_id;
-                        }),
-        std::end(m_storage_locations)
-    );
+    _evacuate(member_id, true);
 }
 
 void MochiBackend::on_worker_died(uint64_t member_id)
 {
-    m_storage_locations.erase(
-        std::remove_if( std::begin(m_storage_locations),
-                        std::end(m_storage_locations),
-                        [member_id](const std::shared_ptr<location>& l) {
-                            return l->m_ssg_member_id == member_id;
-                        }),
-        std::end(m_storage_locations)
-    );
+    _evacuate(member_id, false);
+}
+
+void MochiBackend::flush(const tl::request& req)
+{
+    m_logger->debug("Waiting for staged writes to drain");
+    std::string error;
+    auto failures = _wait_for_drain(error);
+    if(failures) {
+        m_logger->error("{} staged write(s) failed, last error: {}", failures, error);
+        req.respond(Status(FLAMESTORE_EBAKE,
+                    std::to_string(failures) + " staged write(s) failed: " + error));
+        return;
+    }
+    req.respond(Status::OK());
+}
+
+void MochiBackend::drain_worker(const tl::request& req, const std::string& worker_addr)
+{
+    if(m_shutting_down) {
+        // the whole service is going down, nothing to preserve
+        req.respond(Status::OK());
+        return;
+    }
+    std::vector<std::shared_ptr<location>> draining;
+    for(const auto& l : *_locations()) {
+        if((std::string)l->m_endpoint != worker_addr) continue;
+        l->m_draining = true;
+        draining.push_back(l);
+    }
+    if(draining.empty()) {
+        m_logger->error("Storage server {} is not known to the mochi backend", worker_addr);
+        req.respond(Status(FLAMESTORE_ENOEXISTS, "Unknown storage server"));
+        return;
+    }
+    m_logger->info("Draining storage server {}", worker_addr);
+    // the storage server is waiting to leave
+    std::size_t stuck;
+    auto moved = _drain_locations(draining, true, stuck);
+    if(stuck) {
+        m_logger->error("{} replica(s) could not be moved off storage server {}", stuck, worker_addr);
+        req.respond(Status(FLAMESTORE_ENOSPACE, "Some replicas could not be moved"));
+        return;
+    }
+    m_logger->info("Storage server {} drained ({} bytes moved)", worker_addr, moved);
+    req.respond(Status::OK());
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -240,47 +3645,32 @@ void MochiBackend::register_model(
         std::size_t& model_size,
         const std::string& model_signature)
 {
-    bool created = false;
     m_logger->info("Entering MochiBackend::register_model");
-    auto model = _find_or_create_model(model_name, created);
-    if(not created) {
-        m_logger->error("Model \"{}\" already exists", model_name);
-        req.respond(Status(
-                    FLAMESTORE_EEXISTS,
-                    "A model with the same name is already registered"));
-        m_logger->trace("Leaving flamestore_provider::on_register_model");
-        return;
-    }
-    m_logger->info("Model \"{}\" created", model_name);
-
-    lock_guard_t guard(model->m_mutex);
-
-    m_logger->info("Registering model \"{}\"", model_name);
-
-    model->m_model_config    = std::move(model_config);
-    model->m_model_signature = std::move(model_signature);
-    model->m_impl.m_size     = model_size;
-
-    // select a location for the model
-    auto i = std::rand() % m_storage_locations.size();
-    m_logger->debug("Selecting storage target {}/{}", i+1, m_storage_locations.size());
-    auto loc = m_storage_locations[i];
-    model->m_impl.m_location = loc;
+    req.respond(_register(model_name, model_config, model_size, model_signature));
+}
 
-    // allocate a region with the right size in Bake
-    try {
-        m_logger->debug("Creating bake region of size {}", model_size);
-        auto region = m_bake_client.create(loc->m_phandle, loc->m_target, model_size);
-        m_logger->debug("Region successfuly created");
-        model->m_impl.m_region = region;
-    } catch(const bake::exception& ex) {
-        // TODO remove the model from the database since it wasn't properly created
-        m_logger->error("Bake region creation failed: {}", ex.what());
-        req.respond(Status(FLAMESTORE_EBAKE, "Bake region creation failed"));
+void MochiBackend::register_and_write_model(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::string& model_name,
+        const std::string& model_config,
+        std::size_t& model_size,
+        const std::string& model_signature,
+        const tl::bulk& remote_bulk,
+        const std::vector<char>& data)
+{
+    m_logger->info("Entering MochiBackend::register_and_write_model");
+    auto status = _register(model_name, model_config, model_size, model_signature);
+    if(status.m_code != FLAMESTORE_OK) {
+        req.respond(status);
         return;
     }
-
-    req.respond(Status::OK());
+    // the write goes through the same path as a separate write
+    // (burst buffer, staged versions), and responds to the request
+    if(!data.empty())
+        write_model_inline(req, client_addr, model_name, model_signature, data);
+    else
+        write_model(req, client_addr, model_name, model_signature, remote_bulk, model_size);
 }
 
 void MochiBackend::reload_model(
@@ -301,6 +3691,95 @@ void MochiBackend::reload_model(
     req.respond(Status::OK(model->m_model_config));
 }
 
+void MochiBackend::reload_model_data(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::string& model_name,
+        const tl::bulk& remote_bulk,
+        const std::size_t& capacity,
+        const tl::bulk& config_bulk,
+        const std::size_t& config_capacity,
+        const std::size_t& max_inline)
+{
+    reload_result result;
+    auto model = _find_model(model_name);
+    if(model == nullptr) {
+        m_logger->error("Model \"{}\" does not exist", model_name);
+        result.m_status = Status(
+                    FLAMESTORE_ENOEXISTS,
+                    "No model found with provided name");
+        req.respond(result);
+        return;
+    }
+    m_logger->info("Getting model config and data for model \"{}\"", model_name);
+    lock_guard_t guard(model->m_mutex);
+    result.m_status    = Status::OK();
+    result.m_signature = model->m_model_signature;
+    result.m_size      = model->m_impl.m_size;
+    try {
+        _attach_config(result, model->m_model_config, *m_engine, req, config_bulk, config_capacity, max_inline);
+    } catch(const tl::exception& ex) {
+        m_logger->error("Failed to push config of model \"{}\": {}", model_name, ex.what());
+        result.m_status = Status(FLAMESTORE_EIO, "Failed to push model config");
+        req.respond(result);
+        return;
+    }
+    // a model that was registered but never written has no data to send
+    if(model->m_impl.m_version == 0 && !model->m_impl.latest_staged()) {
+        req.respond(result);
+        return;
+    }
+    Status status;
+    if(result.m_size <= max_inline) {
+        status = _read_inline(model, result.m_size, result.m_data);
+        if(status.m_code == FLAMESTORE_OK)
+            result.m_transfer = reload_result::INLINE;
+    } else if(!remote_bulk.is_null() && result.m_size <= capacity) {
+        status = _push_to(model, client_addr, req.get_endpoint(), remote_bulk, result.m_size);
+        if(status.m_code == FLAMESTORE_OK)
+            result.m_transfer = reload_result::BULK;
+    }
+    // the config is still returned, the client then reads the data separately
+    if(status.m_code != FLAMESTORE_OK)
+        m_logger->warn("Could not send data of model \"{}\" with its config: {}",
+                model_name, status.m_message);
+    result.m_data.resize(result.m_transfer == reload_result::INLINE ? result.m_size : 0);
+    req.respond(result);
+}
+
+void MochiBackend::get_model_info(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::string& model_name,
+        const tl::bulk& remote_bulk,
+        const std::size_t& capacity,
+        const std::size_t& max_inline)
+{
+    model_info info;
+    auto model = _find_model(model_name);
+    if(model == nullptr) {
+        m_logger->error("Model \"{}\" does not exist", model_name);
+        info.m_status = Status(
+                    FLAMESTORE_ENOEXISTS,
+                    "No model found with provided name");
+        req.respond(info);
+        return;
+    }
+    lock_guard_t guard(model->m_mutex);
+    info.m_status    = Status::OK();
+    info.m_signature = model->m_model_signature;
+    info.m_size      = model->m_impl.m_size;
+    // includes the versions acknowledged but still in the burst buffer
+    info.m_version   = model->m_impl.m_writes;
+    try {
+        _attach_config(info, model->m_model_config, *m_engine, req, remote_bulk, capacity, max_inline);
+    } catch(const tl::exception& ex) {
+        m_logger->error("Failed to push config of model \"{}\": {}", model_name, ex.what());
+        info.m_status = Status(FLAMESTORE_EIO, "Failed to push model config");
+    }
+    req.respond(info);
+}
+
 void MochiBackend::write_model(
         const tl::request& req,
         const std::string& client_addr,
@@ -318,44 +3797,90 @@ void MochiBackend::write_model(
         m_logger->trace("Leaving write_model");
         return;
     }
-    m_logger->info("Pulling data from model \"{}\"", model_name);
-    lock_guard_t guard(model->m_mutex);
-    if(model->m_model_signature != model_signature) {
-        m_logger->error("Unmatching signatures when writing model \"{}\"", model_name);
-        req.respond(Status(
-                    FLAMESTORE_ESIGNATURE,
-                    "Unmatching signatures"));
-        m_logger->trace("Leaving write_model");
+    auto model_size = _size_of(model);
+    if(size != model_size) {
+        m_logger->error("Size {} does not match the size {} of model \"{}\"",
+                size, model_size, model_name);
+        req.respond(Status(FLAMESTORE_EINVAL, "Data size does not match the model's size"));
         return;
     }
-    m_logger->debug("Proxy-writing model {}", model_name);
-    auto loc = model->m_impl.m_location.lock();
-    // TODO check validity of loc
-    try {
-        m_bake_client.write(loc->m_phandle,
-                        loc->m_target,
-                        model->m_impl.m_region,
-                        0,
-                        remote_bulk.get_bulk(),
-                        0,
-                        client_addr,
-                        size);
-    } catch(const bake::exception& ex) {
-        m_logger->error("Failed to write in Bake: {}", ex.what());
-        req.respond(Status(FLAMESTORE_EBAKE, "Failed to write in Bake"));
+    // a write overtaken by a newer write of the same model does not
+    // transfer its data: it waits for the outcome of the newer write,
+    // and is retried if the latter fails (see pending_writes)
+    pending_writes::guard pending(model->m_pending_writes, model_signature);
+    bool buffered = m_burst_buffer_size != 0 && size <= m_burst_buffer_size;
+    for(;;) {
+        // in burst-buffer mode, the data is pulled into the master's memory
+        // before locking the model (space is reserved first, so that a full
+        // buffer slows down the clients instead of exhausting memory), and
+        // the write is admitted by the scheduler just before the pull
+        std::shared_ptr<staged_write> staged;
+        Scheduler::ticket admission;
+        uint64_t seq = 0;
+        if(buffered) {
+            seq = _reserve_burst_buffer(size);
+            auto decision = pending.check();
+            if(decision != pending_writes::PROCEED) {
+                _release_burst_buffer(size, seq);
+                if(_hold_write(pending, decision, req, model_name)) continue;
+                return;
+            }
+            admission = _admit_checkpoint(m_scheduler, req, size);
+            staged = std::make_shared<staged_write>();
+            staged->m_burst_seq = seq;
+            try {
+                staged->m_bulk = _expose_staging(staged->m_data, size);
+                if(size != 0)
+                    staged->m_bulk(0, size) << remote_bulk.on(req.get_endpoint()).select(0, size);
+            } catch(const tl::exception& ex) {
+                m_logger->error("Failed to pull data of model \"{}\": {}", model_name, ex.what());
+                _release_burst_buffer(size, seq);
+                req.respond(Status(FLAMESTORE_EIO, "Failed to pull model data"));
+                return;
+            }
+        }
+        m_logger->info("Pulling data from model \"{}\"", model_name);
+        std::unique_lock<tl::mutex> lock(model->m_mutex);
+        if(model->m_model_signature != model_signature) {
+            m_logger->error("Unmatching signatures when writing model \"{}\"", model_name);
+            if(staged) _release_burst_buffer(size, seq);
+            req.respond(Status(
+                        FLAMESTORE_ESIGNATURE,
+                        "Unmatching signatures"));
+            m_logger->trace("Leaving write_model");
+            return;
+        }
+        // otherwise the write is admitted once known to proceed
+        auto decision = pending.check();
+        if(decision == pending_writes::PROCEED && !staged) {
+            bool waited;
+            admission = _admit_checkpoint(m_scheduler, req, size, lock, waited);
+            if(waited) decision = pending.check();
+        }
+        if(decision != pending_writes::PROCEED) {
+            if(staged) _release_burst_buffer(size, seq);
+            lock.unlock();
+            admission = Scheduler::ticket();
+            if(_hold_write(pending, decision, req, model_name)) continue;
+            return;
+        }
+        if(staged) {
+            m_logger->debug("Staging model {} in burst buffer", model_name);
+            auto status = _acknowledge(model, _write_local(model, std::move(staged), true));
+            pending.complete(status.m_code == FLAMESTORE_OK);
+            req.respond(status);
+            return;
+        }
+        // versions staged earlier must reach Bake first
+        while(!model->m_impl.m_staged.empty())
+            _drain_one(model);
+        m_logger->debug("Proxy-writing model {}", model_name);
+        auto status = _acknowledge(model,
+                _write_version(model, remote_bulk, client_addr, req.get_endpoint(), size));
+        pending.complete(status.m_code == FLAMESTORE_OK);
+        req.respond(status);
         return;
     }
-    // persisting data
-    try {
-        m_bake_client.persist(loc->m_phandle,
-                            loc->m_target,
-                            model->m_impl.m_region,
-                            0,
-                            size);
-    } catch(const bake::exception& ex) {
-        
-    }
-    req.respond(Status::OK());
 }
 
 void MochiBackend::read_model(
@@ -385,22 +3910,298 @@ void MochiBackend::read_model(
         return;
     }
     m_logger->info("Pushing data to model \"{}\"", model_name);
-    auto loc = model->m_impl.m_location.lock();
-    // TODO check validity of loc
-    try {
-        m_bake_client.read(loc->m_phandle,
-                        loc->m_target,
-                        model->m_impl.m_region,
-                        0,
-                        remote_bulk.get_bulk(),
-                        0,
-                        client_addr,
-                        size);
-    } catch(const bake::exception& ex) {
-        m_logger->error("Failed to read from Bake: {}", ex.what());
-        req.respond(Status(FLAMESTORE_EBAKE, "Failed to read from Bake"));
+    req.respond(_push_to(model, client_addr, req.get_endpoint(), remote_bulk, size));
+}
+
+void MochiBackend::write_model_inline(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::string& model_name,
+        const std::string& model_signature,
+        const std::vector<char>& data)
+{
+    auto model = _find_model(model_name);
+    if(model == nullptr) {
+        m_logger->error("Model \"{}\" does not exist", model_name);
+        req.respond(Status(
+                    FLAMESTORE_ENOEXISTS,
+                    "No model found with provided name"));
+        return;
+    }
+    auto size = _size_of(model);
+    if(data.size() != size) {
+        m_logger->error("Size {} does not match the size {} of model \"{}\"",
+                data.size(), size, model_name);
+        req.respond(Status(FLAMESTORE_EINVAL, "Data size does not match the model's size"));
+        return;
+    }
+    pending_writes::guard pending(model->m_pending_writes, model_signature);
+    bool buffered = m_burst_buffer_size != 0 && size <= m_burst_buffer_size;
+    for(;;) {
+        // the data is already in the master's memory, it is copied into a
+        // buffer of the size of the model, exposed so that Bake can pull from it
+        auto staged = std::make_shared<staged_write>();
+        Scheduler::ticket admission;
+        if(buffered) {
+            staged->m_burst_seq = _reserve_burst_buffer(size);
+            admission = _admit_checkpoint(m_scheduler, req, size);
+        }
+        try {
+            staged->m_bulk = _expose_staging(staged->m_data, size);
+        } catch(const tl::exception& ex) {
+            m_logger->error("Failed to expose data of model \"{}\": {}", model_name, ex.what());
+            if(buffered) _release_burst_buffer(size, staged->m_burst_seq);
+            req.respond(Status(FLAMESTORE_EIO, "Failed to expose model data"));
+            return;
+        }
+        std::copy(data.begin(), data.end(), staged->m_data.begin());
+        std::unique_lock<tl::mutex> lock(model->m_mutex);
+        if(model->m_model_signature != model_signature) {
+            m_logger->error("Unmatching signatures when writing model \"{}\"", model_name);
+            if(buffered) _release_burst_buffer(size, staged->m_burst_seq);
+            req.respond(Status(
+                        FLAMESTORE_ESIGNATURE,
+                        "Unmatching signatures"));
+            return;
+        }
+        auto decision = pending.check();
+        if(decision == pending_writes::PROCEED && !buffered) {
+            bool waited;
+            admission = _admit_checkpoint(m_scheduler, req, size, lock, waited);
+            if(waited) decision = pending.check();
+        }
+        if(decision != pending_writes::PROCEED) {
+            if(buffered) _release_burst_buffer(size, staged->m_burst_seq);
+            lock.unlock();
+            admission = Scheduler::ticket();
+            if(_hold_write(pending, decision, req, model_name)) continue;
+            return;
+        }
+        m_logger->debug("{} inline data of model {}", buffered ? "Staging" : "Writing", model_name);
+        auto status = _acknowledge(model, _write_local(model, std::move(staged), buffered));
+        pending.complete(status.m_code == FLAMESTORE_OK);
+        req.respond(status);
+        return;
+    }
+}
+
+void MochiBackend::read_model_inline(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::string& model_name,
+        const std::string& model_signature,
+        const std::size_t& size)
+{
+    auto model = _find_model(model_name);
+    if(model == nullptr) {
+        m_logger->error("Model \"{}\" does not exist", model_name);
+        req.respond(std::make_pair(Status(
+                    FLAMESTORE_ENOEXISTS,
+                    "No model found with provided name"), std::vector<char>()));
+        return;
+    }
+    lock_guard_t guard(model->m_mutex);
+    if(model->m_model_signature != model_signature) {
+        m_logger->error("Unmatching signatures when reading model \"{}\"", model_name);
+        req.respond(std::make_pair(Status(
+                    FLAMESTORE_ESIGNATURE,
+                    "Unmatching signatures"), std::vector<char>()));
+        return;
+    }
+    m_logger->info("Sending inline data of model \"{}\"", model_name);
+    std::vector<char> data;
+    auto status = _read_inline(model, size, data);
+    if(status.m_code != FLAMESTORE_OK)
+        data.clear();
+    req.respond(std::make_pair(std::move(status), std::move(data)));
+}
+
+void MochiBackend::write_model_batch(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::vector<batch_entry>& entries,
+        const tl::bulk& remote_bulk,
+        bool atomic)
+{
+    m_logger->info("Writing a batch of {} models", entries.size());
+    auto ep = req.get_endpoint();
+    auto n = entries.size();
+    std::vector<Status> statuses(n, Status::OK());
+    std::vector<model_t*> models(n, nullptr);
+    std::vector<std::size_t> sizes(n, 0);
+    bool failed = false;
+    for(std::size_t i = 0; i < n; i++) {
+        models[i] = _find_model(entries[i].m_name);
+        if(models[i] == nullptr) {
+            m_logger->error("Model \"{}\" does not exist", entries[i].m_name);
+            statuses[i] = Status(FLAMESTORE_ENOEXISTS, "No model found with provided name");
+            failed = true;
+        } else if(entries[i].m_size != (sizes[i] = _size_of(models[i]))) {
+            // checked before any data is pulled, which would otherwise
+            // be padded or truncated to the model's size
+            m_logger->error("Size {} does not match the size {} of model \"{}\"",
+                    entries[i].m_size, sizes[i], entries[i].m_name);
+            statuses[i] = Status(FLAMESTORE_EINVAL, "Data size does not match the model's size");
+            models[i] = nullptr;
+            failed = true;
+        }
+    }
+    std::string error;
+    if(!atomic) {
+        // each model is written independently, as a write_model would:
+        // buffered models are staged in the master's memory, the others
+        // go from the client's memory to Bake
+        _parallel_for(n, [&](std::size_t i) {
+            auto model = models[i];
+            if(!model) return;
+            auto size = sizes[i];
+            bool buffered = m_burst_buffer_size != 0 && size <= m_burst_buffer_size;
+            uint64_t seq = buffered ? _reserve_burst_buffer(size) : 0;
+            auto admission = _admit_checkpoint(m_scheduler, req, entries[i].m_size);
+            std::shared_ptr<staged_write> staged;
+            Status status = Status::OK();
+            if(buffered) {
+                status = _pull_staged(ep, remote_bulk, entries[i].m_offset,
+                                      entries[i].m_size, size, staged);
+                if(staged) staged->m_burst_seq = seq;
+            }
+            if(status.m_code == FLAMESTORE_OK) {
+                lock_guard_t guard(model->m_mutex);
+                if(model->m_model_signature != entries[i].m_signature) {
+                    m_logger->error("Unmatching signatures when writing model \"{}\"", model->m_name);
+                    status = Status(FLAMESTORE_ESIGNATURE, "Unmatching signatures");
+                } else if(buffered) {
+                    status = _acknowledge(model, _write_local(model, std::move(staged), true));
+                } else {
+                    while(!model->m_impl.m_staged.empty())
+                        _drain_one(model);
+                    status = _acknowledge(model, _write_version(model, remote_bulk, client_addr, ep,
+                                            entries[i].m_size, entries[i].m_offset));
+                }
+            }
+            if(buffered && status.m_code != FLAMESTORE_OK)
+                _release_burst_buffer(size, seq);
+            statuses[i] = std::move(status);
+        }, error);
+        req.respond(statuses);
+        return;
+    }
+    // all-or-nothing: every model is written to its shadow regions
+    // before any commit record is flipped; locks are taken in name
+    // order so that concurrent batches cannot deadlock
+    std::map<std::string, model_t*> sorted;
+    for(std::size_t i = 0; i < n; i++) {
+        if(models[i] && !sorted.emplace(entries[i].m_name, models[i]).second) {
+            statuses[i] = Status(FLAMESTORE_EOTHER, "Model appears twice in the batch");
+            failed = true;
+        }
+    }
+    // admitted as a whole before locking the models, since they cannot
+    // all be unlocked while the batch is queued
+    Scheduler::ticket admission;
+    if(!failed) admission = _admit_checkpoint(m_scheduler, req, batch_bytes(entries));
+    std::vector<std::unique_lock<tl::mutex>> locks;
+    for(auto& m : sorted)
+        locks.emplace_back(m.second->m_mutex);
+    for(std::size_t i = 0; i < n; i++) {
+        if(statuses[i].m_code != FLAMESTORE_OK) failed = true;
+        else if(models[i]->m_model_signature != entries[i].m_signature) {
+            m_logger->error("Unmatching signatures when writing model \"{}\"", models[i]->m_name);
+            statuses[i] = Status(FLAMESTORE_ESIGNATURE, "Unmatching signatures");
+            failed = true;
+        }
+    }
+    std::vector<std::vector<char>> written(n);
+    if(!failed) {
+        for(auto model : models)
+            while(!model->m_impl.m_staged.empty())
+                _drain_one(model);
+        _parallel_for(n, [&](std::size_t i) {
+            statuses[i] = _write_shadow(models[i], remote_bulk, client_addr, ep,
+                                        entries[i].m_size, written[i], entries[i].m_offset);
+        }, error);
+        for(auto& status : statuses)
+            if(status.m_code != FLAMESTORE_OK) failed = true;
+    }
+    if(failed) {
+        m_logger->error("Aborting batch of {} models", n);
+        for(auto& status : statuses)
+            if(status.m_code == FLAMESTORE_OK)
+                status = Status(FLAMESTORE_EOTHER, "Batch aborted");
+        req.respond(statuses);
+        return;
+    }
+    // a failure here leaves the models committed so far at their
+    // new version, the others at their previous one
+    for(std::size_t i = 0; i < n; i++)
+        statuses[i] = _acknowledge(models[i], _commit_shadow(models[i], written[i]));
+    req.respond(statuses);
+}
+
+void MochiBackend::read_model_batch(
+        const tl::request& req,
+        const std::string& client_addr,
+        const std::vector<batch_entry>& entries,
+        const tl::bulk& remote_bulk)
+{
+    m_logger->info("Reading a batch of {} models", entries.size());
+    auto ep = req.get_endpoint();
+    std::vector<Status> statuses(entries.size(), Status::OK());
+    std::string error;
+    _parallel_for(entries.size(), [&](std::size_t i) {
+        const auto& entry = entries[i];
+        auto model = _find_model(entry.m_name);
+        if(model == nullptr) {
+            m_logger->error("Model \"{}\" does not exist", entry.m_name);
+            statuses[i] = Status(FLAMESTORE_ENOEXISTS, "No model found with provided name");
+            return;
+        }
+        lock_guard_t guard(model->m_mutex);
+        if(model->m_model_signature != entry.m_signature) {
+            m_logger->error("Unmatching signatures when reading model \"{}\"", entry.m_name);
+            statuses[i] = Status(FLAMESTORE_ESIGNATURE, "Unmatching signatures");
+            return;
+        }
+        // the data goes straight to the entry's offset of the client's
+        // bulk handle, which must not spill over the next entry
+        if(entry.m_size != model->m_impl.m_size) {
+            m_logger->error("Size {} does not match the size {} of model \"{}\"",
+                    entry.m_size, model->m_impl.m_size, entry.m_name);
+            statuses[i] = Status(FLAMESTORE_EINVAL, "Data size does not match the model's size");
+            return;
+        }
+        statuses[i] = _push_to(model, client_addr, ep, remote_bulk, entry.m_size, entry.m_offset);
+    }, error);
+    req.respond(statuses);
+}
+
+void MochiBackend::list_models(
+        const tl::request& req,
+        const list_query& query)
+{
+    m_logger->info("Entering MochiBackend::list_models");
+    auto page = _list_page(m_models, m_models_rwlock, query,
+            [](const model_t& model) { return model.m_impl.m_size; });
+    req.respond(page);
+}
+
+void MochiBackend::set_model_tags(
+        const tl::request& req,
+        const std::string& model_name,
+        const std::map<std::string, std::string>& tags)
+{
+    m_logger->info("Entering MochiBackend::set_model_tags");
+    auto model = _find_model(model_name);
+    if(model == nullptr) {
+        m_logger->error("Model \"{}\" does not exist", model_name);
+        req.respond(Status(
+                    FLAMESTORE_ENOEXISTS,
+                    "No model found with provided name"));
         return;
     }
+    lock_guard_t guard(model->m_mutex);
+    model->m_tags = tags;
+    _record(model);
     req.respond(Status::OK());
 }
 
@@ -418,6 +4219,11 @@ void MochiBackend::duplicate_model(
                     "No model found with provided name"));
         return;
     }
+    auto status = _check_name(new_model_name);
+    if(status.m_code != FLAMESTORE_OK) {
+        req.respond(status);
+        return;
+    }
     bool created = false;
     auto new_model = _find_or_create_model(new_model_name, created);
     if(not created) {
@@ -429,41 +4235,72 @@ void MochiBackend::duplicate_model(
         return;
     }
     
-    new_model->m_model_config    = model->m_model_config;
-    new_model->m_model_signature = model->m_model_signature;
-    new_model->m_impl.m_size     = model->m_impl.m_size;
-
-    // find out where the source model is
-    auto loc = model->m_impl.m_location.lock();
-
-    // select a location for the model
-    auto i = std::rand() % m_storage_locations.size();
-    m_logger->debug("Selecting storage target {}/{}", i+1, m_storage_locations.size());
-    auto new_loc = m_storage_locations[i];
-    new_model->m_impl.m_location = loc;
+    lock_guard_t guard(model->m_mutex);
+    lock_guard_t guard2(new_model->m_mutex);
+    // duplicate the latest version, even if it is still in the burst buffer
+    // or still being copied from another model
+    while(!model->m_impl.m_staged.empty())
+        _drain_one(model);
+    _finish_copy(model);
+    std::vector<copy_task> tasks;
+    status = _prepare_copy(model, new_model, m_duplicate_locality, tasks);
+    _start_copy(std::move(tasks));
+    if(status.m_code == FLAMESTORE_OK)
+        status = _sync_catalog();
+    req.respond(status);
+}
 
-    // allocate a region with the right size in Bake for the new model
-    try {
-        m_logger->debug("Creating bake region of size {} by migrating existing region", new_model->m_impl.m_size);
-        std::string new_addr = tl::endpoint(*m_engine, new_loc->m_phandle.address());
-        auto region = m_bake_client.migrate(loc->m_phandle,
-                                            loc->m_target,
-                                            model->m_impl.m_region,
-                                            model->m_impl.m_size,
-                                            false,
-                                            new_addr,
-                                            new_loc->m_phandle.provider_id(),
-                                            new_loc->m_target);
-        m_logger->debug("Region successfuly created");
-        new_model->m_impl.m_region = region;
-    } catch(const bake::exception& ex) {
-        // TODO remove the model from the database since it wasn't properly created
-        m_logger->error("Bake region creation failed: {}", ex.what());
-        req.respond(Status(FLAMESTORE_EBAKE, "Bake region migration failed"));
+void MochiBackend::duplicate_many(
+        const tl::request& req,
+        const std::string& model_name,
+        const std::vector<std::string>& new_model_names)
+{
+    m_logger->info("Entering MochiBackend::duplicate_many");
+    std::vector<Status> result(new_model_names.size());
+    auto model = _find_model(model_name);
+    if(model == nullptr) {
+        m_logger->error("Model \"{}\" does not exist", model_name);
+        std::fill(result.begin(), result.end(), Status(
+                    FLAMESTORE_ENOEXISTS,
+                    "No model found with provided name"));
+        req.respond(result);
         return;
     }
-    req.respond(Status::OK());
+    lock_guard_t guard(model->m_mutex);
+    while(!model->m_impl.m_staged.empty())
+        _drain_one(model);
+    _finish_copy(model);
+    // children are spread across targets by the placement policy, only
+    // the first one may be cloned on the targets holding the source; the
+    // tasks of all the children are started together so that each chunk
+    // of the source is read once
+    std::vector<copy_task> tasks;
+    bool locality = m_duplicate_locality;
+    for(std::size_t i = 0; i < new_model_names.size(); i++) {
+        result[i] = _check_name(new_model_names[i]);
+        if(result[i].m_code != FLAMESTORE_OK)
+            continue;
+        bool created = false;
+        auto new_model = _find_or_create_model(new_model_names[i], created);
+        if(not created) {
+            m_logger->error("Model \"{}\" already exists", new_model_names[i]);
+            result[i] = Status(
+                    FLAMESTORE_EEXISTS,
+                    "A model with the same name is already registered");
+            continue;
+        }
+        lock_guard_t guard2(new_model->m_mutex);
+        result[i] = _prepare_copy(model, new_model, locality, tasks);
+        locality = false;
+    }
+    _start_copy(std::move(tasks));
+    if(std::any_of(result.begin(), result.end(),
+            [](const Status& s) { return s.m_code == FLAMESTORE_OK; })) {
+        auto status = _sync_catalog();
+        for(auto& r : result)
+            if(r.m_code == FLAMESTORE_OK) r = status;
+    }
+    req.respond(result);
 }
 
 }
-
@@ -1,20 +1,179 @@
 #ifndef __FLAMESTORE_MODEL_H
 #define __FLAMESTORE_MODEL_H
 
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <thallium.hpp>
+#include "server/string_pool.hpp"
 
 namespace tl = thallium;
 
+/**
+ * @brief Tracks the writes of a model in progress. A write overtaken by
+ * a newer one with the same signature (both then either match the
+ * model's signature or not) need not transfer its data, since only the
+ * newest data matters. It is only dropped (SUPERSEDED) once a newer
+ * write has succeeded though: until then it is parked, and if the newer
+ * write fails, the newest write parked behind it is retried, so that a
+ * client is never told its data was superseded by data that was lost.
+ *
+ * Each write takes a ticket when it arrives (enqueue), asks whether to
+ * proceed (check) before moving data, and reports its outcome
+ * (complete). The guard class does this for a request handler.
+ */
+struct pending_writes {
+
+    enum decision : uint8_t {
+        PROCEED,    // no newer write in progress: move the data
+        PARK,       // a newer write is in progress: wait for its outcome
+        SUPERSEDED, // a newer write succeeded: drop this one
+        RETRY       // (outcome of a parked write) the newer write failed
+    };
+
+    struct entry {
+        std::string                             m_signature;
+        bool                                    m_parked = false;
+        std::shared_ptr<tl::eventual<decision>> m_outcome; // set while parked
+    };
+
+    tl::mutex                 m_mutex;
+    uint64_t                  m_last_ticket = 0;
+    std::map<uint64_t, entry> m_entries;  // by ticket
+    uint64_t                  m_last_ok = 0; // ticket of the newest write that succeeded
+    std::string               m_last_ok_signature;
+
+    uint64_t enqueue(const std::string& signature) {
+        std::lock_guard<tl::mutex> guard(m_mutex);
+        auto ticket = ++m_last_ticket;
+        m_entries[ticket].m_signature = signature;
+        return ticket;
+    }
+
+    /**
+     * @brief Decides whether a write should move its data. If the write
+     * is parked, outcome is set to the eventual its outcome will be set
+     * in (SUPERSEDED, or RETRY to call check again).
+     */
+    decision check(uint64_t ticket, std::shared_ptr<tl::eventual<decision>>& outcome) {
+        std::lock_guard<tl::mutex> guard(m_mutex);
+        auto it = m_entries.find(ticket);
+        if(it == m_entries.end()) return PROCEED;
+        auto& e = it->second;
+        if(m_last_ok > ticket && m_last_ok_signature == e.m_signature) {
+            m_entries.erase(it);
+            return SUPERSEDED;
+        }
+        for(auto newer = std::next(it); newer != m_entries.end(); ++newer) {
+            if(newer->second.m_signature != e.m_signature) continue;
+            e.m_parked  = true;
+            e.m_outcome = std::make_shared<tl::eventual<decision>>();
+            outcome = e.m_outcome;
+            return PARK;
+        }
+        return PROCEED;
+    }
+
+    /**
+     * @brief Reports the outcome of a write. On success, the older parked
+     * writes with the same signature are superseded; on failure, the
+     * newest of them is woken up to be retried.
+     */
+    void complete(uint64_t ticket, bool ok) {
+        std::lock_guard<tl::mutex> guard(m_mutex);
+        auto it = m_entries.find(ticket);
+        if(it == m_entries.end()) return;
+        auto signature = std::move(it->second.m_signature);
+        auto older_end = m_entries.erase(it);
+        if(ok) {
+            if(ticket > m_last_ok) {
+                m_last_ok = ticket;
+                m_last_ok_signature = signature;
+            }
+            for(auto older = m_entries.begin(); older != older_end;) {
+                if(older->second.m_parked && older->second.m_signature == signature) {
+                    older->second.m_outcome->set_value(SUPERSEDED);
+                    older = m_entries.erase(older);
+                } else {
+                    ++older;
+                }
+            }
+            return;
+        }
+        for(auto older = older_end; older != m_entries.begin();) {
+            --older;
+            if(older->second.m_parked && older->second.m_signature == signature) {
+                older->second.m_parked = false;
+                older->second.m_outcome->set_value(RETRY);
+                older->second.m_outcome.reset();
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief Ticket of a write for the duration of its handler. A write
+     * that leaves without reporting its outcome is completed as failed.
+     */
+    class guard {
+
+        public:
+
+            guard(pending_writes& writes, const std::string& signature)
+            : m_writes(writes)
+            , m_ticket(writes.enqueue(signature)) {}
+
+            guard(const guard&)            = delete;
+            guard& operator=(const guard&) = delete;
+
+            ~guard() {
+                if(!m_done) m_writes.complete(m_ticket, false);
+            }
+
+            decision check() {
+                auto d = m_writes.check(m_ticket, m_outcome);
+                if(d == SUPERSEDED) m_done = true;
+                return d;
+            }
+
+            /**
+             * @brief Waits for the outcome of a parked write. Must not
+             * be called with the model locked.
+             */
+            decision wait() {
+                auto d = m_outcome->wait();
+                m_outcome.reset();
+                if(d == SUPERSEDED) m_done = true;
+                return d;
+            }
+
+            void complete(bool ok) {
+                m_writes.complete(m_ticket, ok);
+                m_done = true;
+            }
+
+        private:
+
+            pending_writes&                         m_writes;
+            uint64_t                                m_ticket;
+            std::shared_ptr<tl::eventual<decision>> m_outcome;
+            bool                                    m_done = false;
+    };
+};
+
 template<typename T>
 struct flamestore_model {
    
-    tl::mutex         m_mutex;
-    std::string       m_name;
-    std::string       m_model_config;
-    std::string       m_model_signature;
-    T                 m_impl;
+    tl::mutex                          m_mutex;
+    std::string                        m_name;
+    flamestore::interned_string        m_model_config;    // shared by models with the same config
+    flamestore::interned_string        m_model_signature; // shared by models with the same signature
+    std::map<std::string, std::string> m_tags;
+    pending_writes                     m_pending_writes;
+    T                                  m_impl;
 
     flamestore_model() = default;
     flamestore_model(const flamestore_model&) = delete;
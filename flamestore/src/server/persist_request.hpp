@@ -0,0 +1,36 @@
+#ifndef __FLAMESTORE_PERSIST_REQUEST_H
+#define __FLAMESTORE_PERSIST_REQUEST_H
+
+#include <cstdint>
+#include <bake-client.hpp>
+#include <thallium/serialization/stl/vector.hpp>
+
+namespace flamestore {
+
+/**
+ * @brief Range of a Bake region that the master asks a StorageServer
+ * to persist. Requests for a same storage server are sent in batches
+ * (group commit) with the flamestore_persist_batch RPC, which responds
+ * with one status per request (0 on success, a Bake error code otherwise).
+ * Overlapping or adjacent ranges of a same region within a batch are
+ * persisted with a single Bake call.
+ */
+struct persist_request {
+
+    bake::target m_target;
+    bake::region m_region;
+    uint64_t     m_offset = 0;
+    uint64_t     m_size   = 0;
+
+    template<typename A>
+    void serialize(A& ar) {
+        ar & m_target;
+        ar & m_region;
+        ar & m_offset;
+        ar & m_size;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,222 @@
+#include "server/placement.hpp"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <mutex>
+#include <map>
+#include <cmath>
+#include <limits>
+
+namespace flamestore {
+
+std::unordered_map<std::string,
+    std::function<std::unique_ptr<AbstractPlacementPolicy>()>>
+        AbstractPlacementPolicy::s_policy_factories;
+
+std::vector<std::size_t> AbstractPlacementPolicy::select(
+        const std::vector<placement_target>& targets,
+        const std::string& model_name,
+        std::size_t model_size,
+        std::size_t count,
+        bool distinct_servers)
+{
+    std::vector<std::size_t> order;
+    std::vector<std::size_t> result;
+    rank(targets, model_name, model_size, order);
+    for(auto i : order) {
+        if(result.size() == count) break;
+        if(targets[i].free_space() < model_size) continue;
+        if(distinct_servers) {
+            bool used = std::any_of(result.begin(), result.end(),
+                [&](std::size_t j) { return targets[j].m_server == targets[i].m_server; });
+            if(used) continue;
+        }
+        result.push_back(i);
+    }
+    return result;
+}
+
+/**
+ * @brief 64-bit FNV-1a hash followed by a splitmix64 finalizer
+ * (FNV alone spreads similar keys poorly on a ring).
+ */
+static uint64_t _hash(const std::string& key, uint64_t seed = 0) {
+    uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+    for(unsigned char c : key) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+/**
+ * @brief Picks targets uniformly at random
+ * (this is the historical behavior of the mochi backend).
+ */
+class RandomPlacementPolicy : public AbstractPlacementPolicy {
+
+    std::mutex   m_mutex;
+    std::mt19937 m_rng{std::random_device{}()};
+
+    public:
+
+    void rank(const std::vector<placement_target>& targets,
+              const std::string& model_name,
+              std::size_t model_size,
+              std::vector<std::size_t>& order) override {
+        order.resize(targets.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::lock_guard<std::mutex> guard(m_mutex);
+        std::shuffle(order.begin(), order.end(), m_rng);
+    }
+};
+
+REGISTER_FLAMESTORE_PLACEMENT("random", RandomPlacementPolicy);
+
+/**
+ * @brief Prefers the targets with the fewest bytes in flight,
+ * breaking ties with the number of operations in progress (issued by
+ * the master, then reported by the storage servers), then with the
+ * recent duration of an operation, and finally with the fraction of
+ * capacity already allocated (or the allocated bytes if the capacity
+ * is unknown).
+ */
+class LeastLoadedPlacementPolicy : public AbstractPlacementPolicy {
+
+    public:
+
+    void rank(const std::vector<placement_target>& targets,
+              const std::string& model_name,
+              std::size_t model_size,
+              std::vector<std::size_t>& order) override {
+        auto fill = [&targets](std::size_t i) {
+            const auto& t = targets[i];
+            if(t.m_capacity == 0) return (double)t.m_allocated;
+            return (double)t.m_allocated / (double)t.m_capacity;
+        };
+        order.resize(targets.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+            [&](std::size_t a, std::size_t b) {
+                if(targets[a].m_inflight != targets[b].m_inflight)
+                    return targets[a].m_inflight < targets[b].m_inflight;
+                if(targets[a].m_operations != targets[b].m_operations)
+                    return targets[a].m_operations < targets[b].m_operations;
+                if(targets[a].m_queue_depth != targets[b].m_queue_depth)
+                    return targets[a].m_queue_depth < targets[b].m_queue_depth;
+                if(targets[a].m_latency_us != targets[b].m_latency_us)
+                    return targets[a].m_latency_us < targets[b].m_latency_us;
+                return fill(a) < fill(b);
+            });
+    }
+};
+
+REGISTER_FLAMESTORE_PLACEMENT("least-loaded", LeastLoadedPlacementPolicy);
+
+/**
+ * @brief Picks targets at random with a probability proportional
+ * to their free space (weighted sampling without replacement,
+ * Efraimidis-Spirakis). Targets of unknown capacity are given the
+ * average weight of the known ones. Keys are computed as log(u)/w
+ * rather than u^(1/w), which rounds to 1 for weights in bytes.
+ */
+class CapacityWeightedPlacementPolicy : public AbstractPlacementPolicy {
+
+    std::mutex   m_mutex;
+    std::mt19937 m_rng{std::random_device{}()};
+
+    public:
+
+    void rank(const std::vector<placement_target>& targets,
+              const std::string& model_name,
+              std::size_t model_size,
+              std::vector<std::size_t>& order) override {
+        double known_total = 0.0;
+        std::size_t known_count = 0;
+        for(const auto& t : targets) {
+            if(t.m_capacity == 0) continue;
+            known_total += (double)t.free_space();
+            known_count += 1;
+        }
+        double default_weight = known_count ? known_total / known_count : 1.0;
+        std::vector<double> keys(targets.size());
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            std::uniform_real_distribution<double> dist(0.0, 1.0);
+            for(std::size_t i = 0; i < targets.size(); i++) {
+                double w = targets[i].m_capacity ? (double)targets[i].free_space() : default_weight;
+                keys[i] = w > 0.0 ? std::log(1.0 - dist(m_rng))/w // u in (0,1]
+                                  : -std::numeric_limits<double>::infinity();
+            }
+        }
+        order.resize(targets.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(),
+            [&keys](std::size_t a, std::size_t b) { return keys[a] > keys[b]; });
+    }
+};
+
+REGISTER_FLAMESTORE_PLACEMENT("capacity-weighted", CapacityWeightedPlacementPolicy);
+
+/**
+ * @brief Consistent hashing of the model name on a ring of virtual
+ * nodes. Targets are ranked in the order in which they are met when
+ * walking the ring clockwise from the model's hash, so that adding or
+ * removing a target only moves the models that hashed next to it.
+ */
+class ConsistentHashingPlacementPolicy : public AbstractPlacementPolicy {
+
+    static constexpr unsigned s_virtual_nodes = 64;
+
+    std::mutex                        m_mutex;
+    std::vector<std::string>          m_keys; // keys the ring was built for
+    std::map<uint64_t, std::string>   m_ring;
+
+    void _rebuild(const std::vector<placement_target>& targets) {
+        m_keys.clear();
+        m_ring.clear();
+        for(const auto& t : targets) {
+            m_keys.push_back(t.m_key);
+            for(unsigned v = 0; v < s_virtual_nodes; v++)
+                m_ring.emplace(_hash(t.m_key, v), t.m_key);
+        }
+    }
+
+    public:
+
+    void rank(const std::vector<placement_target>& targets,
+              const std::string& model_name,
+              std::size_t model_size,
+              std::vector<std::size_t>& order) override {
+        std::unordered_map<std::string, std::size_t> index;
+        for(std::size_t i = 0; i < targets.size(); i++)
+            index[targets[i].m_key] = i;
+        order.clear();
+        std::lock_guard<std::mutex> guard(m_mutex);
+        bool changed = m_keys.size() != targets.size();
+        for(std::size_t i = 0; !changed && i < targets.size(); i++)
+            changed = m_keys[i] != targets[i].m_key;
+        if(changed) _rebuild(targets);
+        if(m_ring.empty()) return;
+        std::vector<bool> seen(targets.size(), false);
+        auto start = m_ring.lower_bound(_hash(model_name));
+        auto it = start;
+        do {
+            if(it == m_ring.end()) it = m_ring.begin();
+            auto i = index[it->second];
+            if(!seen[i]) {
+                seen[i] = true;
+                order.push_back(i);
+                if(order.size() == targets.size()) break;
+            }
+            ++it;
+        } while(it != start);
+    }
+};
+
+REGISTER_FLAMESTORE_PLACEMENT("consistent-hashing", ConsistentHashingPlacementPolicy);
+
+}
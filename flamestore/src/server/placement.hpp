@@ -0,0 +1,127 @@
+#ifndef __FLAMESTORE_PLACEMENT_H
+#define __FLAMESTORE_PLACEMENT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+
+namespace flamestore {
+
+/**
+ * @brief Information about a storage target that placement
+ * policies use to make their decisions. A capacity of 0 means
+ * that the capacity of the target is unknown.
+ */
+struct placement_target {
+    std::string m_key;           // stable identifier (address + target)
+    uint64_t    m_server = 0;    // SSG member id of the storage server
+    std::size_t m_capacity = 0;  // total capacity, in bytes
+    std::size_t m_allocated = 0; // bytes allocated by the master
+    std::size_t m_inflight = 0;  // bytes currently being transferred
+    uint32_t    m_operations = 0; // Bake operations of the master in progress
+    uint32_t    m_latency_us = 0; // recent duration of an operation
+    // reported by the storage server (0 if unknown or outdated)
+    std::size_t m_device_free = 0; // free space on the target's device
+    uint32_t    m_queue_depth = 0; // operations in progress on the target
+
+    std::size_t free_space() const {
+        if(m_capacity == 0) return m_device_free ? m_device_free : SIZE_MAX;
+        return m_allocated >= m_capacity ? 0 : m_capacity - m_allocated;
+    }
+};
+
+template<typename T>
+class PlacementFactoryRegistration;
+
+/**
+ * @brief Placement policies rank a set of storage targets by
+ * order of preference for a new model. Callers then pick the first
+ * target(s) that satisfy their own constraints (free space,
+ * distinct storage servers, etc.).
+ *
+ * Policies must be thread safe and must not depend on Argobots,
+ * so that they can be exercised outside of a server.
+ */
+class AbstractPlacementPolicy {
+
+    private:
+
+        template<typename T>
+        friend class PlacementFactoryRegistration;
+
+        static std::unordered_map<
+            std::string,
+            std::function<std::unique_ptr<AbstractPlacementPolicy>()>> s_policy_factories;
+
+    protected:
+
+        AbstractPlacementPolicy() = default;
+
+    public:
+
+        AbstractPlacementPolicy(const AbstractPlacementPolicy&)            = delete;
+        AbstractPlacementPolicy(AbstractPlacementPolicy&&)                 = delete;
+        AbstractPlacementPolicy& operator=(const AbstractPlacementPolicy&) = delete;
+        AbstractPlacementPolicy& operator=(AbstractPlacementPolicy&&)      = delete;
+        virtual ~AbstractPlacementPolicy()                                 = default;
+
+        /**
+         * @brief Creates a policy from its name.
+         * Returns nullptr if no such policy exists.
+         */
+        static std::unique_ptr<AbstractPlacementPolicy> create(const std::string& name) {
+            auto factory = s_policy_factories.find(name);
+            if(factory == s_policy_factories.end())
+                return std::unique_ptr<AbstractPlacementPolicy>(nullptr);
+            return factory->second();
+        }
+
+        /**
+         * @brief Ranks the targets for a model.
+         *
+         * @param targets Candidate targets.
+         * @param model_name Name of the model to place.
+         * @param model_size Size of the model to place.
+         * @param order Resulting order (indices in targets), most preferred first.
+         */
+        virtual void rank(
+                const std::vector<placement_target>& targets,
+                const std::string& model_name,
+                std::size_t model_size,
+                std::vector<std::size_t>& order) = 0;
+
+        /**
+         * @brief Helper function that ranks the targets and returns
+         * up to count distinct targets that have enough free space.
+         * If distinct_servers is true, the returned targets also belong
+         * to distinct storage servers.
+         */
+        std::vector<std::size_t> select(
+                const std::vector<placement_target>& targets,
+                const std::string& model_name,
+                std::size_t model_size,
+                std::size_t count = 1,
+                bool distinct_servers = false);
+};
+
+template<typename T>
+class PlacementFactoryRegistration {
+
+    public:
+
+    PlacementFactoryRegistration(const std::string& name) {
+        AbstractPlacementPolicy::s_policy_factories[name] = []() {
+            return std::make_unique<T>();
+        };
+    }
+};
+
+}
+
+#define REGISTER_FLAMESTORE_PLACEMENT(__name_str__, __type__) \
+    static PlacementFactoryRegistration<__type__> __registration_##__type__(__name_str__)
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef __FLAMESTORE_READ_CACHE_H
+#define __FLAMESTORE_READ_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <thallium.hpp>
+
+namespace flamestore {
+
+namespace tl = thallium;
+
+/**
+ * @brief Size-bounded cache of model data in the master's memory.
+ *
+ * Entries hold the data of a given version of a model in memory that is
+ * exposed for RDMA once, when the entry is created, so that a hit costs
+ * a single bulk transfer to the client. An entry is only returned for
+ * the version it was created for, so a stale entry is never served even
+ * if it has not been invalidated yet.
+ *
+ * Admission is based on access frequency (in the spirit of TinyLFU):
+ * accesses are counted in a count-min sketch whose counters are halved
+ * periodically, a model is admitted only once it has been accessed
+ * m_min_frequency times, and only if it is accessed more often than
+ * every entry that would have to be evicted (least recently used first)
+ * to make room for it. This keeps models read once (e.g. by a single
+ * restarting client) from evicting models read by many workers.
+ *
+ * Entries are filled outside of the cache: admit decides whether a model
+ * is cached and reserves its room (evicting entries) in a single step,
+ * then the caller reads the model and calls put, or abandon if the read
+ * failed. A model being filled is not admitted again.
+ */
+class ReadCache {
+
+    public:
+
+        struct entry {
+            std::string       m_key;
+            uint64_t          m_version = 0;
+            std::vector<char> m_data;
+            tl::bulk          m_bulk;
+        };
+
+        /**
+         * @brief Counters published by the cache.
+         */
+        struct stats {
+            uint64_t m_hits       = 0;
+            uint64_t m_misses     = 0;
+            uint64_t m_admissions = 0;
+            uint64_t m_rejections = 0;
+            uint64_t m_evictions  = 0;
+            uint64_t m_entries    = 0;
+            uint64_t m_bytes      = 0;
+        };
+
+        ReadCache(std::size_t capacity, unsigned min_frequency = 2)
+        : m_capacity(capacity)
+        , m_min_frequency(min_frequency)
+        , m_sketch(s_sketch_depth * s_sketch_width, 0) {}
+
+        /**
+         * @brief Records an access to a model and returns its entry if
+         * it is cached for the provided version, nullptr otherwise.
+         */
+        std::shared_ptr<entry> get(const std::string& key, uint64_t version) {
+            std::lock_guard<tl::mutex> guard(m_mutex);
+            _increment(key);
+            auto it = m_index.find(key);
+            if(it == m_index.end() || (*it->second)->m_version != version) {
+                m_stats.m_misses += 1;
+                return nullptr;
+            }
+            m_lru.splice(m_lru.begin(), m_lru, it->second);
+            m_stats.m_hits += 1;
+            return *it->second;
+        }
+
+        /**
+         * @brief Decides whether a model that missed should be cached and,
+         * if so, evicts entries to make room for it and reserves this room
+         * until put or abandon is called for the model.
+         */
+        bool admit(const std::string& key, std::size_t size) {
+            std::lock_guard<tl::mutex> guard(m_mutex);
+            if(m_filling.count(key)) return false;
+            if(size > m_capacity) {
+                m_stats.m_rejections += 1;
+                return false;
+            }
+            auto frequency = _estimate(key);
+            if(frequency < m_min_frequency) {
+                m_stats.m_rejections += 1;
+                return false;
+            }
+            std::size_t needed = m_used + size > m_capacity ? m_used + size - m_capacity : 0;
+            std::size_t freed  = 0;
+            for(auto it = m_lru.rbegin(); freed < needed && it != m_lru.rend(); ++it) {
+                if((*it)->m_key == key) {
+                    freed += (*it)->m_data.size();
+                    continue;
+                }
+                if(_estimate((*it)->m_key) >= frequency) {
+                    m_stats.m_rejections += 1;
+                    return false;
+                }
+                freed += (*it)->m_data.size();
+            }
+            _erase(key);
+            while(!m_lru.empty() && m_used + size > m_capacity) {
+                _erase(m_lru.back()->m_key);
+                m_stats.m_evictions += 1;
+            }
+            // the room may be reserved by other models being filled
+            if(m_used + size > m_capacity) {
+                m_stats.m_rejections += 1;
+                return false;
+            }
+            m_used += size;
+            m_filling[key] = size;
+            return true;
+        }
+
+        /**
+         * @brief Inserts (or replaces) the entry of a model, in the room
+         * reserved by admit if any, evicting least recently used entries
+         * to make room otherwise.
+         */
+        void put(std::shared_ptr<entry> e) {
+            std::lock_guard<tl::mutex> guard(m_mutex);
+            _unreserve(e->m_key);
+            _erase(e->m_key);
+            while(!m_lru.empty() && m_used + e->m_data.size() > m_capacity) {
+                _erase(m_lru.back()->m_key);
+                m_stats.m_evictions += 1;
+            }
+            if(m_used + e->m_data.size() > m_capacity) return;
+            m_used += e->m_data.size();
+            m_lru.push_front(e);
+            m_index[e->m_key] = m_lru.begin();
+            m_stats.m_admissions += 1;
+        }
+
+        /**
+         * @brief Releases the room reserved by admit for a model
+         * that could not be read.
+         */
+        void abandon(const std::string& key) {
+            std::lock_guard<tl::mutex> guard(m_mutex);
+            _unreserve(key);
+        }
+
+        /**
+         * @brief Removes the entry of a model (e.g. when it is written).
+         */
+        void invalidate(const std::string& key) {
+            std::lock_guard<tl::mutex> guard(m_mutex);
+            _erase(key);
+        }
+
+        stats get_stats() {
+            std::lock_guard<tl::mutex> guard(m_mutex);
+            stats result = m_stats;
+            result.m_entries = m_lru.size();
+            result.m_bytes   = m_used;
+            return result;
+        }
+
+    private:
+
+        static constexpr std::size_t s_sketch_depth = 4;
+        static constexpr std::size_t s_sketch_width = 4096;
+        static constexpr uint8_t     s_sketch_max   = 15;
+
+        using lru_list = std::list<std::shared_ptr<entry>>;
+
+        std::size_t                                         m_capacity;
+        std::size_t                                         m_used = 0;
+        unsigned                                            m_min_frequency;
+        tl::mutex                                           m_mutex;
+        lru_list                                            m_lru; // most recent first
+        std::unordered_map<std::string, lru_list::iterator> m_index;
+        std::unordered_map<std::string, std::size_t>        m_filling; // room reserved by admit
+        std::vector<uint8_t>                                m_sketch;
+        std::size_t                                         m_increments = 0;
+        stats                                               m_stats;
+
+        void _erase(const std::string& key) {
+            auto it = m_index.find(key);
+            if(it == m_index.end()) return;
+            m_used -= (*it->second)->m_data.size();
+            m_lru.erase(it->second);
+            m_index.erase(it);
+        }
+
+        void _unreserve(const std::string& key) {
+            auto it = m_filling.find(key);
+            if(it == m_filling.end()) return;
+            m_used -= it->second;
+            m_filling.erase(it);
+        }
+
+        std::size_t _slot(const std::string& key, std::size_t row) const {
+            uint64_t h = std::hash<std::string>()(key) + row * 0x9e3779b97f4a7c15ULL;
+            h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return row * s_sketch_width + (h % s_sketch_width);
+        }
+
+        unsigned _estimate(const std::string& key) const {
+            unsigned result = s_sketch_max;
+            for(std::size_t row = 0; row < s_sketch_depth; row++)
+                result = std::min<unsigned>(result, m_sketch[_slot(key, row)]);
+            return result;
+        }
+
+        void _increment(const std::string& key) {
+            for(std::size_t row = 0; row < s_sketch_depth; row++) {
+                auto& counter = m_sketch[_slot(key, row)];
+                if(counter < s_sketch_max) counter += 1;
+            }
+            // aging: halve all the counters every 10*width accesses so
+            // that models that stopped being read lose their priority
+            if(++m_increments == 10 * s_sketch_width) {
+                for(auto& counter : m_sketch) counter >>= 1;
+                m_increments = 0;
+            }
+        }
+};
+
+}
+
+#endif
@@ -0,0 +1,166 @@
+#include "server/scheduler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <json/json.h>
+
+namespace flamestore {
+
+static const char* s_class_names[] = { "restore", "metadata", "checkpoint" };
+
+Scheduler::Scheduler(spdlog::logger* logger, const std::string& config)
+: m_logger(logger) {
+    if(config.empty()) return;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value root;
+    std::string errors;
+    if(!reader->parse(config.data(), config.data() + config.size(), &root, &errors)
+    || !(root.isObject() || root.isNull())) {
+        m_logger->critical("Invalid scheduler configuration: {}", errors);
+        throw std::runtime_error("Invalid scheduler configuration");
+    }
+    m_max_inflight = root["max_inflight_bytes"].asUInt64();
+    if(root.isMember("client_ttl_s"))
+        m_client_ttl = std::chrono::seconds(root["client_ttl_s"].asUInt64());
+    const auto& weights = root["weights"];
+    for(int c = 0; c < NUM_CLASSES; c++) {
+        if(!weights.isMember(s_class_names[c])) continue;
+        double w = weights[s_class_names[c]].asDouble();
+        if(w <= 0) {
+            m_logger->critical("Invalid scheduler weight for class {}", s_class_names[c]);
+            throw std::runtime_error("Invalid scheduler configuration");
+        }
+        m_weights[c] = w;
+    }
+    m_logger->info("Scheduler: max {} bytes in flight, weights {}/{}/{} (restore/metadata/checkpoint), "
+            "client priorities kept {}s", m_max_inflight, m_weights[RESTORE], m_weights[METADATA],
+            m_weights[CHECKPOINT], m_client_ttl.count());
+}
+
+void Scheduler::_tag(request_class cls, const std::string& client, std::size_t bytes,
+                     double& start, double& finish) {
+    auto now = std::chrono::steady_clock::now();
+    uint32_t priority = 1;
+    auto p = m_priorities.find(client);
+    if(p != m_priorities.end()) {
+        priority = p->second.m_priority;
+        p->second.m_last_seen = now;
+    }
+    double weight = m_weights[cls] * priority;
+    auto& last_finish = m_last_finish[client + '#' + s_class_names[cls]];
+    start  = std::max(m_virtual_time, last_finish);
+    finish = start + std::max(bytes, s_min_cost) / weight;
+    last_finish  = finish;
+    m_max_finish = std::max(m_max_finish, finish);
+    if(m_last_finish.size() + m_priorities.size() >= m_sweep_at)
+        _sweep();
+}
+
+Scheduler::ticket Scheduler::_admitted(request_class cls, std::size_t bytes) {
+    auto& stats = m_stats[cls];
+    stats.m_admitted += 1;
+    stats.m_bytes    += bytes;
+    m_inflight       += bytes;
+    return ticket(this, bytes);
+}
+
+Scheduler::ticket Scheduler::admit(request_class cls, const std::string& client, std::size_t bytes) {
+    std::unique_lock<tl::mutex> lock(m_mutex);
+    auto& stats = m_stats[cls];
+    if(cls == METADATA || m_max_inflight == 0)
+        return _admitted(cls, bytes);
+    double start, finish;
+    _tag(cls, client, bytes, start, finish);
+    if(!(m_queue.empty() && _fits(bytes))) {
+        auto tag = std::make_pair(finish, m_arrivals++);
+        m_queue.insert(tag);
+        stats.m_queued    += 1;
+        stats.m_max_queued = std::max(stats.m_max_queued, stats.m_queued);
+        auto t0 = std::chrono::steady_clock::now();
+        while(*m_queue.begin() != tag || !_fits(bytes))
+            m_cv.wait(lock);
+        m_queue.erase(m_queue.begin());
+        stats.m_queued -= 1;
+        auto waited = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - t0).count();
+        stats.m_delayed    += 1;
+        stats.m_wait_us    += waited;
+        stats.m_max_wait_us = std::max<uint64_t>(stats.m_max_wait_us, waited);
+        // the next request may fit as well
+        if(!m_queue.empty()) m_cv.notify_all();
+    }
+    m_virtual_time = std::max(m_virtual_time, start);
+    return _admitted(cls, bytes);
+}
+
+bool Scheduler::try_admit(request_class cls, const std::string& client, std::size_t bytes, ticket& result) {
+    std::lock_guard<tl::mutex> lock(m_mutex);
+    if(cls != METADATA && m_max_inflight != 0) {
+        if(!(m_queue.empty() && _fits(bytes)))
+            return false;
+        double start, finish;
+        _tag(cls, client, bytes, start, finish);
+        m_virtual_time = std::max(m_virtual_time, start);
+    }
+    result = _admitted(cls, bytes);
+    return true;
+}
+
+void Scheduler::_release(std::size_t bytes) {
+    std::lock_guard<tl::mutex> lock(m_mutex);
+    m_inflight -= bytes;
+    if(!m_queue.empty()) m_cv.notify_all();
+    // once idle, the virtual time catches up with the last finish tag
+    // (no flow has a backlog to be compensated for anymore)
+    else if(m_inflight == 0) m_virtual_time = m_max_finish;
+}
+
+void Scheduler::_sweep() {
+    for(auto it = m_last_finish.begin(); it != m_last_finish.end();) {
+        if(it->second <= m_virtual_time) it = m_last_finish.erase(it);
+        else ++it;
+    }
+    auto expired = std::chrono::steady_clock::now() - m_client_ttl;
+    for(auto it = m_priorities.begin(); it != m_priorities.end();) {
+        if(it->second.m_last_seen < expired) it = m_priorities.erase(it);
+        else ++it;
+    }
+    // sweeping again once the state has doubled keeps admission amortized O(1)
+    m_sweep_at = std::max<std::size_t>(64, 2*(m_last_finish.size() + m_priorities.size()));
+}
+
+void Scheduler::set_priority(const std::string& client, uint32_t priority) {
+    std::lock_guard<tl::mutex> lock(m_mutex);
+    if(priority <= 1) {
+        m_priorities.erase(client);
+        return;
+    }
+    auto& p = m_priorities[client];
+    p.m_priority  = priority;
+    p.m_last_seen = std::chrono::steady_clock::now();
+    if(m_last_finish.size() + m_priorities.size() >= m_sweep_at)
+        _sweep();
+}
+
+std::map<std::string, uint64_t> Scheduler::stats() const {
+    std::map<std::string, uint64_t> result;
+    std::lock_guard<tl::mutex> lock(m_mutex);
+    for(int c = 0; c < NUM_CLASSES; c++) {
+        auto prefix = std::string("scheduler.") + s_class_names[c] + ".";
+        const auto& s = m_stats[c];
+        result[prefix + "admitted"]    = s.m_admitted;
+        result[prefix + "queued"]      = s.m_queued;
+        result[prefix + "max_queued"]  = s.m_max_queued;
+        result[prefix + "delayed"]     = s.m_delayed;
+        result[prefix + "wait_us"]     = s.m_wait_us;
+        result[prefix + "max_wait_us"] = s.m_max_wait_us;
+        result[prefix + "bytes"]       = s.m_bytes;
+    }
+    result["scheduler.inflight_bytes"]     = m_inflight;
+    result["scheduler.flows"]              = m_last_finish.size();
+    result["scheduler.clients"]            = m_priorities.size();
+    result["scheduler.max_inflight_bytes"] = m_max_inflight;
+    return result;
+}
+
+}
@@ -0,0 +1,207 @@
+#ifndef __FLAMESTORE_SCHEDULER_H
+#define __FLAMESTORE_SCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <spdlog/spdlog.h>
+#include <thallium.hpp>
+
+namespace flamestore {
+
+namespace tl = thallium;
+
+/**
+ * @brief Admission control of the master's requests. Requests are
+ * classified as restores (reads of model data), metadata requests, and
+ * checkpoints (writes of model data). Requests that transfer model data
+ * are admitted as long as the bytes in flight stay under a cap, and
+ * queued otherwise. Queued requests are admitted by weighted fair
+ * queuing (start-time tags, finish-tag order) over flows made of a
+ * client and a class, the weight of a flow being the weight of its class
+ * multiplied by the priority of its client. A request larger than the
+ * cap is admitted once nothing else is in flight. Metadata requests
+ * move no bulk data and are never queued, they are only counted.
+ *
+ * The finish tags of idle flows are dropped once the virtual time has
+ * passed them, and the priorities of clients that have not been seen
+ * for client_ttl_s seconds are dropped, so that short-lived clients do
+ * not accumulate state.
+ *
+ * The scheduler is configured in JSON, e.g.:
+ *
+ *   {
+ *     "max_inflight_bytes": 1073741824,
+ *     "weights": { "restore": 8, "metadata": 4, "checkpoint": 1 },
+ *     "client_ttl_s": 3600
+ *   }
+ *
+ * A cap of 0 (the default) admits all the requests immediately.
+ */
+class Scheduler {
+
+    public:
+
+        enum request_class : uint8_t {
+            RESTORE     = 0,
+            METADATA    = 1,
+            CHECKPOINT  = 2,
+            NUM_CLASSES = 3
+        };
+
+        /**
+         * @brief Admission of a request. The bytes it was admitted with
+         * are released when the ticket is destroyed.
+         */
+        class ticket {
+
+            public:
+
+                ticket() = default;
+                ticket(const ticket&) = delete;
+                ticket& operator=(const ticket&) = delete;
+
+                ticket(ticket&& other)
+                : m_scheduler(other.m_scheduler)
+                , m_bytes(other.m_bytes) {
+                    other.m_scheduler = nullptr;
+                }
+
+                ticket& operator=(ticket&& other) {
+                    if(this != &other) {
+                        if(m_scheduler) m_scheduler->_release(m_bytes);
+                        m_scheduler = other.m_scheduler;
+                        m_bytes     = other.m_bytes;
+                        other.m_scheduler = nullptr;
+                    }
+                    return *this;
+                }
+
+                ~ticket() {
+                    if(m_scheduler) m_scheduler->_release(m_bytes);
+                }
+
+            private:
+
+                friend class Scheduler;
+
+                ticket(Scheduler* scheduler, std::size_t bytes)
+                : m_scheduler(scheduler)
+                , m_bytes(bytes) {}
+
+                Scheduler*  m_scheduler = nullptr;
+                std::size_t m_bytes     = 0;
+        };
+
+        Scheduler(spdlog::logger* logger, const std::string& config);
+
+        Scheduler(const Scheduler&)            = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        /**
+         * @brief Key of the client that sent a request: the address of
+         * its endpoint rather than an address given as an argument of
+         * the RPC, so that a client cannot use the weight of another.
+         */
+        static std::string client_of(const tl::request& req) {
+            return req.get_endpoint();
+        }
+
+        /**
+         * @brief Blocks until the request can be admitted.
+         *
+         * @param cls Class of the request
+         * @param client Key of the client (see client_of)
+         * @param bytes Model data the request transfers
+         */
+        ticket admit(request_class cls, const std::string& client, std::size_t bytes);
+
+        /**
+         * @brief Same as admit, but fails instead of queuing the request.
+         *
+         * @return false if the request would have been queued.
+         */
+        bool try_admit(request_class cls, const std::string& client, std::size_t bytes, ticket& result);
+
+        /**
+         * @brief Sets the priority of a client (1 by default), which
+         * multiplies the weight of its requests.
+         */
+        void set_priority(const std::string& client, uint32_t priority);
+
+        /**
+         * @brief Per-class counters (admitted and queued requests,
+         * queuing delays, bytes) and bytes in flight.
+         */
+        std::map<std::string, uint64_t> stats() const;
+
+    private:
+
+        struct class_stats {
+            uint64_t m_admitted    = 0;
+            uint64_t m_queued      = 0; // currently waiting
+            uint64_t m_max_queued  = 0;
+            uint64_t m_delayed     = 0; // admitted after waiting
+            uint64_t m_wait_us     = 0;
+            uint64_t m_max_wait_us = 0;
+            uint64_t m_bytes       = 0;
+        };
+
+        struct client_priority {
+            uint32_t                              m_priority = 1;
+            std::chrono::steady_clock::time_point m_last_seen;
+        };
+
+        // requests are charged at least this many bytes, so that
+        // small ones still advance the virtual time of their flow
+        static constexpr std::size_t s_min_cost = 4096;
+
+        spdlog::logger*                           m_logger;
+        mutable tl::mutex                         m_mutex;
+        tl::condition_variable                    m_cv;
+        std::size_t                               m_max_inflight = 0;
+        std::size_t                               m_inflight     = 0;
+        double                                    m_weights[NUM_CLASSES] = { 4.0, 4.0, 1.0 };
+        double                                    m_virtual_time = 0.0;
+        double                                    m_max_finish   = 0.0;
+        std::unordered_map<std::string, double>   m_last_finish; // per flow
+        std::unordered_map<std::string, client_priority> m_priorities;
+        std::chrono::seconds                      m_client_ttl{3600};
+        std::size_t                               m_sweep_at = 64;
+        std::set<std::pair<double, uint64_t>>     m_queue; // finish tag, arrival
+        uint64_t                                  m_arrivals = 0;
+        class_stats                               m_stats[NUM_CLASSES];
+
+        bool _fits(std::size_t bytes) const {
+            return m_inflight == 0 || m_inflight + bytes <= m_max_inflight;
+        }
+
+        /**
+         * @brief Computes the start and finish tags of a request in its
+         * flow. Must be called with the mutex locked.
+         */
+        void _tag(request_class cls, const std::string& client, std::size_t bytes,
+                  double& start, double& finish);
+
+        /**
+         * @brief Accounts for an admitted request. Must be called with
+         * the mutex locked.
+         */
+        ticket _admitted(request_class cls, std::size_t bytes);
+
+        /**
+         * @brief Drops the finish tags the virtual time has passed and the
+         * priorities of idle clients. Must be called with the mutex locked.
+         */
+        void _sweep();
+
+        void _release(std::size_t bytes);
+};
+
+}
+
+#endif
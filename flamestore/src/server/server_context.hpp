@@ -3,14 +3,20 @@
 
 #include <spdlog/spdlog.h>
 #include <thallium.hpp>
+#include "server/string_pool.hpp"
 
 namespace flamestore {
 
 namespace tl = thallium;
 
+class Scheduler;
+
 struct ServerContext {
     spdlog::logger* m_logger = nullptr;
     tl::engine*     m_engine = nullptr;
+    StringPool*     m_strings = nullptr; // configs and signatures shared by the models
+    const tl::pool* m_io_pool = nullptr; // pool for background I/O (handler pool if null)
+    Scheduler*      m_scheduler = nullptr; // admission of checkpoints (see AbstractServerBackend::_admit_checkpoint)
 };
 
 }
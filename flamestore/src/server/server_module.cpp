@@ -12,13 +12,17 @@ PYBIND11_MODULE(_flamestore_server, m) {
                         const std::string&,
                         const std::string&,
                         int,
-                        const flamestore::MasterServer::backend_config_t&>(),
+                        const flamestore::MasterServer::backend_config_t&,
+                        const std::string&,
+                        const std::string&>(),
                 py11::arg("mid"),
                 py11::arg("workspace")=std::string("."),
                 py11::arg("backend")=std::string("master-memory"),
                 py11::arg("logfile")=std::string(""),
                 py11::arg("loglevel")=2,
-                py11::arg("config")=py11::dict())
+                py11::arg("config")=py11::dict(),
+                py11::arg("threading")=std::string(""),
+                py11::arg("scheduler")=std::string(""))
         .def("get_connection_info", &flamestore::MasterServer::get_connection_info);
     py11::class_<flamestore::StorageServer>(m, "StorageServer")
         .def(py11::init<pymargo_instance_id,
@@ -0,0 +1,111 @@
+#include "server/slab_allocator.hpp"
+#include <iterator>
+#include <algorithm>
+
+namespace flamestore {
+
+std::size_t SlabAllocator::add_slab(std::size_t size) {
+    slab s;
+    s.m_size = size;
+    if(size != 0) s.m_free[0] = size;
+    m_slabs.push_back(std::move(s));
+    return m_slabs.size() - 1;
+}
+
+bool SlabAllocator::allocate(std::size_t size, std::size_t& index, std::size_t& offset) {
+    size = _align(size);
+    for(std::size_t i = 0; i < m_slabs.size(); i++) {
+        auto& s = m_slabs[i];
+        if(s.m_state != slab_state::active || s.m_size - s.m_used < size) continue;
+        for(auto it = s.m_free.begin(); it != s.m_free.end(); ++it) {
+            if(it->second < size) continue;
+            offset = it->first;
+            auto remaining = it->second - size;
+            s.m_free.erase(it);
+            if(remaining != 0) s.m_free[offset + size] = remaining;
+            s.m_used += size;
+            index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SlabAllocator::reserve(std::size_t index, std::size_t offset, std::size_t size) {
+    size = _align(size);
+    auto& s = m_slabs[index];
+    // free extent starting at or before offset
+    auto it = s.m_free.upper_bound(offset);
+    if(it == s.m_free.begin()) return false;
+    --it;
+    auto start = it->first, length = it->second;
+    if(offset + size > start + length) return false;
+    s.m_free.erase(it);
+    if(offset > start) s.m_free[start] = offset - start;
+    if(offset + size < start + length) s.m_free[offset + size] = start + length - offset - size;
+    s.m_used += size;
+    return true;
+}
+
+void SlabAllocator::release(std::size_t index, std::size_t offset, std::size_t size) {
+    size = _align(size);
+    auto& s = m_slabs[index];
+    s.m_used -= size;
+    auto it = s.m_free.emplace(offset, size).first;
+    // coalesce with the next extent
+    auto next = std::next(it);
+    if(next != s.m_free.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        s.m_free.erase(next);
+    }
+    // coalesce with the previous extent
+    if(it != s.m_free.begin()) {
+        auto prev = std::prev(it);
+        if(prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            s.m_free.erase(it);
+        }
+    }
+}
+
+void SlabAllocator::retire(std::size_t index) {
+    if(m_slabs[index].m_state == slab_state::active)
+        m_slabs[index].m_state = slab_state::retired;
+}
+
+void SlabAllocator::activate(std::size_t index) {
+    if(m_slabs[index].m_state == slab_state::retired)
+        m_slabs[index].m_state = slab_state::active;
+}
+
+void SlabAllocator::remove(std::size_t index) {
+    auto& s = m_slabs[index];
+    s.m_state = slab_state::removed;
+    s.m_free.clear();
+}
+
+std::vector<std::size_t> SlabAllocator::sparse_slabs(double threshold) const {
+    // only slabs that are not candidates themselves can receive content
+    std::vector<std::size_t> candidates;
+    std::size_t room = 0;
+    for(std::size_t i = 0; i < m_slabs.size(); i++) {
+        const auto& s = m_slabs[i];
+        if(s.m_state != slab_state::active) continue;
+        if((double)s.m_used < threshold * (double)s.m_size)
+            candidates.push_back(i);
+        else
+            room += s.m_size - s.m_used;
+    }
+    // emptiest slabs first, each one consuming the room it moves into
+    std::stable_sort(candidates.begin(), candidates.end(),
+        [this](std::size_t a, std::size_t b) { return m_slabs[a].m_used < m_slabs[b].m_used; });
+    std::vector<std::size_t> result;
+    for(auto i : candidates) {
+        if(m_slabs[i].m_used > room) break;
+        room -= m_slabs[i].m_used;
+        result.push_back(i);
+    }
+    return result;
+}
+
+}
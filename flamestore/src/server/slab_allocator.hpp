@@ -0,0 +1,123 @@
+#ifndef __FLAMESTORE_SLAB_ALLOCATOR_H
+#define __FLAMESTORE_SLAB_ALLOCATOR_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <map>
+
+namespace flamestore {
+
+/**
+ * @brief Free-space manager for a set of slabs, i.e. large storage
+ * regions shared by many small objects placed at offsets within them.
+ * The allocator only does the bookkeeping, creating, removing and
+ * accessing the actual regions is up to the caller, which identifies
+ * slabs by their index.
+ *
+ * Each slab keeps its free extents in an offset-ordered map and
+ * coalesces adjacent extents when space is released. Allocation is
+ * first-fit, slabs being tried by index. Slabs can be retired (e.g. to
+ * be compacted), in which case no new extent is allocated in them.
+ *
+ * This class is not thread safe and does not depend on Argobots.
+ */
+class SlabAllocator {
+
+    public:
+
+        SlabAllocator(std::size_t alignment = 64)
+        : m_alignment(alignment) {}
+
+        /**
+         * @brief Adds an empty slab of the provided size.
+         *
+         * @return the index of the new slab.
+         */
+        std::size_t add_slab(std::size_t size);
+
+        /**
+         * @brief Allocates an extent in one of the slabs.
+         *
+         * @param size Size of the extent.
+         * @param slab Set to the index of the slab.
+         * @param offset Set to the offset of the extent in the slab.
+         *
+         * @return false if no slab has a free extent large enough.
+         */
+        bool allocate(std::size_t size, std::size_t& slab, std::size_t& offset);
+
+        /**
+         * @brief Marks an extent as used without allocating it (e.g. when
+         * rebuilding the allocator from existing objects).
+         *
+         * @return false if the extent is not entirely free.
+         */
+        bool reserve(std::size_t slab, std::size_t offset, std::size_t size);
+
+        /**
+         * @brief Releases an extent previously allocated or reserved.
+         */
+        void release(std::size_t slab, std::size_t offset, std::size_t size);
+
+        /**
+         * @brief Stops allocating extents in a slab.
+         */
+        void retire(std::size_t slab);
+
+        /**
+         * @brief Allows allocating extents in a retired slab again.
+         */
+        void activate(std::size_t slab);
+
+        /**
+         * @brief Removes a slab, which must be empty. Its index is
+         * not reused.
+         */
+        void remove(std::size_t slab);
+
+        std::size_t num_slabs() const { return m_slabs.size(); }
+
+        bool is_active(std::size_t slab) const {
+            return m_slabs[slab].m_state == slab_state::active;
+        }
+
+        bool is_removed(std::size_t slab) const {
+            return m_slabs[slab].m_state == slab_state::removed;
+        }
+
+        std::size_t slab_size(std::size_t slab) const { return m_slabs[slab].m_size; }
+
+        std::size_t used(std::size_t slab) const { return m_slabs[slab].m_used; }
+
+        /**
+         * @brief Active slabs whose fraction of used space is below the
+         * threshold, and whose content would fit in the free space of the
+         * active slabs that are above it (the content of the returned
+         * slabs fits in this space altogether, emptiest slabs being
+         * picked first). Empty slabs are included.
+         */
+        std::vector<std::size_t> sparse_slabs(double threshold) const;
+
+    private:
+
+        enum class slab_state { active, retired, removed };
+
+        struct slab {
+            std::size_t                        m_size = 0;
+            std::size_t                        m_used = 0;
+            slab_state                         m_state = slab_state::active;
+            std::map<std::size_t, std::size_t> m_free; // offset -> size
+        };
+
+        std::size_t       m_alignment;
+        std::vector<slab> m_slabs;
+
+        std::size_t _align(std::size_t size) const {
+            return (size + m_alignment - 1) / m_alignment * m_alignment;
+        }
+};
+
+}
+
+#endif
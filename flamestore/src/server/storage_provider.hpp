@@ -0,0 +1,219 @@
+#ifndef __FLAMESTORE_STORAGE_PROVIDER_HPP
+#define __FLAMESTORE_STORAGE_PROVIDER_HPP
+
+#include <thallium.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sys/statvfs.h>
+#include <spdlog/spdlog.h>
+#include <bake-client.hpp>
+#include "server/storage_stats.hpp"
+
+namespace flamestore {
+
+namespace tl = thallium;
+
+/**
+ * @brief Provider running on each StorageServer that keeps track of the
+ * load of its Bake targets and reports it to the master, both on request
+ * (flamestore_storage_stats) and periodically (flamestore_storage_report,
+ * see start_reporting).
+ */
+class StorageProvider : public tl::provider<StorageProvider> {
+
+    private:
+
+    struct target_load {
+        std::atomic<uint64_t> m_inflight{0};
+        std::atomic<uint32_t> m_queue_depth{0};
+        std::atomic<uint32_t> m_latency_us{0};
+        std::atomic<uint64_t> m_operations{0};
+    };
+
+    spdlog::logger*                           m_logger = nullptr;
+    std::vector<bake::target>                 m_targets; // in probe order
+    std::vector<std::string>                  m_paths;
+    std::vector<target_stats>                 m_static_stats;
+    std::vector<std::unique_ptr<target_load>> m_loads;
+    tl::remote_procedure                      m_rpc_report;
+    tl::mutex                                 m_report_mutex;
+    tl::condition_variable                    m_report_cv;
+    bool                                      m_stop_reporting = false;
+    tl::managed<tl::thread>                   m_reporter;
+    bool                                      m_reporting = false;
+
+    void on_stats(const tl::request& req) {
+        req.respond(report().m_targets);
+    }
+
+    target_load* _load_of(const bake::target& target) {
+        for(std::size_t i = 0; i < m_targets.size(); i++)
+            if(std::memcmp(&m_targets[i], &target, sizeof(target)) == 0)
+                return m_loads[i].get();
+        return nullptr;
+    }
+
+    public:
+
+    /**
+     * @brief Accounts for an operation on a target for the
+     * duration of a scope (see track).
+     */
+    class operation {
+
+        target_load*                          m_load;
+        std::size_t                           m_size;
+        std::chrono::steady_clock::time_point m_start;
+
+        public:
+
+        operation(target_load* load, std::size_t size)
+        : m_load(load)
+        , m_size(size)
+        , m_start(std::chrono::steady_clock::now()) {
+            if(!m_load) return;
+            m_load->m_inflight    += m_size;
+            m_load->m_queue_depth += 1;
+        }
+
+        operation(operation&& other)
+        : m_load(other.m_load)
+        , m_size(other.m_size)
+        , m_start(other.m_start) {
+            other.m_load = nullptr;
+        }
+
+        operation(const operation&) = delete;
+        operation& operator=(const operation&) = delete;
+
+        ~operation() {
+            if(!m_load) return;
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - m_start).count();
+            // exponential moving average with a weight of 1/8,
+            // concurrent updates may lose a sample
+            uint32_t old = m_load->m_latency_us;
+            m_load->m_latency_us   = (uint32_t)((7*(uint64_t)old + (uint64_t)us) / 8);
+            m_load->m_inflight    -= m_size;
+            m_load->m_queue_depth -= 1;
+            m_load->m_operations  += 1;
+        }
+    };
+
+    /**
+     * @brief Constructor.
+     *
+     * @param engine Thallium engine
+     * @param logger Logger
+     * @param targets Bake targets, in probe order
+     * @param paths Paths of the targets
+     * @param stats Static statistics (capacity) of the targets
+     * @param provider_id provider id
+     */
+    StorageProvider(tl::engine& engine, spdlog::logger* logger,
+            const std::vector<bake::target>& targets,
+            const std::vector<std::string>& paths,
+            const std::vector<target_stats>& stats,
+            uint16_t provider_id = 0)
+    : tl::provider<StorageProvider>(engine, provider_id)
+    , m_logger(logger)
+    , m_targets(targets)
+    , m_paths(paths)
+    , m_static_stats(stats)
+    , m_rpc_report(engine.define("flamestore_storage_report").disable_response()) {
+        for(std::size_t i = 0; i < m_targets.size(); i++)
+            m_loads.push_back(std::make_unique<target_load>());
+        m_logger->debug("Registering RPCs on StorageProvider with provider id {}", provider_id);
+        define("flamestore_storage_stats", &StorageProvider::on_stats);
+    }
+
+    /**
+     * @brief Destructor.
+     */
+    ~StorageProvider() {
+        stop_reporting();
+        m_logger->debug("Destroying StorageProvider");
+    }
+
+    /**
+     * @brief Returns an object accounting for an operation of
+     * the provided size on a target until it is destroyed.
+     */
+    inline operation track(const bake::target& target, std::size_t size) {
+        return operation(_load_of(target), size);
+    }
+
+    /**
+     * @brief Builds the current report.
+     */
+    storage_report report() {
+        storage_report r;
+        r.m_addr    = get_engine().self();
+        r.m_pending = get_engine().get_handler_pool().total_size();
+        r.m_targets = m_static_stats;
+        for(std::size_t i = 0; i < r.m_targets.size(); i++) {
+            auto& t = r.m_targets[i];
+            struct statvfs st;
+            if(i < m_paths.size() && statvfs(m_paths[i].c_str(), &st) == 0)
+                t.m_device_free = (uint64_t)st.f_bavail * st.f_frsize;
+            t.m_inflight    = m_loads[i]->m_inflight;
+            t.m_queue_depth = m_loads[i]->m_queue_depth;
+            t.m_latency_us  = m_loads[i]->m_latency_us;
+            t.m_operations  = m_loads[i]->m_operations;
+        }
+        return r;
+    }
+
+    /**
+     * @brief Starts a ULT pushing a report to the master every period_ms
+     * milliseconds. Failures (e.g. the master is not up yet) are ignored,
+     * the master simply keeps using the last report it received.
+     */
+    void start_reporting(const tl::provider_handle& master, uint64_t period_ms) {
+        if(period_ms == 0 || m_reporting) return;
+        m_logger->info("Reporting load to the master every {} ms", period_ms);
+        m_reporting = true;
+        m_reporter = get_engine().get_handler_pool().make_thread([this, master, period_ms]() {
+            std::unique_lock<tl::mutex> lock(m_report_mutex);
+            while(!m_stop_reporting) {
+                struct timespec deadline;
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                uint64_t ns = period_ms * 1000000;
+                deadline.tv_sec  += (deadline.tv_nsec + ns) / 1000000000;
+                deadline.tv_nsec  = (deadline.tv_nsec + ns) % 1000000000;
+                while(!m_stop_reporting && m_report_cv.wait_until(lock, &deadline));
+                if(m_stop_reporting) break;
+                lock.unlock();
+                try {
+                    m_rpc_report.on(master)(report());
+                } catch(const tl::exception& ex) {
+                    m_logger->debug("Could not send report to master: {}", ex.what());
+                }
+                lock.lock();
+            }
+        });
+    }
+
+    /**
+     * @brief Stops the reporting ULT, if any.
+     */
+    void stop_reporting() {
+        if(!m_reporting) return;
+        {
+            std::lock_guard<tl::mutex> lock(m_report_mutex);
+            m_stop_reporting = true;
+            m_report_cv.notify_one();
+        }
+        m_reporter->join();
+        m_reporting = false;
+    }
+};
+
+}
+
+#endif
@@ -1,4 +1,8 @@
 #include "server/storage_server.hpp"
+#include <sys/stat.h>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
 
 namespace flamestore {
 
@@ -11,6 +15,7 @@ StorageServer::StorageServer(pymargo_instance_id mid,
            const std::string& logfile, int loglevel,
            const backend_config_t& backend_config)
 : m_engine(CAPSULE2MID(mid))
+, m_bake_client(m_engine.get_margo_instance())
 , m_workspace_path(workspace_path) {
     // Setting up logging
     if(logfile.size() != 0) {
@@ -24,24 +29,43 @@ StorageServer::StorageServer(pymargo_instance_id mid,
     m_logger->set_level(static_cast<spdlog::level::level_enum>(loglevel));
     m_logger->info("Initializing StorageProvider at address {}", (std::string)(m_engine.self()));
     m_logger->info("Workspace is {}", m_workspace_path);
-    // Initialize Bake
+    // Initialize Bake (storage-path is a comma-separated list of
+    // targets, typically one per storage device of the node)
     auto it = backend_config.find("storage-path");
     if(it == backend_config.end()) {
         m_logger->critical("Path not provided for Bake target");
         throw std::runtime_error("Path not provided for Bake target");
     }
-    std::string target_path = it->second;
-    _init_bake(target_path);
+    std::vector<std::string> target_paths;
+    {
+        std::stringstream ss(it->second);
+        std::string path;
+        while(std::getline(ss, path, ','))
+            if(!path.empty()) target_paths.push_back(path);
+    }
+    if(target_paths.empty()) {
+        m_logger->critical("Path not provided for Bake target");
+        throw std::runtime_error("Path not provided for Bake target");
+    }
+    _init_bake(target_paths);
+    // Exposing target statistics to the master
+    _init_provider(backend_config);
+    // Persisting regions on behalf of the master
+    _init_persist_rpc();
+    _init_copy_rpc();
     // Initializing SSG
     _init_ssg();
     // Setting up the finalize callbacks
     m_engine.push_prefinalize_callback([this]() {
             m_logger->debug("Pre-finalizing");
+            m_provider->stop_reporting();
+            _drain();
             _finalize_ssg();
             m_logger->debug("Done finalizing SSG");
         });
     m_engine.push_finalize_callback([this]() {
             m_logger->debug("Finalizing...");
+            m_provider.reset();
             m_logger->debug("StorageProvider destroyed");
         });
     m_engine.enable_remote_shutdown();
@@ -51,9 +75,9 @@ StorageServer::~StorageServer() {
     m_logger->debug("Destroying StorageServer instance");
 }
 
-void StorageServer::_init_bake(const std::string& target_path) {
+void StorageServer::_init_bake(const std::vector<std::string>& target_paths) {
     // Initializing Bake provider
-    m_logger->info("Initializing Bake with target {}", target_path);
+    m_logger->info("Initializing Bake with {} target(s)", target_paths.size());
     try {
         m_bake_provider = bake::provider::create(m_engine.get_margo_instance());
     } catch(const bake::exception& ex) {
@@ -61,13 +85,176 @@ void StorageServer::_init_bake(const std::string& target_path) {
         throw std::runtime_error("Could not create Bake provider");
     }
     m_logger->debug("Bake provider correctly created");
+    struct added_target {
+        bake::target m_target;
+        std::string  m_path;
+        target_stats m_stats;
+    };
+    std::vector<added_target> added;
+    for(const auto& target_path : target_paths) {
+        m_logger->info("Adding Bake target {}", target_path);
+        bake::target target;
+        try {
+            target = m_bake_provider->add_storage_target(target_path);
+        } catch(const bake::exception& ex) {
+            m_logger->critical("Could not add Bake storage target {} (Bake exception: {})",
+                    target_path, ex.what());
+            throw std::runtime_error("Could not add Bake storage target");
+        }
+        m_logger->debug("Bake target correctly added to provider");
+        target_stats stats;
+        struct stat st;
+        if(stat(target_path.c_str(), &st) == 0) {
+            stats.m_capacity = st.st_size;
+        } else {
+            m_logger->warn("Could not stat {}, capacity will be reported as unknown", target_path);
+        }
+        added.push_back({ target, target_path, stats });
+    }
+    // the master matches statistics with targets by their position in
+    // the list returned by probe, which follows the provider's order
+    // rather than the order in which the targets were added
+    for(const auto& target : m_bake_provider->list_targets()) {
+        auto match = std::find_if(added.begin(), added.end(),
+            [&target](const added_target& a) {
+                return std::memcmp(&a.m_target, &target, sizeof(target)) == 0;
+            });
+        m_targets.push_back(target);
+        m_target_paths.push_back(match != added.end() ? match->m_path : std::string());
+        m_target_stats.push_back(match != added.end() ? match->m_stats : target_stats());
+    }
+}
+
+void StorageServer::_init_provider(const backend_config_t& backend_config) {
+    m_logger->debug("Creating StorageProvider");
+    m_provider = std::make_unique<StorageProvider>(m_engine, m_logger.get(),
+            m_targets, m_target_paths, m_target_stats);
+    uint64_t period_ms = 1000;
+    auto it = backend_config.find("report-period-ms");
+    if(it != backend_config.end())
+        period_ms = std::stoul(it->second);
+    if(period_ms == 0) return;
+    std::string master_addr;
+    if(!_read_master_address(master_addr)) {
+        m_logger->warn("Could not read master address, load will only be reported on request");
+        return;
+    }
     try {
-        m_bake_provider->add_storage_target(target_path);
-    } catch(const bake::exception& ex) {
-        m_logger->critical("Could not add Bake storage target (Bake exception: {})", ex.what());
-        throw std::runtime_error("Could not add Bake storage target");
+        m_provider->start_reporting(tl::provider_handle(m_engine.lookup(master_addr), 0), period_ms);
+    } catch(const tl::exception& ex) {
+        m_logger->warn("Could not look up master, load will only be reported on request: {}", ex.what());
+    }
+}
+
+bool StorageServer::_read_master_address(std::string& master_addr) {
+    std::string filename = m_workspace_path + "/.flamestore/master";
+    std::ifstream f(filename.c_str());
+    if(!(f >> master_addr)) {
+        m_logger->warn("Could not read master address from {}", filename);
+        return false;
     }
-    m_logger->debug("Bake target correctly added to provider");
+    return true;
+}
+
+void StorageServer::_init_persist_rpc() {
+    m_logger->debug("Registering flamestore_persist_batch RPC");
+    tl::endpoint self = m_engine.self();
+    m_bake_self = bake::provider_handle(m_bake_client, self.get_addr());
+    m_engine.define("flamestore_persist_batch",
+        [this](const tl::request& req, const std::vector<persist_request>& batch) {
+            // requests for overlapping or adjacent ranges of a same region
+            // (e.g. the stripes of a model packed in a slab, or a replica
+            // and its commit records) are persisted with a single call
+            auto region_key = [](const persist_request& p) {
+                std::string key(reinterpret_cast<const char*>(&p.m_target), sizeof(p.m_target));
+                key.append(reinterpret_cast<const char*>(&p.m_region), sizeof(p.m_region));
+                return key;
+            };
+            std::vector<std::string> keys(batch.size());
+            std::vector<std::size_t> order(batch.size());
+            for(std::size_t i = 0; i < batch.size(); i++) {
+                keys[i]  = region_key(batch[i]);
+                order[i] = i;
+            }
+            std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+                if(keys[a] != keys[b]) return keys[a] < keys[b];
+                return batch[a].m_offset < batch[b].m_offset;
+            });
+            std::vector<int32_t> result(batch.size(), 0);
+            for(std::size_t first = 0; first < order.size();) {
+                const auto& p = batch[order[first]];
+                uint64_t end = p.m_offset + p.m_size;
+                std::size_t last = first + 1;
+                while(last < order.size() && keys[order[last]] == keys[order[first]]
+                   && batch[order[last]].m_offset <= end) {
+                    end = std::max(end, batch[order[last]].m_offset + batch[order[last]].m_size);
+                    last += 1;
+                }
+                auto op = m_provider->track(p.m_target, end - p.m_offset);
+                try {
+                    m_bake_client.persist(m_bake_self, p.m_target, p.m_region, p.m_offset, end - p.m_offset);
+                } catch(const bake::exception& ex) {
+                    m_logger->error("Could not persist region (Bake exception: {})", ex.what());
+                    for(std::size_t i = first; i < last; i++)
+                        result[order[i]] = ex.error() ? ex.error() : -1;
+                }
+                first = last;
+            }
+            req.respond(result);
+        });
+}
+
+void StorageServer::_init_copy_rpc() {
+    m_logger->debug("Registering flamestore_copy_chunk RPC");
+    m_engine.define("flamestore_copy_chunk",
+        [this](const tl::request& req, const copy_request& c) {
+            std::vector<int32_t> result(c.m_destinations.size(), 0);
+            auto op = m_provider->track(c.m_src_target, c.m_size);
+            std::vector<char> buffer(c.m_size);
+            try {
+                auto n = m_bake_client.read(m_bake_self, c.m_src_target, c.m_src_region,
+                        c.m_offset, buffer.data(), c.m_size);
+                if(n != c.m_size)
+                    throw std::runtime_error("Short read from Bake region");
+            } catch(const bake::exception& ex) {
+                m_logger->error("Could not read chunk (Bake exception: {})", ex.what());
+                std::fill(result.begin(), result.end(), ex.error() ? ex.error() : -1);
+                req.respond(result);
+                return;
+            } catch(const std::exception& ex) {
+                m_logger->error("Could not read chunk: {}", ex.what());
+                std::fill(result.begin(), result.end(), -1);
+                req.respond(result);
+                return;
+            }
+            auto copy = [this, &c, &buffer, &result](std::size_t i) {
+                const auto& d = c.m_destinations[i];
+                try {
+                    bake::provider_handle dst(m_bake_client, d.m_addr.c_str(), d.m_provider_id);
+                    m_bake_client.write(dst, d.m_target, d.m_region,
+                            d.m_offset, buffer.data(), c.m_size);
+                    m_bake_client.persist(dst, d.m_target, d.m_region, d.m_offset, c.m_size);
+                } catch(const bake::exception& ex) {
+                    m_logger->error("Could not copy chunk to {} (Bake exception: {})", d.m_addr, ex.what());
+                    result[i] = ex.error() ? ex.error() : -1;
+                } catch(const std::exception& ex) {
+                    // e.g. a Thallium exception if the destination's address cannot be resolved
+                    m_logger->error("Could not copy chunk to {}: {}", d.m_addr, ex.what());
+                    result[i] = -1;
+                }
+            };
+            if(c.m_destinations.size() == 1) {
+                copy(0);
+            } else {
+                std::vector<tl::managed<tl::thread>> ults;
+                ults.reserve(c.m_destinations.size());
+                for(std::size_t i = 0; i < c.m_destinations.size(); i++)
+                    ults.push_back(tl::xstream::self().make_thread([&copy, i]() { copy(i); }));
+                for(auto& ult : ults)
+                    ult->join();
+            }
+            req.respond(result);
+        });
 }
 
 void StorageServer::_init_ssg() {
@@ -121,6 +308,28 @@ void StorageServer::_init_ssg() {
     }
 }
 
+void StorageServer::_drain() {
+    if(m_master_gone) return;
+    std::string master_addr;
+    if(!_read_master_address(master_addr)) {
+        m_logger->warn("Leaving without draining");
+        return;
+    }
+    m_logger->info("Asking master to move models away from this storage server");
+    try {
+        auto rpc = m_engine.define("flamestore_drain_worker");
+        tl::provider_handle master(m_engine.lookup(master_addr), 0);
+        Status status = rpc.on(master)((std::string)m_engine.self());
+        if(status.m_code != FLAMESTORE_OK) {
+            m_logger->error("Master could not drain this storage server: {}", status.m_message);
+        } else {
+            m_logger->info("Storage server drained");
+        }
+    } catch(const tl::exception& ex) {
+        m_logger->error("Could not contact master to drain storage server: {}", ex.what());
+    }
+}
+
 void StorageServer::_finalize_ssg() {
     m_logger->debug("Leaving SSG group");
     int ret = ssg_group_leave(m_ssg_gid);
@@ -144,6 +353,7 @@ void StorageServer::_ssg_membership_update(void* arg,
     || update_type == SSG_MEMBER_DIED) {
         if(member_id == server->m_master_member_id) {
             server->m_logger->error("Master abandoned its workers, shutting down, good bye cruel world");
+            server->m_master_gone = true;
             // the reason we spawn a ULT to finalize is because we don't want to
             // finalize SSG from inside the membership callback
             tl::xstream::self().make_thread([server]() {
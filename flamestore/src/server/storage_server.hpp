@@ -12,10 +12,15 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <ssg.h>
 #include <bake-server.hpp>
+#include <bake-client.hpp>
 #include "common/common.hpp"
 #include "common/status.hpp"
 #include "server/server_context.hpp"
 #include "server/backend.hpp"
+#include "server/storage_stats.hpp"
+#include "server/storage_provider.hpp"
+#include "server/persist_request.hpp"
+#include "server/copy_request.hpp"
 
 namespace flamestore {
 
@@ -27,10 +32,17 @@ class StorageServer {
     tl::engine                      m_engine;
     std::unique_ptr<spdlog::logger> m_logger;
     bake::provider*                 m_bake_provider;
+    bake::client                    m_bake_client;
+    bake::provider_handle           m_bake_self;
+    std::vector<bake::target>       m_targets;      // in probe order
+    std::vector<std::string>        m_target_paths; // in probe order
+    std::vector<target_stats>       m_target_stats;
+    std::unique_ptr<StorageProvider> m_provider;
     ServerContext                   m_server_context;
     std::string                     m_workspace_path;
     ssg_group_id_t                  m_ssg_gid;
     ssg_member_id_t                 m_master_member_id;
+    bool                            m_master_gone = false;
 
     public:
 
@@ -46,10 +58,20 @@ class StorageServer {
 
     private:
 
-    void _init_bake(const std::string& target_path);
+    void _init_bake(const std::vector<std::string>& target_paths);
+
+    void _init_provider(const backend_config_t& backend_config);
+
+    bool _read_master_address(std::string& master_addr);
+
+    void _init_persist_rpc();
+
+    void _init_copy_rpc();
 
     void _init_ssg();
 
+    void _drain();
+
     void _finalize_ssg();
 
     static void _ssg_membership_update(void* arg,
@@ -0,0 +1,58 @@
+#ifndef __FLAMESTORE_STORAGE_STATS_H
+#define __FLAMESTORE_STORAGE_STATS_H
+
+#include <cstdint>
+#include <string>
+#include <thallium/serialization/stl/string.hpp>
+#include <thallium/serialization/stl/vector.hpp>
+
+namespace flamestore {
+
+/**
+ * @brief Statistics reported by a StorageServer for each of its
+ * Bake targets, in the order in which they are returned by probe.
+ * The load counters only cover the operations that go through the
+ * StorageServer (persist batches and chunk copies), not the
+ * transfers issued directly to Bake.
+ */
+struct target_stats {
+
+    uint64_t m_capacity    = 0; // size of the target, 0 if unknown
+    uint64_t m_device_free = 0; // free space on the target's file system, 0 if unknown
+    uint64_t m_inflight    = 0; // bytes of the operations in progress
+    uint32_t m_queue_depth = 0; // number of operations in progress
+    uint32_t m_latency_us  = 0; // moving average of the duration of an operation
+    uint64_t m_operations  = 0; // operations completed so far
+
+    template<typename A>
+    void serialize(A& ar) {
+        ar & m_capacity;
+        ar & m_device_free;
+        ar & m_inflight;
+        ar & m_queue_depth;
+        ar & m_latency_us;
+        ar & m_operations;
+    }
+};
+
+/**
+ * @brief Report pushed periodically by a StorageServer to the
+ * master with the flamestore_storage_report RPC.
+ */
+struct storage_report {
+
+    std::string               m_addr;        // address of the StorageServer
+    uint64_t                  m_pending = 0; // ULTs waiting in its handler pool
+    std::vector<target_stats> m_targets;     // in probe order
+
+    template<typename A>
+    void serialize(A& ar) {
+        ar & m_addr;
+        ar & m_pending;
+        ar & m_targets;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include "server/string_pool.hpp"
+#include <algorithm>
+#include "common/content_key.hpp"
+
+namespace flamestore {
+
+StringPool::handle StringPool::intern(const std::string& str) {
+    auto key = content_key(str);
+    std::lock_guard<std::mutex> guard(m_mutex);
+    auto& entry = m_strings[key];
+    auto result = entry.lock();
+    if(result) {
+        // a key collision leaves the string out of the pool
+        if(*result != str)
+            return std::make_shared<const std::string>(str);
+        return result;
+    }
+    result = std::make_shared<const std::string>(str);
+    entry = result;
+    if(m_strings.size() >= m_sweep_at)
+        _sweep();
+    return result;
+}
+
+StringPool::handle StringPool::find(const std::string& key) const {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    auto it = m_strings.find(key);
+    if(it == m_strings.end()) return nullptr;
+    return it->second.lock();
+}
+
+void StringPool::stats(std::size_t& count, std::size_t& bytes) const {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    count = 0;
+    bytes = 0;
+    for(const auto& p : m_strings) {
+        auto str = p.second.lock();
+        if(!str) continue;
+        count += 1;
+        bytes += str->size();
+    }
+}
+
+void StringPool::_sweep() {
+    for(auto it = m_strings.begin(); it != m_strings.end();) {
+        if(it->second.expired()) it = m_strings.erase(it);
+        else ++it;
+    }
+    // sweeping again once the pool has doubled keeps interning amortized O(1)
+    m_sweep_at = std::max<std::size_t>(64, 2*m_strings.size());
+}
+
+}
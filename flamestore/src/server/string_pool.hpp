@@ -0,0 +1,108 @@
+#ifndef __FLAMESTORE_STRING_POOL_H
+#define __FLAMESTORE_STRING_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace flamestore {
+
+/**
+ * @brief Pool of immutable strings shared by content. Models of a
+ * hyperparameter sweep usually have the same configuration and
+ * signature, which the pool stores once. Strings are reference counted
+ * (shared_ptr) and the pool only keeps weak references to them, so a
+ * string is freed once no model uses it anymore.
+ *
+ * Strings are indexed by their content_key, which clients can send
+ * instead of a configuration the server already knows.
+ *
+ * This class is thread safe and does not depend on Argobots (its lock
+ * is never held across a blocking call).
+ */
+class StringPool {
+
+    public:
+
+        using handle = std::shared_ptr<const std::string>;
+
+        StringPool() = default;
+        StringPool(const StringPool&)            = delete;
+        StringPool& operator=(const StringPool&) = delete;
+
+        /**
+         * @brief Returns the pooled string with the provided content,
+         * adding it to the pool if needed.
+         */
+        handle intern(const std::string& str);
+
+        /**
+         * @brief Returns the pooled string with the provided content_key,
+         * or nullptr if the pool does not have it.
+         */
+        handle find(const std::string& key) const;
+
+        /**
+         * @brief Number of strings in the pool and their total size.
+         */
+        void stats(std::size_t& count, std::size_t& bytes) const;
+
+    private:
+
+        mutable std::mutex                                   m_mutex;
+        std::unordered_map<std::string, std::weak_ptr<const std::string>> m_strings;
+        std::size_t                                          m_sweep_at = 64;
+
+        /**
+         * @brief Removes the entries of strings that have been freed.
+         * Must be called with the mutex locked.
+         */
+        void _sweep();
+};
+
+/**
+ * @brief String stored in a StringPool (or a standalone string if it
+ * was not interned), usable as a const std::string.
+ */
+class interned_string {
+
+    public:
+
+        interned_string() = default;
+
+        interned_string(StringPool::handle str)
+        : m_str(std::move(str)) {}
+
+        const std::string& str() const {
+            static const std::string empty;
+            return m_str ? *m_str : empty;
+        }
+
+        operator const std::string&() const {
+            return str();
+        }
+
+        std::size_t size() const { return str().size(); }
+
+        bool empty() const { return str().empty(); }
+
+        const StringPool::handle& handle() const { return m_str; }
+
+    private:
+
+        StringPool::handle m_str;
+};
+
+inline bool operator==(const interned_string& lhs, const std::string& rhs) {
+    return lhs.str() == rhs;
+}
+
+inline bool operator!=(const interned_string& lhs, const std::string& rhs) {
+    return lhs.str() != rhs;
+}
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+#include "server/thread_pools.hpp"
+#include <json/json.h>
+
+namespace flamestore {
+
+ThreadPools::ThreadPools(tl::engine& engine, spdlog::logger* logger,
+        const std::string& config)
+: m_engine(engine)
+, m_logger(logger) {
+    Json::Value root;
+    if(!config.empty()) {
+        Json::CharReaderBuilder builder;
+        std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        std::string errors;
+        if(!reader->parse(config.data(), config.data() + config.size(), &root, &errors)
+        || !(root.isObject() || root.isNull())) {
+            m_logger->critical("Invalid threading configuration: {}", errors);
+            throw std::runtime_error("Invalid threading configuration");
+        }
+    }
+    auto setup = [this, &root](group& g, const char* name) {
+        const auto& jg = root[name];
+        std::vector<int> affinity;
+        for(const auto& cpu : jg["affinity"])
+            affinity.push_back(cpu.asInt());
+        _setup(g, name, jg["xstreams"].asUInt(), affinity, jg["pin"].asBool());
+    };
+    setup(m_metadata, "metadata");
+    setup(m_data,     "data");
+    setup(m_io,       "io");
+}
+
+ThreadPools::~ThreadPools() {
+    stop();
+}
+
+void ThreadPools::_setup(group& g, const std::string& name,
+        unsigned num_xstreams, const std::vector<int>& affinity, bool pin) {
+    if(num_xstreams == 0) {
+        g.m_pool = m_engine.get_handler_pool();
+        m_logger->info("{} pool: handler pool", name);
+        return;
+    }
+    g.m_owned_pool = tl::pool::create(tl::pool::access::mpmc, tl::pool::kind::fifo_wait);
+    g.m_pool = *g.m_owned_pool;
+    for(unsigned i = 0; i < num_xstreams; i++) {
+        g.m_xstreams.push_back(tl::xstream::create(tl::scheduler::predef::basic_wait, *g.m_owned_pool));
+        if(affinity.empty()) continue;
+        try {
+            if(pin) g.m_xstreams.back()->set_cpubind(affinity[i % affinity.size()]);
+            else    g.m_xstreams.back()->set_affinity(affinity);
+        } catch(const tl::exception& ex) {
+            // Argobots may be built without affinity support
+            m_logger->warn("Could not set the affinity of {} xstream {}: {}", name, i, ex.what());
+        }
+    }
+    m_logger->info("{} pool: {} xstream(s){}", name, num_xstreams,
+            affinity.empty() ? "" : (pin ? ", pinned" : ", with affinity"));
+}
+
+void ThreadPools::stop() {
+    for(auto g : { &m_metadata, &m_data, &m_io }) {
+        for(auto& es : g->m_xstreams)
+            es->join();
+        g->m_xstreams.clear();
+    }
+}
+
+}
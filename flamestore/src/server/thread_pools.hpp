@@ -0,0 +1,80 @@
+#ifndef __FLAMESTORE_THREAD_POOLS_H
+#define __FLAMESTORE_THREAD_POOLS_H
+
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include <thallium.hpp>
+
+namespace flamestore {
+
+namespace tl = thallium;
+
+/**
+ * @brief Threading model of the master. The RPCs of the MasterProvider
+ * are split into metadata RPCs (register, reload, list, etc.) and data
+ * RPCs (model reads and writes), and the backend runs its background
+ * I/O (e.g. draining the burst buffer, copying duplicated models) in
+ * a third pool, so that large checkpoints do not delay metadata
+ * requests. Each group can have its own pool and execution streams,
+ * configured in JSON, e.g.:
+ *
+ *   {
+ *     "metadata": { "xstreams": 1, "affinity": [0] },
+ *     "data":     { "xstreams": 4, "affinity": [1, 2, 3, 4], "pin": true },
+ *     "io":       { "xstreams": 2, "affinity": [5, 6] }
+ *   }
+ *
+ * "affinity" is the set of CPUs the execution streams of the group may
+ * run on; with "pin", each execution stream is bound to a single CPU of
+ * the set instead (round robin). A group with no execution stream (the
+ * default) uses the engine's handler pool, as do all the groups if the
+ * configuration is empty.
+ */
+class ThreadPools {
+
+    public:
+
+        ThreadPools(tl::engine& engine, spdlog::logger* logger,
+                const std::string& config);
+
+        ThreadPools(const ThreadPools&)            = delete;
+        ThreadPools(ThreadPools&&)                 = delete;
+        ThreadPools& operator=(const ThreadPools&) = delete;
+        ThreadPools& operator=(ThreadPools&&)      = delete;
+
+        ~ThreadPools();
+
+        const tl::pool& metadata_pool() const { return m_metadata.m_pool; }
+
+        const tl::pool& data_pool() const { return m_data.m_pool; }
+
+        const tl::pool& io_pool() const { return m_io.m_pool; }
+
+        /**
+         * @brief Joins the execution streams. Must be called once
+         * nothing can be submitted to the pools anymore.
+         */
+        void stop();
+
+    private:
+
+        struct group {
+            tl::pool                              m_pool;
+            tl::managed<tl::pool>                 m_owned_pool;
+            std::vector<tl::managed<tl::xstream>> m_xstreams;
+        };
+
+        tl::engine&     m_engine;
+        spdlog::logger* m_logger;
+        group           m_metadata;
+        group           m_data;
+        group           m_io;
+
+        void _setup(group& g, const std::string& name,
+                unsigned num_xstreams, const std::vector<int>& affinity, bool pin);
+};
+
+}
+
+#endif
@@ -1,3 +1,5 @@
+import json
+import zlib
 
 def _hash(arr):
     x = 0x345678
@@ -24,3 +26,30 @@ def _compute_signature(model, optimizer=None):
             for d in w.shape:
                 arr.append(int(d))
     return str(_hash(arr))
+
+
+def _pack_config(config):
+    """Serializes the configuration of a model (a dict holding the
+    model's configuration and its optimizer's) and compresses it.
+    """
+    data = json.dumps(config, separators=(',', ':')).encode('utf-8')
+    return zlib.compress(data)
+
+
+def _unpack_config(blob):
+    """Decodes a configuration produced by _pack_config, or stored by
+    older clients as a JSON string in which the model and optimizer
+    configurations were themselves JSON strings.
+
+    Returns:
+        the model configuration as a JSON string, and the optimizer
+        configuration as a dict (or None).
+    """
+    if(blob[:1] == b'{'):
+        config = json.loads(blob.decode('utf-8'))
+        optimizer_config = config['optimizer']
+        if(optimizer_config is not None):
+            optimizer_config = json.loads(optimizer_config)
+        return config['model'], optimizer_config
+    config = json.loads(zlib.decompress(blob).decode('utf-8'))
+    return json.dumps(config['model']), config['optimizer']
@@ -79,18 +79,21 @@ flamestore_server_module_libraries    = thallium['libraries']        \
                                       + bake_client['libraries']     \
                                       + bake_server['libraries']     \
                                       + sdskv_client['libraries']    \
+                                      + sdskv_server['libraries']    \
                                       + ssg['libraries']             \
                                       + jsoncpp['libraries']
 flamestore_server_module_library_dirs = thallium['library_dirs']     \
                                       + bake_client['library_dirs']  \
                                       + bake_server['library_dirs']  \
                                       + sdskv_client['library_dirs'] \
+                                      + sdskv_server['library_dirs'] \
                                       + ssg['library_dirs']          \
                                       + jsoncpp['library_dirs']
 flamestore_server_module_include_dirs = thallium['include_dirs']     \
                                       + bake_client['include_dirs']  \
                                       + bake_server['include_dirs']  \
                                       + sdskv_client['include_dirs'] \
+                                      + sdskv_server['include_dirs'] \
                                       + jsoncpp['include_dirs']      \
                                       + ssg['include_dirs']          \
                                       + [ src_dir ]
@@ -98,6 +101,13 @@ flamestore_server_module = Extension('_flamestore_server',
         ['flamestore/src/server/backend.cpp',
          'flamestore/src/server/memory_backend.cpp',
          'flamestore/src/server/mochi_backend.cpp',
+         'flamestore/src/server/placement.cpp',
+         'flamestore/src/server/erasure_code.cpp',
+         'flamestore/src/server/catalog.cpp',
+         'flamestore/src/server/slab_allocator.cpp',
+         'flamestore/src/server/string_pool.cpp',
+         'flamestore/src/server/thread_pools.cpp',
+         'flamestore/src/server/scheduler.cpp',
          'flamestore/src/server/master_server.cpp',
          'flamestore/src/server/storage_server.cpp',
         # 'flamestore/src/server/mmapfs_backend.cpp',
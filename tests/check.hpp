@@ -0,0 +1,34 @@
+/*
+ * Minimal assertion macros shared by the unit tests.
+ * Each test program returns the number of failed checks.
+ */
+#ifndef __FLAMESTORE_TESTS_CHECK_H
+#define __FLAMESTORE_TESTS_CHECK_H
+
+#include <iostream>
+
+static int s_failures = 0;
+
+#define CHECK(cond) do { \
+        if(!(cond)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ \
+                      << ": check failed: " #cond << std::endl; \
+            s_failures += 1; \
+        } \
+    } while(0)
+
+#define CHECK_EQ(a, b) do { \
+        auto _a = (a); auto _b = (b); \
+        if(!(_a == _b)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ \
+                      << ": check failed: " #a " == " #b \
+                      << " (" << _a << " vs " << _b << ")" << std::endl; \
+            s_failures += 1; \
+        } \
+    } while(0)
+
+#define TEST_MAIN_END() \
+    if(s_failures) std::cerr << s_failures << " check(s) failed" << std::endl; \
+    return s_failures ? 1 : 0
+
+#endif
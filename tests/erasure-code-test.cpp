@@ -0,0 +1,98 @@
+/*
+ * Unit tests of the Reed-Solomon erasure code.
+ */
+#include <random>
+#include <algorithm>
+#include "check.hpp"
+#include "server/erasure_code.hpp"
+
+using namespace flamestore;
+
+/**
+ * @brief Reference multiplication in GF(2^8) (polynomial 0x11d).
+ */
+static uint8_t gf_mul(uint8_t a, uint8_t b) {
+    uint8_t p = 0;
+    while(b) {
+        if(b & 1) p ^= a;
+        bool carry = a & 0x80;
+        a <<= 1;
+        if(carry) a ^= 0x1d;
+        b >>= 1;
+    }
+    return p;
+}
+
+static void test_fragment_size() {
+    ErasureCode ec(4, 2);
+    CHECK_EQ(ec.data_fragments(), 4u);
+    CHECK_EQ(ec.parity_fragments(), 2u);
+    for(std::size_t size : { 0UL, 1UL, 63UL, 256UL, 257UL, 1000000UL }) {
+        auto len = ec.fragment_size(size);
+        CHECK_EQ(len % 64, 0u);
+        CHECK(4*len >= size);
+        CHECK(size == 0 || 4*(len - 64) < size);
+    }
+}
+
+static void test_mul_add_region() {
+    std::mt19937 rng(42);
+    // odd lengths exercise the tails of the vector kernels
+    for(std::size_t len : { 1UL, 15UL, 32UL, 100UL, 4096UL + 7 }) {
+        for(int c : { 0, 1, 2, 0x53, 0xff }) {
+            std::vector<uint8_t> src(len), dst(len), expected(len);
+            for(auto& b : src) b = rng();
+            for(auto& b : dst) b = rng();
+            for(std::size_t i = 0; i < len; i++)
+                expected[i] = dst[i] ^ gf_mul((uint8_t)c, src[i]);
+            ErasureCode::mul_add_region(dst.data(), src.data(), (uint8_t)c, len);
+            CHECK(dst == expected);
+        }
+    }
+}
+
+/**
+ * @brief Encodes random data, then checks that every pattern of
+ * at most m lost fragments is recovered and that losing more fails.
+ */
+static void test_roundtrip(unsigned k, unsigned m) {
+    ErasureCode ec(k, m);
+    std::mt19937 rng(k*100 + m);
+    std::size_t len = ec.fragment_size(5000);
+    std::vector<std::vector<uint8_t>> original(k + m, std::vector<uint8_t>(len));
+    for(unsigned i = 0; i < k; i++)
+        for(auto& b : original[i]) b = rng();
+    std::vector<uint8_t*> ptrs(k + m);
+    for(unsigned i = 0; i < k + m; i++) ptrs[i] = original[i].data();
+    ec.encode(ptrs.data(), ptrs.data() + k, len);
+
+    unsigned n = k + m;
+    for(unsigned mask = 0; mask < (1u << n); mask++) {
+        unsigned lost = __builtin_popcount(mask);
+        auto fragments = original;
+        std::vector<bool> available(n);
+        for(unsigned i = 0; i < n; i++) {
+            available[i] = !(mask & (1u << i));
+            if(!available[i])
+                std::fill(fragments[i].begin(), fragments[i].end(), 0xAA);
+        }
+        for(unsigned i = 0; i < n; i++) ptrs[i] = fragments[i].data();
+        bool ok = ec.decode(ptrs.data(), available, len);
+        if(lost > m) {
+            CHECK(!ok);
+            continue;
+        }
+        CHECK(ok);
+        for(unsigned i = 0; i < k; i++)
+            CHECK(fragments[i] == original[i]);
+    }
+}
+
+int main() {
+    test_fragment_size();
+    test_mul_add_region();
+    test_roundtrip(4, 2);
+    test_roundtrip(3, 3);
+    test_roundtrip(6, 1);
+    TEST_MAIN_END();
+}
@@ -0,0 +1,104 @@
+/*
+ * Unit tests of the range of a list_models query (the serialization
+ * code only needs Thallium's headers).
+ */
+#include <set>
+#include <string>
+#include <vector>
+#include "check.hpp"
+#include "common/model_listing.hpp"
+
+using namespace flamestore;
+
+/**
+ * Names of an ordered set that a query visits, as _list_page does:
+ * from first_name() until past_end(), regardless of the page size.
+ */
+static std::vector<std::string> visit(const std::set<std::string>& names, const list_query& q) {
+    std::vector<std::string> result;
+    for(auto it = names.lower_bound(q.first_name()); it != names.end(); ++it) {
+        if(q.past_end(*it)) break;
+        result.push_back(*it);
+    }
+    return result;
+}
+
+static const std::set<std::string> s_names = {
+    "a", "ab", "abc", "abd", "ac", "b", "ba", "c"
+};
+
+static void test_first_name() {
+    list_query q;
+    CHECK_EQ(q.first_name(), std::string(""));
+    q.m_prefix = "ab";
+    CHECK_EQ(q.first_name(), std::string("ab"));
+    q.m_start = "abc";
+    CHECK_EQ(q.first_name(), std::string("abc"));
+    q.m_start = "a"; // before the prefix
+    CHECK_EQ(q.first_name(), std::string("ab"));
+    // the continuation token is excluded
+    q.m_after = "abc";
+    CHECK_EQ(q.first_name(), std::string("abc") + '\0');
+    CHECK(q.first_name() > "abc");
+    CHECK(q.first_name() < "abd");
+    // a token before the range does not move its start
+    q.m_after = "a";
+    CHECK_EQ(q.first_name(), std::string("ab"));
+}
+
+static void test_past_end() {
+    list_query q;
+    CHECK(!q.past_end("anything"));
+    q.m_prefix = "ab";
+    CHECK(!q.past_end("ab"));
+    CHECK(!q.past_end("abz"));
+    CHECK(q.past_end("ac"));
+    CHECK(q.past_end("a"));
+    q.m_end = "abd";
+    CHECK(!q.past_end("abc"));
+    CHECK(q.past_end("abd"));
+    CHECK(q.past_end("abe"));
+}
+
+static void test_ranges() {
+    list_query q;
+    CHECK_EQ(visit(s_names, q).size(), s_names.size());
+    q.m_prefix = "ab";
+    auto v = visit(s_names, q);
+    CHECK_EQ(v.size(), 3u);
+    CHECK_EQ(v.front(), std::string("ab"));
+    CHECK_EQ(v.back(), std::string("abd"));
+    q.m_prefix = "";
+    q.m_start = "abd";
+    q.m_end = "b";
+    v = visit(s_names, q);
+    CHECK_EQ(v.size(), 2u);
+    CHECK_EQ(v.front(), std::string("abd"));
+    CHECK_EQ(v.back(), std::string("ac"));
+    // no name in an empty range
+    q.m_start = "b";
+    CHECK(visit(s_names, q).empty());
+}
+
+static void test_pagination() {
+    // following continuation tokens visits every name exactly once
+    list_query q;
+    q.m_prefix = "a";
+    std::vector<std::string> all;
+    while(true) {
+        auto v = visit(s_names, q);
+        if(v.empty()) break;
+        all.push_back(v.front());
+        q.m_after = v.front(); // pages of one model
+    }
+    std::vector<std::string> expected = { "a", "ab", "abc", "abd", "ac" };
+    CHECK(all == expected);
+}
+
+int main() {
+    test_first_name();
+    test_past_end();
+    test_ranges();
+    test_pagination();
+    TEST_MAIN_END();
+}
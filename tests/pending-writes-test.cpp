@@ -0,0 +1,81 @@
+/*
+ * Unit tests of the tracking of the writes of a model in progress
+ * (pending_writes): an older write is only superseded once a newer one
+ * succeeded, and is retried if the newer one fails.
+ */
+#include <memory>
+#include <thallium.hpp>
+#include "check.hpp"
+#include "server/model.hpp"
+
+using namespace flamestore;
+namespace tl = thallium;
+
+static void test_superseded_on_success() {
+    pending_writes writes;
+    pending_writes::guard older(writes, "sig");
+    pending_writes::guard newer(writes, "sig");
+    CHECK(older.check() == pending_writes::PARK);
+    CHECK(newer.check() == pending_writes::PROCEED);
+    newer.complete(true);
+    CHECK(older.wait() == pending_writes::SUPERSEDED);
+    CHECK(writes.m_entries.empty());
+}
+
+static void test_retry_on_failure() {
+    pending_writes writes;
+    pending_writes::guard oldest(writes, "sig");
+    pending_writes::guard older(writes, "sig");
+    pending_writes::guard newer(writes, "sig");
+    CHECK(oldest.check() == pending_writes::PARK);
+    CHECK(older.check() == pending_writes::PARK);
+    CHECK(newer.check() == pending_writes::PROCEED);
+    // only the newest parked write is woken up
+    newer.complete(false);
+    CHECK(older.wait() == pending_writes::RETRY);
+    CHECK(older.check() == pending_writes::PROCEED);
+    older.complete(true);
+    CHECK(oldest.wait() == pending_writes::SUPERSEDED);
+    CHECK(writes.m_entries.empty());
+}
+
+static void test_active_write_superseded() {
+    pending_writes writes;
+    pending_writes::guard older(writes, "sig");
+    pending_writes::guard newer(writes, "sig");
+    // the older write checks only after the newer one succeeded
+    CHECK(newer.check() == pending_writes::PROCEED);
+    newer.complete(true);
+    CHECK(older.check() == pending_writes::SUPERSEDED);
+    CHECK(writes.m_entries.empty());
+}
+
+static void test_guard_fails_write() {
+    pending_writes writes;
+    pending_writes::guard older(writes, "sig");
+    {
+        pending_writes::guard newer(writes, "sig");
+        CHECK(older.check() == pending_writes::PARK);
+    }
+    CHECK(older.wait() == pending_writes::RETRY);
+    CHECK(older.check() == pending_writes::PROCEED);
+}
+
+static void test_signatures_are_independent() {
+    pending_writes writes;
+    pending_writes::guard older(writes, "a");
+    pending_writes::guard newer(writes, "b");
+    CHECK(newer.check() == pending_writes::PROCEED);
+    newer.complete(true);
+    CHECK(older.check() == pending_writes::PROCEED);
+}
+
+int main() {
+    tl::abt scope;
+    test_superseded_on_success();
+    test_retry_on_failure();
+    test_active_write_superseded();
+    test_guard_fails_write();
+    test_signatures_are_independent();
+    TEST_MAIN_END();
+}
@@ -0,0 +1,159 @@
+/*
+ * Unit tests of the placement policies.
+ */
+#include <map>
+#include <set>
+#include <algorithm>
+#include "check.hpp"
+#include "server/placement.hpp"
+
+using namespace flamestore;
+
+static std::vector<placement_target> make_targets(std::size_t n, std::size_t per_server = 1) {
+    std::vector<placement_target> targets(n);
+    for(std::size_t i = 0; i < n; i++) {
+        targets[i].m_key    = "ofi+tcp://10.0.0." + std::to_string(i/per_server)
+                            + ":1234/" + std::to_string(i%per_server);
+        targets[i].m_server = i/per_server;
+    }
+    return targets;
+}
+
+static void test_unknown_policy() {
+    CHECK(!AbstractPlacementPolicy::create("no-such-policy"));
+    for(auto name : { "random", "least-loaded", "capacity-weighted", "consistent-hashing" })
+        CHECK(AbstractPlacementPolicy::create(name));
+}
+
+static void test_select_constraints() {
+    auto policy = AbstractPlacementPolicy::create("least-loaded");
+    auto targets = make_targets(6, 2); // 3 servers with 2 targets each
+    for(auto& t : targets) t.m_capacity = 100;
+    targets[0].m_allocated = 95; // too full for a 10-byte model
+    auto all = policy->select(targets, "m", 10, 6);
+    CHECK_EQ(all.size(), 5u);
+    CHECK(std::find(all.begin(), all.end(), 0u) == all.end());
+    auto distinct = policy->select(targets, "m", 10, 6, true);
+    CHECK_EQ(distinct.size(), 3u);
+    std::set<uint64_t> servers;
+    for(auto i : distinct) servers.insert(targets[i].m_server);
+    CHECK_EQ(servers.size(), 3u);
+}
+
+static void test_least_loaded_order() {
+    auto policy = AbstractPlacementPolicy::create("least-loaded");
+    auto targets = make_targets(4);
+    for(auto& t : targets) t.m_capacity = 1000;
+    targets[0].m_inflight    = 10;
+    targets[1].m_queue_depth = 3;
+    targets[2].m_allocated   = 500;
+    // target 3 is idle and empty
+    std::vector<std::size_t> order;
+    policy->rank(targets, "m", 1, order);
+    CHECK_EQ(order.size(), 4u);
+    CHECK_EQ(order[0], 3u);
+    CHECK_EQ(order[1], 2u);
+    CHECK_EQ(order[2], 1u);
+    CHECK_EQ(order[3], 0u);
+}
+
+static void test_least_loaded_tie_breaks() {
+    auto policy = AbstractPlacementPolicy::create("least-loaded");
+    auto targets = make_targets(4);
+    for(auto& t : targets) t.m_capacity = 1000;
+    targets[0].m_operations  = 1;
+    targets[1].m_queue_depth = 1;
+    targets[2].m_latency_us  = 500;
+    targets[3].m_latency_us  = 100;
+    std::vector<std::size_t> order;
+    policy->rank(targets, "m", 1, order);
+    CHECK_EQ(order.size(), 4u);
+    CHECK_EQ(order[0], 3u);
+    CHECK_EQ(order[1], 2u);
+    CHECK_EQ(order[2], 1u);
+    CHECK_EQ(order[3], 0u);
+}
+
+static void test_capacity_weighted_distribution() {
+    auto policy = AbstractPlacementPolicy::create("capacity-weighted");
+    auto targets = make_targets(2);
+    // weights in bytes, as the backend passes them
+    targets[0].m_capacity = 3UL << 52;
+    targets[1].m_capacity = 1UL << 52;
+    std::size_t first = 0, trials = 20000;
+    std::vector<std::size_t> order;
+    for(std::size_t i = 0; i < trials; i++) {
+        policy->rank(targets, "m", 1, order);
+        if(order[0] == 0) first += 1;
+    }
+    double ratio = (double)first / trials;
+    // target 0 has 3/4 of the free space
+    CHECK(ratio > 0.72 && ratio < 0.78);
+}
+
+static void test_capacity_weighted_full_target_last() {
+    auto policy = AbstractPlacementPolicy::create("capacity-weighted");
+    auto targets = make_targets(3);
+    for(auto& t : targets) t.m_capacity = 1UL << 30;
+    targets[1].m_allocated = 1UL << 30;
+    std::vector<std::size_t> order;
+    for(int i = 0; i < 100; i++) {
+        policy->rank(targets, "m", 1, order);
+        CHECK_EQ(order.back(), 1u);
+    }
+}
+
+static void test_consistent_hashing_stability() {
+    auto policy = AbstractPlacementPolicy::create("consistent-hashing");
+    auto targets = make_targets(8);
+    std::map<std::string, std::string> before;
+    std::vector<std::size_t> order;
+    for(int m = 0; m < 1000; m++) {
+        auto name = "model-" + std::to_string(m);
+        policy->rank(targets, name, 1, order);
+        CHECK_EQ(order.size(), targets.size());
+        before[name] = targets[order[0]].m_key;
+        // same input, same ranking
+        std::vector<std::size_t> again;
+        policy->rank(targets, name, 1, again);
+        CHECK(again == order);
+    }
+    // removing a target only moves the models that were on it
+    auto removed = targets[3].m_key;
+    targets.erase(targets.begin() + 3);
+    std::size_t moved = 0;
+    for(const auto& p : before) {
+        policy->rank(targets, p.first, 1, order);
+        auto key = targets[order[0]].m_key;
+        if(key != p.second) {
+            CHECK_EQ(p.second, removed);
+            moved += 1;
+        }
+    }
+    CHECK(moved > 0);
+}
+
+static void test_random_covers_all() {
+    auto policy = AbstractPlacementPolicy::create("random");
+    auto targets = make_targets(4);
+    std::set<std::size_t> firsts;
+    std::vector<std::size_t> order;
+    for(int i = 0; i < 200; i++) {
+        policy->rank(targets, "m", 1, order);
+        CHECK_EQ(order.size(), 4u);
+        firsts.insert(order[0]);
+    }
+    CHECK_EQ(firsts.size(), 4u);
+}
+
+int main() {
+    test_unknown_policy();
+    test_select_constraints();
+    test_least_loaded_order();
+    test_least_loaded_tie_breaks();
+    test_capacity_weighted_distribution();
+    test_capacity_weighted_full_target_last();
+    test_consistent_hashing_stability();
+    test_random_covers_all();
+    TEST_MAIN_END();
+}
@@ -0,0 +1,48 @@
+#!/bin/bash
+# Builds and runs the unit tests of the components that do not
+# need a running Mochi stack. Tests that need Thallium are only
+# built if it can be found (THALLIUM_CFLAGS/THALLIUM_LIBS).
+HERE=$(dirname $(readlink -f $0))
+SRC=$HERE/../flamestore/src
+BUILD=${BUILD:-$HERE/build}
+mkdir -p $BUILD
+failed=0
+if [ -z "$THALLIUM_CFLAGS" ] && pkg-config --exists thallium 2>/dev/null; then
+    THALLIUM_CFLAGS=$(pkg-config --cflags thallium)
+    THALLIUM_LIBS=$(pkg-config --libs thallium)
+fi
+
+run_test() {
+    local name=$1; shift
+    echo "=== $name"
+    if ! g++ -O1 -g -std=c++14 -I$SRC -I$HERE -o $BUILD/$name $HERE/$name.cpp "$@"; then
+        echo "*** $name: build failed"; failed=$((failed+1)); return
+    fi
+    if ! $BUILD/$name; then
+        echo "*** $name: FAILED"; failed=$((failed+1)); return
+    fi
+    echo "--- $name: ok"
+}
+
+run_thallium_test() {
+    local name=$1; shift
+    if [ -z "$THALLIUM_CFLAGS" ]; then
+        echo "=== $name: skipped (Thallium not found)"; return
+    fi
+    run_test $name $THALLIUM_CFLAGS "$@" $THALLIUM_LIBS
+}
+
+run_test placement-test $SRC/server/placement.cpp
+run_test erasure-code-test $SRC/server/erasure_code.cpp
+run_test slab-allocator-test $SRC/server/slab_allocator.cpp
+run_test string-pool-test $SRC/server/string_pool.cpp
+run_thallium_test model-listing-test
+run_thallium_test pending-writes-test
+run_thallium_test scheduler-test $SRC/server/scheduler.cpp \
+    $(pkg-config --cflags --libs jsoncpp 2>/dev/null || echo -ljsoncpp)
+
+if [ $failed -ne 0 ]; then
+    echo "$failed test(s) failed"
+    exit 1
+fi
+echo "All tests passed"
@@ -0,0 +1,118 @@
+/*
+ * Unit tests of the admission control of the master (weighted fair
+ * queuing of checkpoints and restores). Requests are issued by ULTs of
+ * a single execution stream, so the order in which they are admitted
+ * only depends on the scheduler.
+ */
+#include <string>
+#include <vector>
+#include <thallium.hpp>
+#include "check.hpp"
+#include "server/scheduler.hpp"
+
+using namespace flamestore;
+namespace tl = thallium;
+
+static spdlog::logger s_logger("scheduler-test");
+
+struct request {
+    std::string              m_name;
+    Scheduler::request_class m_class;
+    std::string              m_client;
+};
+
+/**
+ * Queues the requests behind one that fills the cap, in the order
+ * given, then releases the cap and returns the order of admission.
+ * Each request fills the cap as well, so they are admitted one by one.
+ */
+static std::vector<std::string> admission_order(Scheduler& scheduler,
+        const std::vector<request>& requests, std::size_t bytes) {
+    std::vector<std::string> order;
+    auto holder = scheduler.admit(Scheduler::RESTORE, "holder", bytes);
+    std::vector<tl::managed<tl::thread>> threads;
+    for(const auto& r : requests) {
+        threads.push_back(tl::xstream::self().make_thread([&scheduler, &order, &r, bytes]() {
+            auto ticket = scheduler.admit(r.m_class, r.m_client, bytes);
+            order.push_back(r.m_name);
+        }));
+        // lets the request reach the queue before the next one arrives
+        tl::thread::yield();
+    }
+    holder = Scheduler::ticket();
+    for(auto& t : threads)
+        t->join();
+    return order;
+}
+
+static void test_class_weights() {
+    Scheduler scheduler(&s_logger,
+        "{ \"max_inflight_bytes\": 1000, \"weights\": { \"restore\": 8, \"checkpoint\": 1 } }");
+    // checkpoints finish at 1000 (in arrival order), restores of the
+    // same flow at 125 and 250
+    auto order = admission_order(scheduler, {
+            { "c1", Scheduler::CHECKPOINT, "a" },
+            { "c2", Scheduler::CHECKPOINT, "b" },
+            { "r1", Scheduler::RESTORE,    "a" },
+            { "r2", Scheduler::RESTORE,    "a" } }, 1000);
+    std::vector<std::string> expected = { "r1", "r2", "c1", "c2" };
+    CHECK(order == expected);
+    auto stats = scheduler.stats();
+    CHECK_EQ(stats["scheduler.checkpoint.admitted"], 2u);
+    CHECK_EQ(stats["scheduler.checkpoint.delayed"], 2u);
+    CHECK_EQ(stats["scheduler.inflight_bytes"], 0u);
+}
+
+static void test_fair_share_between_flows() {
+    Scheduler scheduler(&s_logger, "{ \"max_inflight_bytes\": 10000 }");
+    // a client queuing three checkpoints does not delay the first
+    // checkpoint of another client arriving after them
+    auto order = admission_order(scheduler, {
+            { "a1", Scheduler::CHECKPOINT, "a" },
+            { "a2", Scheduler::CHECKPOINT, "a" },
+            { "a3", Scheduler::CHECKPOINT, "a" },
+            { "b1", Scheduler::CHECKPOINT, "b" } }, 10000);
+    CHECK_EQ(order.size(), 4u);
+    CHECK_EQ(order[0], std::string("a1"));
+    CHECK_EQ(order[1], std::string("b1"));
+}
+
+static void test_client_priority() {
+    Scheduler scheduler(&s_logger, "{ \"max_inflight_bytes\": 10000 }");
+    scheduler.set_priority("b", 4);
+    auto order = admission_order(scheduler, {
+            { "a1", Scheduler::CHECKPOINT, "a" },
+            { "b1", Scheduler::CHECKPOINT, "b" },
+            { "b2", Scheduler::CHECKPOINT, "b" } }, 10000);
+    // b's requests cost a quarter of a's
+    std::vector<std::string> expected = { "b1", "b2", "a1" };
+    CHECK(order == expected);
+}
+
+static void test_try_admit() {
+    Scheduler scheduler(&s_logger, "{ \"max_inflight_bytes\": 1000 }");
+    Scheduler::ticket t1, t2;
+    CHECK(scheduler.try_admit(Scheduler::CHECKPOINT, "a", 600, t1));
+    CHECK(!scheduler.try_admit(Scheduler::CHECKPOINT, "b", 600, t2));
+    CHECK(scheduler.try_admit(Scheduler::METADATA, "b", 0, t2));
+    t1 = Scheduler::ticket();
+    CHECK(scheduler.try_admit(Scheduler::CHECKPOINT, "b", 600, t2));
+}
+
+static void test_idle_state_is_dropped() {
+    Scheduler scheduler(&s_logger, "{ \"max_inflight_bytes\": 1000000 }");
+    for(int i = 0; i < 10000; i++)
+        scheduler.admit(Scheduler::CHECKPOINT, "client-" + std::to_string(i), 100);
+    auto stats = scheduler.stats();
+    CHECK(stats["scheduler.flows"] < 128u);
+}
+
+int main() {
+    tl::abt scope;
+    test_class_weights();
+    test_fair_share_between_flows();
+    test_client_priority();
+    test_try_admit();
+    test_idle_state_is_dropped();
+    TEST_MAIN_END();
+}
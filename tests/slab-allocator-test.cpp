@@ -0,0 +1,98 @@
+/*
+ * Unit tests of the slab allocator used for packed models.
+ */
+#include <algorithm>
+#include "check.hpp"
+#include "server/slab_allocator.hpp"
+
+using namespace flamestore;
+
+static void test_allocate_release() {
+    SlabAllocator a(64);
+    auto s = a.add_slab(256);
+    std::size_t slab, x, y, z;
+    CHECK(a.allocate(10, slab, x)); // rounded up to 64
+    CHECK_EQ(slab, s);
+    CHECK(a.allocate(64, slab, y));
+    CHECK(a.allocate(128, slab, z));
+    CHECK_EQ(a.used(s), 256u);
+    CHECK(!a.allocate(1, slab, x));
+    // releasing the two first extents coalesces them
+    a.release(s, 0, 64);
+    a.release(s, 64, 64);
+    CHECK_EQ(a.used(s), 128u);
+    CHECK(a.allocate(128, slab, x));
+    CHECK_EQ(x, 0u);
+}
+
+static void test_reserve() {
+    SlabAllocator a(64);
+    auto s = a.add_slab(512);
+    CHECK(a.reserve(s, 128, 64));
+    CHECK(!a.reserve(s, 128, 64));
+    CHECK(!a.reserve(s, 64, 128)); // overlaps the reserved extent
+    CHECK(a.reserve(s, 64, 64));
+    CHECK_EQ(a.used(s), 128u);
+    std::size_t slab, offset;
+    CHECK(a.allocate(64, slab, offset));
+    CHECK_EQ(offset, 0u);
+    CHECK(a.allocate(64, slab, offset));
+    CHECK_EQ(offset, 192u);
+}
+
+static void test_retire() {
+    SlabAllocator a(64);
+    auto s0 = a.add_slab(128);
+    auto s1 = a.add_slab(128);
+    std::size_t slab, offset;
+    a.retire(s0);
+    CHECK(a.allocate(64, slab, offset));
+    CHECK_EQ(slab, s1);
+    a.activate(s0);
+    CHECK(a.allocate(64, slab, offset));
+    CHECK_EQ(slab, s0);
+    a.release(s0, offset, 64);
+    a.remove(s0);
+    CHECK(a.is_removed(s0));
+    CHECK(a.allocate(64, slab, offset));
+    CHECK_EQ(slab, s1);
+    CHECK(!a.allocate(64, slab, offset));
+}
+
+static void test_sparse_slabs() {
+    SlabAllocator a(64);
+    // two slabs 1/4 full, neither can take the content of the other
+    // once it is itself being emptied, and no other slab has room
+    auto s0 = a.add_slab(1024);
+    auto s1 = a.add_slab(1024);
+    CHECK(a.reserve(s0, 0, 256));
+    CHECK(a.reserve(s1, 0, 256));
+    CHECK(a.sparse_slabs(0.5).empty());
+    // a fuller slab with 320 bytes of room can take one of them only
+    auto s2 = a.add_slab(1024);
+    CHECK(a.reserve(s2, 0, 704));
+    auto sparse = a.sparse_slabs(0.5);
+    CHECK_EQ(sparse.size(), 1u);
+    // with more room, both are picked, the emptiest first
+    auto s3 = a.add_slab(1024);
+    CHECK(a.reserve(s3, 0, 768));
+    a.release(s1, 0, 256);
+    CHECK(a.reserve(s1, 0, 128));
+    sparse = a.sparse_slabs(0.5);
+    CHECK_EQ(sparse.size(), 2u);
+    CHECK_EQ(sparse[0], s1);
+    CHECK_EQ(sparse[1], s0);
+    // retired slabs are neither candidates nor room
+    a.retire(s3);
+    sparse = a.sparse_slabs(0.5);
+    CHECK_EQ(sparse.size(), 1u);
+    CHECK_EQ(sparse[0], s1);
+}
+
+int main() {
+    test_allocate_release();
+    test_reserve();
+    test_retire();
+    test_sparse_slabs();
+    TEST_MAIN_END();
+}
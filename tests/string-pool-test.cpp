@@ -0,0 +1,88 @@
+/*
+ * Unit tests of the string pool and of the content keys it uses.
+ */
+#include <string>
+#include "check.hpp"
+#include "common/content_key.hpp"
+#include "server/string_pool.hpp"
+
+using namespace flamestore;
+
+static void test_sha256_vectors() {
+    // FIPS 180-4 examples
+    CHECK_EQ(sha256_hex(""),
+             std::string("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+    CHECK_EQ(sha256_hex("abc"),
+             std::string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+    CHECK_EQ(sha256_hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+             std::string("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"));
+    CHECK_EQ(sha256_hex(std::string(1000000, 'a')),
+             std::string("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"));
+    // padding boundaries: 55, 56 and 64 bytes
+    CHECK_EQ(sha256_hex(std::string(55, 'a')),
+             std::string("9f4390f8d30c2dd92ec9f095b65e2b9ae9b0a925a5258e241c9f1e910f734318"));
+    CHECK_EQ(sha256_hex(std::string(56, 'a')),
+             std::string("b35439a4ac6f0948b6d6f9e3c6af0f5f590ce20f1bde7090ef7970686ec6738a"));
+    CHECK_EQ(sha256_hex(std::string(64, 'a')),
+             std::string("ffe054fe7ae0cb6dc65c3af9b61d5209f439851db43d0ba5997337df154668eb"));
+}
+
+static void test_sha256_incremental() {
+    std::string data;
+    for(int i = 0; i < 1000; i++) data.push_back((char)(i * 7));
+    Sha256 sha;
+    for(std::size_t offset = 0, n = 1; offset < data.size(); offset += n, n = n % 97 + 13)
+        sha.update(data.data() + offset, std::min(n, data.size() - offset));
+    CHECK_EQ(sha.hex_digest(), sha256_hex(data));
+}
+
+static void test_content_key() {
+    CHECK_EQ(content_key("abc"),
+             std::string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad-3"));
+    CHECK_EQ(content_key(std::string(300, 'x')).substr(65), std::string("12c"));
+    CHECK_EQ(content_key("").substr(64), std::string("-0"));
+    CHECK(content_key("config-a") != content_key("config-b"));
+}
+
+static void test_intern_and_find() {
+    StringPool pool;
+    std::string config = "{\"layers\": 3}";
+    auto a = pool.intern(config);
+    auto b = pool.intern(std::string(config));
+    CHECK(a == b);
+    CHECK(pool.find(content_key(config)) == a);
+    CHECK(pool.find(content_key("other")) == nullptr);
+    std::size_t count, bytes;
+    pool.stats(count, bytes);
+    CHECK_EQ(count, 1u);
+    CHECK_EQ(bytes, config.size());
+    interned_string s(a);
+    CHECK(s == config);
+    CHECK_EQ(s.size(), config.size());
+}
+
+static void test_freed_strings() {
+    StringPool pool;
+    auto key = content_key("transient");
+    {
+        auto h = pool.intern("transient");
+        CHECK(pool.find(key) != nullptr);
+    }
+    CHECK(pool.find(key) == nullptr);
+    // enough strings to trigger sweeps
+    for(int i = 0; i < 1000; i++)
+        pool.intern("string " + std::to_string(i));
+    std::size_t count, bytes;
+    pool.stats(count, bytes);
+    CHECK_EQ(count, 0u);
+    CHECK_EQ(bytes, 0u);
+}
+
+int main() {
+    test_sha256_vectors();
+    test_sha256_incremental();
+    test_content_key();
+    test_intern_and_find();
+    test_freed_strings();
+    TEST_MAIN_END();
+}